@@ -0,0 +1,219 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "gl_caps.h"
+
+// Timer queries are GL 3.3 core entry points, which only libGL on Linux/BSD
+// exports directly; elsewhere the GPU column is reported as unavailable.
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define BENCH_GPU_QUERIES 1
+#endif
+
+void benchSamplesInit(BenchSamples* s, int capacity) {
+    s->samples = capacity > 0 ? malloc(capacity * sizeof(double)) : NULL;
+    s->count = 0;
+    s->capacity = s->samples ? capacity : 0;
+}
+
+void benchSamplesAdd(BenchSamples* s, double ms) {
+    if (s->count < s->capacity) {
+        s->samples[s->count++] = ms;
+    }
+}
+
+void benchSamplesFree(BenchSamples* s) {
+    free(s->samples);
+    s->samples = NULL;
+    s->count = s->capacity = 0;
+}
+
+static int compareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, int pct) {
+    int rank = (pct * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int benchSummarize(const BenchSamples* s, BenchSummary* out) {
+    memset(out, 0, sizeof(*out));
+    if (s->count == 0) {
+        return 0;
+    }
+
+    double* sorted = malloc(s->count * sizeof(double));
+    if (!sorted) {
+        return 0;
+    }
+    memcpy(sorted, s->samples, s->count * sizeof(double));
+    qsort(sorted, s->count, sizeof(double), compareDouble);
+
+    double total = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        total += sorted[i];
+    }
+
+    out->count = s->count;
+    out->min = sorted[0];
+    out->p50 = percentile(sorted, s->count, 50);
+    out->p95 = percentile(sorted, s->count, 95);
+    out->p99 = percentile(sorted, s->count, 99);
+    out->max = sorted[s->count - 1];
+    out->mean = total / s->count;
+
+    free(sorted);
+    return 1;
+}
+
+#ifdef BENCH_GPU_QUERIES
+static int contextHasTimerQueries(void) {
+    return glCapsVersionAtLeast(3, 3) || glCapsHasExtension("GL_ARB_timer_query");
+}
+
+static void readQuery(BenchGpuTimer* t, int index, BenchSamples* out) {
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(t->queries[index % BENCH_QUERY_RING], GL_QUERY_RESULT, &ns);
+    benchSamplesAdd(out, ns / 1.0e6);
+}
+#endif
+
+void benchGpuTimerInit(BenchGpuTimer* t) {
+    memset(t, 0, sizeof(*t));
+#ifdef BENCH_GPU_QUERIES
+    if (contextHasTimerQueries()) {
+        glGenQueries(BENCH_QUERY_RING, t->queries);
+        t->supported = 1;
+    }
+#endif
+}
+
+// The slot about to be reused was issued BENCH_QUERY_RING frames ago, so its
+// result is normally ready and reading it does not block
+void benchGpuTimerBegin(BenchGpuTimer* t, BenchSamples* out) {
+#ifdef BENCH_GPU_QUERIES
+    if (!t->supported) {
+        return;
+    }
+    if (t->pending == BENCH_QUERY_RING) {
+        readQuery(t, t->issued - BENCH_QUERY_RING, out);
+        t->pending--;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, t->queries[t->issued % BENCH_QUERY_RING]);
+#else
+    (void)t;
+    (void)out;
+#endif
+}
+
+void benchGpuTimerEnd(BenchGpuTimer* t) {
+#ifdef BENCH_GPU_QUERIES
+    if (!t->supported) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    t->issued++;
+    t->pending++;
+#else
+    (void)t;
+#endif
+}
+
+void benchGpuTimerFinish(BenchGpuTimer* t, BenchSamples* out) {
+#ifdef BENCH_GPU_QUERIES
+    while (t->supported && t->pending > 0) {
+        readQuery(t, t->issued - t->pending, out);
+        t->pending--;
+    }
+#else
+    (void)t;
+    (void)out;
+#endif
+}
+
+void benchGpuTimerDestroy(BenchGpuTimer* t) {
+#ifdef BENCH_GPU_QUERIES
+    if (t->supported) {
+        glDeleteQueries(BENCH_QUERY_RING, t->queries);
+    }
+#endif
+    t->supported = 0;
+}
+
+static void printTextRow(FILE* f, const char* label, const BenchSamples* s) {
+    BenchSummary sum;
+    if (!benchSummarize(s, &sum)) {
+        fprintf(f, "  %-6s  n/a\n", label);
+        return;
+    }
+    fprintf(f, "  %-6s %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f\n", label, sum.min, sum.p50, sum.p95, sum.p99,
+            sum.max, sum.mean);
+}
+
+void benchPrintText(FILE* f, const BenchReport* r) {
+    fprintf(f, "%s benchmark: %d frames at %.2f ms simulated steps, %.2f s wall (%.1f fps)\n", r->program,
+            r->frames, r->timestep * 1000.0, r->wallSeconds,
+            r->wallSeconds > 0.0 ? r->frames / r->wallSeconds : 0.0);
+    fprintf(f, "  path: %s\n", r->path);
+    fprintf(f, "  renderer: %s\n", r->renderer ? r->renderer : "unknown");
+    fprintf(f, "  ms          min      p50      p95      p99      max     mean\n");
+    printTextRow(f, "cpu", &r->cpu);
+    printTextRow(f, "gpu", &r->gpu);
+    printTextRow(f, "frame", &r->interval);
+}
+
+static void printJsonString(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+            fputc(*s, f);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(f, "\\u%04x", *s);
+        } else {
+            fputc(*s, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void printJsonSummary(FILE* f, const BenchSamples* s) {
+    BenchSummary sum;
+    if (!benchSummarize(s, &sum)) {
+        fprintf(f, "null");
+        return;
+    }
+    fprintf(f, "{\"samples\": %d, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, "
+               "\"mean\": %.4f}",
+            sum.count, sum.min, sum.p50, sum.p95, sum.p99, sum.max, sum.mean);
+}
+
+void benchPrintJson(FILE* f, const BenchReport* r) {
+    fprintf(f, "{\n  \"program\": ");
+    printJsonString(f, r->program);
+    fprintf(f, ",\n  \"path\": ");
+    printJsonString(f, r->path);
+    fprintf(f, ",\n  \"renderer\": ");
+    printJsonString(f, r->renderer ? r->renderer : "unknown");
+    fprintf(f, ",\n  \"frames\": %d,\n  \"timestep\": %.6f,\n  \"wall_seconds\": %.4f,\n", r->frames, r->timestep,
+            r->wallSeconds);
+    fprintf(f, "  \"cpu_ms\": ");
+    printJsonSummary(f, &r->cpu);
+    fprintf(f, ",\n  \"gpu_ms\": ");
+    printJsonSummary(f, &r->gpu);
+    fprintf(f, ",\n  \"frame_interval_ms\": ");
+    printJsonSummary(f, &r->interval);
+    fprintf(f, "\n}\n");
+}
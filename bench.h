@@ -0,0 +1,61 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+
+// Frame-time collection and reporting for the headless --bench modes.
+// CPU times come from the caller; GPU times from GL_TIME_ELAPSED queries
+// kept in a small ring so reading a result never stalls the pipeline.
+
+#define BENCH_QUERY_RING 4
+
+typedef struct {
+    double* samples;  // milliseconds
+    int count;
+    int capacity;
+} BenchSamples;
+
+typedef struct {
+    int count;
+    double min, p50, p95, p99, max, mean;
+} BenchSummary;
+
+typedef struct {
+    unsigned int queries[BENCH_QUERY_RING];
+    int issued;  // queries begun so far
+    int pending;  // begun but not yet read back
+    int supported;
+} BenchGpuTimer;
+
+typedef struct {
+    const char* program;
+    const char* path;  // rendering path, e.g. "retained" or "cpu/avx2"
+    const char* renderer;  // GL_RENDERER string
+    int frames;
+    double timestep;  // simulated seconds per frame
+    double wallSeconds;  // whole run, warm-up excluded
+    BenchSamples cpu;  // CPU time spent producing each frame, swap included
+    BenchSamples gpu;  // empty when timer queries are unsupported
+    BenchSamples interval;  // end of one frame to the end of the next
+} BenchReport;
+
+void benchSamplesInit(BenchSamples* s, int capacity);
+void benchSamplesAdd(BenchSamples* s, double ms);
+void benchSamplesFree(BenchSamples* s);
+
+// Nearest-rank percentiles. Returns 0 when there are no samples.
+int benchSummarize(const BenchSamples* s, BenchSummary* out);
+
+// Needs a current context. Without GL 3.3 or ARB_timer_query the timer
+// stays disabled and the other calls do nothing.
+void benchGpuTimerInit(BenchGpuTimer* t);
+void benchGpuTimerBegin(BenchGpuTimer* t, BenchSamples* out);
+void benchGpuTimerEnd(BenchGpuTimer* t);
+// Wait for the outstanding queries and record them
+void benchGpuTimerFinish(BenchGpuTimer* t, BenchSamples* out);
+void benchGpuTimerDestroy(BenchGpuTimer* t);
+
+void benchPrintText(FILE* f, const BenchReport* r);
+void benchPrintJson(FILE* f, const BenchReport* r);
+
+#endif
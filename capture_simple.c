@@ -4,25 +4,48 @@
 #include <math.h>
 #include <string.h>
 
-void captureFrame(int width, int height, int frameNumber) {
-    unsigned char* pixels = malloc(width * height * 3);
-    if (!pixels) return;
+#include "frame_readback.h"
+#include "frame_stream.h"
+#include "frame_writer.h"
+#include "gif_encoder.h"
+#include "headless.h"
+#include "snapshot.h"
+#include "worker_pool.h"
 
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+// Wall time, from GLFW or, in a headless run, the headless clock
+double wallClock(GLFWwindow* window) {
+    return window ? glfwGetTime() : headlessTime();
+}
 
+// Writes a captured frame to frames/ as a PPM, on a writer thread
+// (frame_writer.h)
+void writeFrame(const unsigned char* pixels, int width, int height, int frameNumber, void* user) {
     char filename[256];
     snprintf(filename, sizeof(filename), "frames/frame_%05d.ppm", frameNumber);
 
     FILE* f = fopen(filename, "wb");
     if (f) {
         fprintf(f, "P6\n%d %d\n255\n", width, height);
-        for (int y = height - 1; y >= 0; y--) {
-            fwrite(pixels + y * width * 3, 1, width * 3, f);
-        }
+        fwrite(pixels, 1, (size_t)width * height * 3, f);
         fclose(f);
     }
+}
+
+// Appends a captured frame to the video stream (frame_stream.h), on the
+// single writer thread that keeps the frames in order
+void streamFrame(const unsigned char* pixels, int width, int height, int frameNumber, void* user) {
+    frameStreamWrite(user, pixels);
+}
+
+// Appends a captured frame to the GIF (gif_encoder.h), on the single writer
+// thread; every few frames it encodes a batch on the worker pool
+void gifFrame(const unsigned char* pixels, int width, int height, int frameNumber, void* user) {
+    gifEncoderAddFrame(user, pixels);
+}
 
-    free(pixels);
+// Hands each frame read back (frame_readback.h) to the writers
+void queueFrame(const unsigned char* pixels, int width, int height, int frameNumber, void* user) {
+    frameWriterSubmit(pixels, frameNumber);
 }
 
 void draw_wave(float time, float y_offset, float amplitude) {
@@ -46,72 +69,219 @@ void draw_wave(float time, float y_offset, float amplitude) {
     glEnd();
 }
 
+void drawScene(float timeValue) {
+    glClearColor(0.95f, 0.95f, 0.98f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    draw_wave(timeValue, 0.0, 0.1);
+    draw_wave(timeValue * 1.2, -0.3, 0.08);
+    draw_wave(timeValue * 0.8, -0.6, 0.12);
+
+    for (int i = 0; i < 5; i++) {
+        float orb_time = timeValue + i * 1.256;
+        float x = sin(orb_time * 0.7) * 0.8;
+        float y = cos(orb_time * 0.5) * 0.3 + sin(orb_time) * 0.1;
+
+        glBegin(GL_TRIANGLE_FAN);
+        glColor4f(1.0, 0.9, 0.7, 0.6);
+        for (int j = 0; j <= 20; j++) {
+            float angle = j * 2.0 * 3.14159 / 20;
+            glVertex2f(x + cos(angle) * 0.02, y + sin(angle) * 0.02);
+        }
+        glEnd();
+    }
+}
+
 int main(int argc, char* argv[]) {
-    int captureMode = (argc > 1 && strcmp(argv[1], "--capture") == 0);
+    // --snapshot=FILE draws one fixed-time frame for the regression harness
+    // (snapshot.h) instead of capturing
+    // --writers=N writer threads (one per spare core by default) and
+    //   --writer-queue=N frames queued for them before capture waits
+    // --stdout or --stream=PATH captures into one video stream instead of
+    //   frames/, as --stream-format=y4m (the default) or raw RGB
+    // --gif=FILE captures into an animated GIF instead, tuned with the
+    //   --gif-* options (gif_encoder.h) and encoded on --threads=N workers
+    int captureMode = 0;
+    const char* streamPath = NULL;
+    FrameStreamFormat streamFormat = FRAME_STREAM_Y4M;
+    const char* gifPath = NULL;
+    GifOptions gifOptions;
+    gifOptionsDefault(&gifOptions);
+    int threads = -1;
+    int writers = -1;
+    int writerQueue = FRAME_WRITER_DEFAULT_QUEUE;
+    int headlessMode = 0;
+    const char* headlessBackend = NULL;
+    Snapshot snapshot;
+    snapshotInit(&snapshot);
+    for (int i = 1; i < argc; i++) {
+        if (snapshotOption(&snapshot, argv[i]) || gifOption(&gifOptions, argv[i])) {
+            continue;
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            captureMode = 1;
+        } else if (strcmp(argv[i], "--stdout") == 0) {
+            streamPath = "-";
+        } else if (strncmp(argv[i], "--stream=", 9) == 0) {
+            streamPath = argv[i] + 9;
+        } else if (strncmp(argv[i], "--stream-format=", 16) == 0) {
+            if (!frameStreamParseFormat(argv[i] + 16, &streamFormat)) {
+                printf("Unknown stream format '%s' (y4m or raw)\n", argv[i] + 16);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--gif=", 6) == 0) {
+            gifPath = argv[i] + 6;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--writers=", 10) == 0) {
+            writers = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--writer-queue=", 15) == 0) {
+            writerQueue = atoi(argv[i] + 15);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = 1;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessMode = 1;
+            headlessBackend = argv[i] + 11;
+        }
+    }
+    // A headless run has no window to watch, so it always captures or
+    // snapshots
+    if (snapshot.path) {
+        captureMode = 0;
+        streamPath = NULL;
+        gifPath = NULL;
+    } else if (headlessMode || streamPath || gifPath) {
+        captureMode = 1;
+    }
+    if (streamPath && gifPath) {
+        printf("Capture into a video stream or a GIF, not both\n");
+        return -1;
+    }
     int captureSeconds = 30;
     int targetFPS = 30;
 
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
+    // Opened first, so that with --stdout everything printed from here on
+    // goes to stderr
+    FrameStream stream;
+    if (streamPath && !frameStreamOpen(&stream, streamPath, streamFormat, 800, 600, targetFPS)) {
         return -1;
     }
-
-    if (captureMode) {
-        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GifEncoder gif;
+    if (gifPath) {
+        workerPoolInit(threads);
+        if (!gifEncoderOpen(&gif, gifPath, &gifOptions, 800, 600, targetFPS)) {
+            workerPoolDestroy();
+            return -1;
+        }
     }
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
-    if (!window) {
-        printf("Failed to create window\n");
-        glfwTerminate();
-        return -1;
-    }
+    // Headless runs never start GLFW and leave window NULL
+    GLFWwindow* window = NULL;
+    HeadlessContext headless;
+    if (headlessMode) {
+        if (!headlessCreate(&headless, headlessBackend, 800, 600, 0, 0, 0)) {
+            printf("Failed to create a headless context\n");
+            return -1;
+        }
+        printf("Rendering headless (%s)\n", headlessBackendName(&headless));
+    } else {
+        if (!glfwInit()) {
+            printf("Failed to initialize GLFW\n");
+            return -1;
+        }
 
-    glfwMakeContextCurrent(window);
+        if (captureMode || snapshot.path) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+
+        window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
+        if (!window) {
+            printf("Failed to create window\n");
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        if (snapshot.path) {
+            glfwSwapInterval(0);
+        }
+    }
 
     int frameCount = 0;
     int totalFrames = captureSeconds * targetFPS;
     double frameTime = 1.0 / targetFPS;
     double simulatedTime = 0.0;
 
+    // Frames are read back through a ring of pixel buffers and written on
+    // the writer threads, so the render loop only copies each one into the
+    // writers' queue
+    FrameReadback readback;
+    double captureStart = 0.0;
     if (captureMode) {
-        system("mkdir -p frames");
-        printf("Capturing %d seconds at %d FPS (%d frames)...\n", captureSeconds, targetFPS, totalFrames);
+        if (gifPath && gifOptions.palette == GIF_PALETTE_GLOBAL) {
+            // One palette for the whole GIF, from frames spread across the
+            // capture, drawn and read back before it starts
+            unsigned char* sample = malloc(800 * 600 * 3);
+            for (int k = 0; sample && k < GIF_PALETTE_SAMPLES; k++) {
+                drawScene((float)k * captureSeconds / GIF_PALETTE_SAMPLES);
+                glReadPixels(0, 0, 800, 600, GL_RGB, GL_UNSIGNED_BYTE, sample);
+                gifEncoderSample(&gif, sample);
+            }
+            free(sample);
+        }
+        if (gifPath) {
+            writers = frameWriterInit(1, writerQueue, 800, 600, gifFrame, &gif);
+        } else if (streamPath) {
+            writers = frameWriterInit(1, writerQueue, 800, 600, streamFrame, &stream);
+        } else {
+            writers = frameWriterInit(writers, writerQueue, 800, 600, writeFrame, NULL);
+        }
+        if (writers < 0 || !frameReadbackInit(&readback, 800, 600, queueFrame, NULL)) {
+            printf("Failed to allocate the capture buffers\n");
+            frameWriterFinish(NULL);
+            if (gifPath) {
+                gifEncoderClose(&gif);
+                workerPoolDestroy();
+            }
+            if (window) {
+                glfwTerminate();
+            } else {
+                headlessDestroy(&headless);
+            }
+            return -1;
+        }
+        if (!streamPath && !gifPath) {
+            system("mkdir -p frames");
+        }
+        printf("Capturing %d seconds at %d FPS (%d frames, %s readback, %d writer threads)...\n", captureSeconds,
+               targetFPS, totalFrames, frameReadbackModeName(&readback), writers);
+        captureStart = wallClock(window);
     }
 
-    while (!glfwWindowShouldClose(window)) {
+    while (!window || !glfwWindowShouldClose(window)) {
         if (captureMode && frameCount >= totalFrames) {
             break;
         }
+        if (streamPath && frameStreamFailed(&stream)) {
+            printf("The video stream was closed; stopping\n");
+            break;
+        }
+        double frameStart = wallClock(window);
 
-        glClearColor(0.95f, 0.95f, 0.98f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        float timeValue = captureMode ? simulatedTime : glfwGetTime();
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        draw_wave(timeValue, 0.0, 0.1);
-        draw_wave(timeValue * 1.2, -0.3, 0.08);
-        draw_wave(timeValue * 0.8, -0.6, 0.12);
-
-        for (int i = 0; i < 5; i++) {
-            float orb_time = timeValue + i * 1.256;
-            float x = sin(orb_time * 0.7) * 0.8;
-            float y = cos(orb_time * 0.5) * 0.3 + sin(orb_time) * 0.1;
-
-            glBegin(GL_TRIANGLE_FAN);
-            glColor4f(1.0, 0.9, 0.7, 0.6);
-            for (int j = 0; j <= 20; j++) {
-                float angle = j * 2.0 * 3.14159 / 20;
-                glVertex2f(x + cos(angle) * 0.02, y + sin(angle) * 0.02);
-            }
-            glEnd();
+        // The snapshot clock comes first, since headless runs never start
+        // GLFW
+        float timeValue;
+        if (snapshot.path) {
+            timeValue = snapshotClock(&snapshot);
+        } else {
+            timeValue = captureMode ? simulatedTime : wallClock(window);
         }
+        drawScene(timeValue);
 
         if (captureMode) {
-            captureFrame(800, 600, frameCount);
+            frameReadbackCapture(&readback, frameCount);
             frameCount++;
             simulatedTime += frameTime;
 
@@ -120,14 +290,48 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        snapshotCapture(&snapshot, 800, 600);
+        if (window) {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        } else {
+            headlessFinishFrame(&headless);
+        }
+        if (snapshotFrameDone(&snapshot, (wallClock(window) - frameStart) * 1000.0)) {
+            break;
+        }
     }
 
     if (captureMode) {
-        printf("Capture complete! %d frames saved to frames/\n", frameCount);
+        frameReadbackFlush(&readback);
+        frameReadbackDestroy(&readback);
+        FrameWriterStats written;
+        frameWriterFinish(&written);
+        if (streamPath) {
+            frameStreamClose(&stream);
+        }
+        if (gifPath) {
+            if (!gifEncoderClose(&gif)) {
+                printf("Failed to write %s\n", gifPath);
+            }
+            workerPoolDestroy();
+            printf("Capture complete! %d frames encoded into %s (%.1f MB) in %.1f s\n", written.frames, gifPath,
+                   gif.bytes / 1048576.0, wallClock(window) - captureStart);
+        } else {
+            printf("Capture complete! %d frames %s in %.1f s\n", written.frames,
+                   streamPath ? "streamed" : "saved to frames/", wallClock(window) - captureStart);
+        }
+        if (written.stalls > 0) {
+            printf("The writers fell behind on %d frames, holding capture up for %.1f s\n", written.stalls,
+                   written.stallSeconds);
+        }
     }
 
-    glfwTerminate();
+    snapshotDestroy(&snapshot);
+    if (window) {
+        glfwTerminate();
+    } else {
+        headlessDestroy(&headless);
+    }
     return 0;
 }
\ No newline at end of file
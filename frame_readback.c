@@ -0,0 +1,139 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_readback.h"
+#include "gl_caps.h"
+
+// Buffer objects, mapping and sync objects are GL 1.5-3.2 entry points,
+// which only libGL on Linux/BSD exports directly; elsewhere capture reads
+// synchronously.
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define FRAME_READBACK_PBO_ENTRY_POINTS 1
+#endif
+
+#ifdef FRAME_READBACK_PBO_ENTRY_POINTS
+static int initRing(FrameReadback* fr) {
+    if (!(glCapsVersionAtLeast(2, 1) || glCapsHasExtension("GL_ARB_pixel_buffer_object")) ||
+        !(glCapsVersionAtLeast(3, 2) || glCapsHasExtension("GL_ARB_sync"))) {
+        return 0;
+    }
+    glGenBuffers(FRAME_READBACK_RING, fr->buffers);
+    for (int i = 0; i < FRAME_READBACK_RING; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, fr->buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)fr->frameSize, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return 1;
+}
+
+// Hand the oldest frame in flight to the consumer and free its slot
+static void consumeOldest(FrameReadback* fr) {
+    int slot = (fr->next + FRAME_READBACK_RING - fr->pending) % FRAME_READBACK_RING;
+    GLsync fence = (GLsync)fr->fences[slot];
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    fr->fences[slot] = NULL;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, fr->buffers[slot]);
+    const unsigned char* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)fr->frameSize, GL_MAP_READ_BIT);
+    if (pixels) {
+        fr->consume(pixels, fr->width, fr->height, fr->frameNumbers[slot], fr->user);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        printf("Cannot map captured frame %d\n", fr->frameNumbers[slot]);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fr->pending--;
+}
+#endif
+
+int frameReadbackInit(FrameReadback* fr, int width, int height, FrameReadbackConsumer consume, void* user) {
+    memset(fr, 0, sizeof(*fr));
+    fr->width = width;
+    fr->height = height;
+    fr->frameSize = (size_t)width * height * 3;
+    fr->consume = consume;
+    fr->user = user;
+
+#ifdef FRAME_READBACK_PBO_ENTRY_POINTS
+    if (initRing(fr)) {
+        fr->mode = FRAME_READBACK_PBO;
+        return 1;
+    }
+#endif
+
+    fr->pixels = malloc(fr->frameSize);
+    if (!fr->pixels) {
+        return 0;
+    }
+    fr->mode = FRAME_READBACK_SYNC;
+    return 1;
+}
+
+void frameReadbackDestroy(FrameReadback* fr) {
+#ifdef FRAME_READBACK_PBO_ENTRY_POINTS
+    if (fr->mode == FRAME_READBACK_PBO) {
+        for (int i = 0; i < FRAME_READBACK_RING; i++) {
+            if (fr->fences[i]) {
+                glDeleteSync((GLsync)fr->fences[i]);
+            }
+        }
+        glDeleteBuffers(FRAME_READBACK_RING, fr->buffers);
+    }
+#endif
+    free(fr->pixels);
+    memset(fr, 0, sizeof(*fr));
+}
+
+void frameReadbackCapture(FrameReadback* fr, int frameNumber) {
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+#ifdef FRAME_READBACK_PBO_ENTRY_POINTS
+    if (fr->mode == FRAME_READBACK_PBO) {
+        // The slot's previous frame went out two calls ago
+        int slot = fr->next;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, fr->buffers[slot]);
+        glReadPixels(0, 0, fr->width, fr->height, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fr->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fr->frameNumbers[slot] = frameNumber;
+        fr->next = (slot + 1) % FRAME_READBACK_RING;
+        fr->pending++;
+
+        if (fr->pending == FRAME_READBACK_RING) {
+            consumeOldest(fr);
+        }
+        return;
+    }
+#endif
+
+    if (fr->pixels) {
+        glReadPixels(0, 0, fr->width, fr->height, GL_RGB, GL_UNSIGNED_BYTE, fr->pixels);
+        fr->consume(fr->pixels, fr->width, fr->height, frameNumber, fr->user);
+    }
+}
+
+void frameReadbackFlush(FrameReadback* fr) {
+#ifdef FRAME_READBACK_PBO_ENTRY_POINTS
+    while (fr->mode == FRAME_READBACK_PBO && fr->pending > 0) {
+        consumeOldest(fr);
+    }
+#else
+    (void)fr;
+#endif
+}
+
+const char* frameReadbackModeName(const FrameReadback* fr) {
+    return fr->mode == FRAME_READBACK_PBO ? "pixel buffer ring" : "synchronous";
+}
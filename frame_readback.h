@@ -0,0 +1,57 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include <stddef.h>
+
+// Reads rendered frames back for capture without stalling on the GPU.
+//
+// With pixel buffer objects (GL 2.1 or ARB_pixel_buffer_object) and sync
+// objects (GL 3.2 or ARB_sync), each frame's glReadPixels goes into the next
+// of FRAME_READBACK_RING pack buffers and returns at once, with a fence
+// behind it. A frame is mapped and handed to the consumer two frames later,
+// while the GPU is busy with the newest one, by which time its fence has
+// normally long signalled. Contexts without them read straight into client
+// memory, which waits for the frame to finish, and consume it at once.
+
+#define FRAME_READBACK_RING 3
+
+// Called once per captured frame, in order: width * height RGB pixels,
+// bottom row first as GL returns them. pixels is only valid for the call.
+typedef void (*FrameReadbackConsumer)(const unsigned char* pixels, int width, int height, int frameNumber,
+                                      void* user);
+
+typedef enum {
+    FRAME_READBACK_SYNC,  // glReadPixels into client memory
+    FRAME_READBACK_PBO    // pack buffer ring with fences
+} FrameReadbackMode;
+
+typedef struct {
+    FrameReadbackMode mode;
+    int width, height;
+    size_t frameSize;
+    FrameReadbackConsumer consume;
+    void* user;
+
+    unsigned int buffers[FRAME_READBACK_RING];
+    void* fences[FRAME_READBACK_RING];  // GLsync
+    int frameNumbers[FRAME_READBACK_RING];
+    int next;     // slot the next readback goes into
+    int pending;  // readbacks issued and not yet consumed
+
+    unsigned char* pixels;  // sync mode
+} FrameReadback;
+
+// Needs a current context. Returns 0 if memory could not be allocated.
+int frameReadbackInit(FrameReadback* fr, int width, int height, FrameReadbackConsumer consume, void* user);
+void frameReadbackDestroy(FrameReadback* fr);
+
+// Read back the frame just drawn; call before the swap. Hands the frame
+// from two calls back to the consumer.
+void frameReadbackCapture(FrameReadback* fr, int frameNumber);
+
+// Consume every frame still in flight, after the last capture
+void frameReadbackFlush(FrameReadback* fr);
+
+const char* frameReadbackModeName(const FrameReadback* fr);
+
+#endif
@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "frame_stream.h"
+
+int frameStreamParseFormat(const char* name, FrameStreamFormat* format) {
+    if (strcmp(name, "y4m") == 0) {
+        *format = FRAME_STREAM_Y4M;
+    } else if (strcmp(name, "raw") == 0) {
+        *format = FRAME_STREAM_RAW;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Take over standard output for the stream and point the stdout the rest
+// of the program prints to at standard error
+static FILE* claimStdout(void) {
+    fflush(stdout);
+    int fd = dup(fileno(stdout));
+    if (fd < 0) {
+        return NULL;
+    }
+    if (dup2(fileno(stderr), fileno(stdout)) < 0) {
+        close(fd);
+        return NULL;
+    }
+#ifdef _WIN32
+    _setmode(fd, _O_BINARY);
+#endif
+    return fdopen(fd, "wb");
+}
+
+int frameStreamOpen(FrameStream* fs, const char* path, FrameStreamFormat format, int width, int height, int fps) {
+    memset(fs, 0, sizeof(*fs));
+    fs->format = format;
+    fs->width = width;
+    fs->height = height;
+
+    if (format == FRAME_STREAM_Y4M) {
+        int chroma = ((width + 1) / 2) * ((height + 1) / 2);
+        fs->planes = malloc((size_t)width * height + 2 * (size_t)chroma);
+        if (!fs->planes) {
+            return 0;
+        }
+    }
+
+#ifndef _WIN32
+    // A reader that quits should fail the next write, not kill the program
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    fs->file = strcmp(path, "-") == 0 ? claimStdout() : fopen(path, "wb");
+    if (!fs->file) {
+        fprintf(stderr, "Cannot open %s for the video stream\n", strcmp(path, "-") == 0 ? "standard output" : path);
+        free(fs->planes);
+        fs->planes = NULL;
+        return 0;
+    }
+
+    if (format == FRAME_STREAM_Y4M) {
+        fprintf(fs->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height, fps);
+    }
+    return 1;
+}
+
+// Full-range BT.601 in 16.16 fixed point; the chroma offset of 128 is folded
+// in so the sums never go negative
+static unsigned char lumaOf(int r, int g, int b) {
+    return (unsigned char)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+}
+
+// Fully saturated blue or red rounds to 256, one past the top
+static unsigned char clampChroma(int value) {
+    return (unsigned char)(value > 255 ? 255 : value);
+}
+
+static unsigned char blueDifferenceOf(int r, int g, int b) {
+    return clampChroma((-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32768) >> 16);
+}
+
+static unsigned char redDifferenceOf(int r, int g, int b) {
+    return clampChroma((32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32768) >> 16);
+}
+
+// RGB to planar 4:2:0, each chroma sample from the average colour of its
+// 2x2 block (clipped at odd edges)
+static void toYuv420(const FrameStream* fs, const unsigned char* rgb) {
+    int width = fs->width, height = fs->height;
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    unsigned char* yPlane = fs->planes;
+    unsigned char* uPlane = yPlane + (size_t)width * height;
+    unsigned char* vPlane = uPlane + (size_t)chromaWidth * chromaHeight;
+
+    for (int i = 0; i < width * height; i++) {
+        yPlane[i] = lumaOf(rgb[i * 3 + 0], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+    }
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int sum[3] = {0, 0, 0}, count = 0;
+            for (int y = cy * 2; y < cy * 2 + 2 && y < height; y++) {
+                for (int x = cx * 2; x < cx * 2 + 2 && x < width; x++) {
+                    const unsigned char* p = rgb + ((size_t)y * width + x) * 3;
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    count++;
+                }
+            }
+            int r = (sum[0] + count / 2) / count;
+            int g = (sum[1] + count / 2) / count;
+            int b = (sum[2] + count / 2) / count;
+            uPlane[cy * chromaWidth + cx] = blueDifferenceOf(r, g, b);
+            vPlane[cy * chromaWidth + cx] = redDifferenceOf(r, g, b);
+        }
+    }
+}
+
+int frameStreamWrite(FrameStream* fs, const unsigned char* rgb) {
+    if (frameStreamFailed(fs)) {
+        return 0;
+    }
+    size_t pixels = (size_t)fs->width * fs->height;
+    int failed;
+    if (fs->format == FRAME_STREAM_Y4M) {
+        size_t chroma = (size_t)((fs->width + 1) / 2) * ((fs->height + 1) / 2);
+        toYuv420(fs, rgb);
+        failed = fputs("FRAME\n", fs->file) < 0 ||
+                 fwrite(fs->planes, 1, pixels + 2 * chroma, fs->file) != pixels + 2 * chroma;
+    } else {
+        failed = fwrite(rgb, 1, pixels * 3, fs->file) != pixels * 3;
+    }
+    __atomic_store_n(&fs->failed, failed, __ATOMIC_RELAXED);
+    return !failed;
+}
+
+int frameStreamFailed(const FrameStream* fs) {
+    return __atomic_load_n(&fs->failed, __ATOMIC_RELAXED);
+}
+
+void frameStreamClose(FrameStream* fs) {
+    if (fs->file) {
+        fclose(fs->file);
+    }
+    free(fs->planes);
+    memset(fs, 0, sizeof(*fs));
+}
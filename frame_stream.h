@@ -0,0 +1,52 @@
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+#include <stdio.h>
+
+// Captured frames as one video stream, for an encoder to read as they are
+// drawn instead of going through a directory of image files:
+//
+//   ./capture --stdout | ffmpeg -i - -c:v libx264 waves.mp4
+//
+// Y4M (YUV4MPEG2) carries its own frame size and rate, so encoders need no
+// options to read it. Frames are converted to full-range BT.601 4:2:0, as
+// the header declares (C420jpeg, XCOLORRANGE=FULL). Raw video is the RGB
+// bytes themselves, top row first; the reader must be told the format
+// (ffmpeg -f rawvideo -pixel_format rgb24 -video_size 800x600 -framerate 30
+// -i -).
+//
+// The path "-" is standard output. Everything else the program prints is
+// moved to standard error from then on, so it cannot corrupt the stream.
+// Any other path is opened for writing, so it can be a named pipe (mkfifo)
+// that an encoder is reading.
+
+typedef enum {
+    FRAME_STREAM_Y4M,
+    FRAME_STREAM_RAW
+} FrameStreamFormat;
+
+typedef struct {
+    FILE* file;
+    FrameStreamFormat format;
+    int width, height;
+    unsigned char* planes;  // Y4M: the frame's Y, U and V planes
+    int failed;             // see frameStreamFailed
+} FrameStream;
+
+// Parse "y4m" or "raw"; returns 0 for anything else
+int frameStreamParseFormat(const char* name, FrameStreamFormat* format);
+
+// Open the stream and write its header. Returns 0 on failure.
+int frameStreamOpen(FrameStream* fs, const char* path, FrameStreamFormat format, int width, int height, int fps);
+
+// Append one frame of RGB pixels, top row first. Returns 0 once the
+// reader has gone away; the frame and all later ones are dropped.
+int frameStreamWrite(FrameStream* fs, const unsigned char* rgb);
+
+// Whether a write has failed, e.g. because the reader quit. Safe to ask
+// from another thread than the one writing.
+int frameStreamFailed(const FrameStream* fs);
+
+void frameStreamClose(FrameStream* fs);
+
+#endif
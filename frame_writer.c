@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "frame_writer.h"
+
+// As in worker_pool.c: MinGW builds go without winpthreads
+#ifndef _WIN32
+#define FRAME_WRITER_THREADED 1
+#endif
+
+#ifdef FRAME_WRITER_THREADED
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+static int frameWidth, frameHeight;
+static size_t frameSize;
+static FrameWriterFn writeFn;
+static void* writeUser;
+static FrameWriterStats stats;
+
+// Each slot holds one frame; free slots sit on a stack and queued ones in a
+// FIFO ring, so the writers start frames in the order they were submitted
+static int slotCount = 0;
+static unsigned char** slotPixels;
+static int* slotFrame;
+static int* freeSlots;
+static int freeCount;
+static int* queuedSlots;
+static int queueHead, queueCount;
+
+// Copy bottom-up GL rows into a slot, top row first
+static void copyFlipped(unsigned char* out, const unsigned char* pixels) {
+    size_t row = (size_t)frameWidth * 3;
+    for (int y = 0; y < frameHeight; y++) {
+        memcpy(out + (size_t)y * row, pixels + (size_t)(frameHeight - 1 - y) * row, row);
+    }
+}
+
+#ifdef FRAME_WRITER_THREADED
+static pthread_t writers[FRAME_WRITER_MAX_THREADS];
+static int writerCount = 0;
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t frameQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t slotFreed = PTHREAD_COND_INITIALIZER;
+static int finishing = 0;
+
+static double monotonicSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1.0e9;
+}
+
+static void* writerMain(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queueLock);
+        while (queueCount == 0 && !finishing) {
+            pthread_cond_wait(&frameQueued, &queueLock);
+        }
+        if (queueCount == 0) {
+            pthread_mutex_unlock(&queueLock);
+            return NULL;
+        }
+        int slot = queuedSlots[queueHead];
+        queueHead = (queueHead + 1) % slotCount;
+        queueCount--;
+        pthread_mutex_unlock(&queueLock);
+
+        writeFn(slotPixels[slot], frameWidth, frameHeight, slotFrame[slot], writeUser);
+
+        pthread_mutex_lock(&queueLock);
+        freeSlots[freeCount++] = slot;
+        stats.frames++;
+        pthread_cond_signal(&slotFreed);
+        pthread_mutex_unlock(&queueLock);
+    }
+}
+#endif
+
+static void freeQueue(void) {
+    for (int i = 0; i < slotCount; i++) {
+        free(slotPixels ? slotPixels[i] : NULL);
+    }
+    free(slotPixels);
+    free(slotFrame);
+    free(freeSlots);
+    free(queuedSlots);
+    slotPixels = NULL;
+    slotFrame = freeSlots = queuedSlots = NULL;
+    slotCount = 0;
+}
+
+int frameWriterInit(int threads, int queueDepth, int width, int height, FrameWriterFn write, void* user) {
+#ifdef FRAME_WRITER_THREADED
+    if (threads < 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 1 ? (int)cores - 1 : 1;
+    }
+    if (threads > FRAME_WRITER_MAX_THREADS) {
+        threads = FRAME_WRITER_MAX_THREADS;
+    }
+#else
+    threads = 0;
+#endif
+    if (queueDepth < threads) {
+        queueDepth = threads;
+    }
+    if (queueDepth < 1) {
+        queueDepth = 1;
+    }
+
+    frameWidth = width;
+    frameHeight = height;
+    frameSize = (size_t)width * height * 3;
+    writeFn = write;
+    writeUser = user;
+    memset(&stats, 0, sizeof(stats));
+
+    slotCount = queueDepth;
+    slotPixels = calloc(slotCount, sizeof(*slotPixels));
+    slotFrame = calloc(slotCount, sizeof(*slotFrame));
+    freeSlots = calloc(slotCount, sizeof(*freeSlots));
+    queuedSlots = calloc(slotCount, sizeof(*queuedSlots));
+    if (!slotPixels || !slotFrame || !freeSlots || !queuedSlots) {
+        freeQueue();
+        return -1;
+    }
+    for (int i = 0; i < slotCount; i++) {
+        slotPixels[i] = malloc(frameSize);
+        if (!slotPixels[i]) {
+            freeQueue();
+            return -1;
+        }
+        freeSlots[i] = slotCount - 1 - i;
+    }
+    freeCount = slotCount;
+    queueHead = queueCount = 0;
+
+#ifdef FRAME_WRITER_THREADED
+    finishing = 0;
+    for (writerCount = 0; writerCount < threads; writerCount++) {
+        if (pthread_create(&writers[writerCount], NULL, writerMain, NULL) != 0) {
+            break;
+        }
+    }
+    return writerCount;
+#else
+    return 0;
+#endif
+}
+
+void frameWriterSubmit(const unsigned char* pixels, int frameNumber) {
+#ifdef FRAME_WRITER_THREADED
+    if (writerCount > 0) {
+        pthread_mutex_lock(&queueLock);
+        if (freeCount == 0) {
+            // Backpressure: the writers are behind and every slot is full
+            double start = monotonicSeconds();
+            while (freeCount == 0) {
+                pthread_cond_wait(&slotFreed, &queueLock);
+            }
+            stats.stalls++;
+            stats.stallSeconds += monotonicSeconds() - start;
+        }
+        int slot = freeSlots[--freeCount];
+        pthread_mutex_unlock(&queueLock);
+
+        copyFlipped(slotPixels[slot], pixels);
+        slotFrame[slot] = frameNumber;
+
+        pthread_mutex_lock(&queueLock);
+        queuedSlots[(queueHead + queueCount) % slotCount] = slot;
+        queueCount++;
+        pthread_cond_signal(&frameQueued);
+        pthread_mutex_unlock(&queueLock);
+        return;
+    }
+#endif
+
+    copyFlipped(slotPixels[0], pixels);
+    writeFn(slotPixels[0], frameWidth, frameHeight, frameNumber, writeUser);
+    stats.frames++;
+}
+
+void frameWriterFinish(FrameWriterStats* result) {
+#ifdef FRAME_WRITER_THREADED
+    pthread_mutex_lock(&queueLock);
+    finishing = 1;
+    pthread_cond_broadcast(&frameQueued);
+    pthread_mutex_unlock(&queueLock);
+    for (int i = 0; i < writerCount; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    writerCount = 0;
+#endif
+    if (result) {
+        *result = stats;
+    }
+    freeQueue();
+}
@@ -0,0 +1,40 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+// Writer threads for captured frames, so file I/O and encoding stay off the
+// render thread. Submitted frames are copied into one of a fixed number of
+// queue slots and written by whichever writer is free. When every slot is
+// waiting on a writer, the disk has fallen behind and frameWriterSubmit
+// blocks until a slot frees up, which bounds memory and slows capture to
+// the speed the writers can keep up with. Without pthreads (Windows) each
+// frame is written on the calling thread.
+
+#define FRAME_WRITER_MAX_THREADS 32
+#define FRAME_WRITER_DEFAULT_QUEUE 8
+
+// Writes one frame: width * height RGB pixels, top row first. Called on a
+// writer thread; frames can finish out of order with more than one writer.
+typedef void (*FrameWriterFn)(const unsigned char* pixels, int width, int height, int frameNumber, void* user);
+
+typedef struct {
+    int frames;           // written
+    int stalls;           // submits that had to wait for a free slot
+    double stallSeconds;  // total time they waited
+} FrameWriterStats;
+
+// Start the writers for frames of width x height. A negative thread count
+// picks one per spare core, and at least one; queueDepth is raised to the
+// thread count if below it. Returns the number of writer threads running
+// (0: frames are written on submit), or -1 if the queue could not be
+// allocated.
+int frameWriterInit(int threads, int queueDepth, int width, int height, FrameWriterFn write, void* user);
+
+// Queue a frame given bottom row first, as glReadPixels returns it. The
+// pixels are copied, top row first, before this returns; it blocks while
+// every slot is still waiting to be written.
+void frameWriterSubmit(const unsigned char* pixels, int frameNumber);
+
+// Write everything queued, stop the writers and free the queue
+void frameWriterFinish(FrameWriterStats* stats);
+
+#endif
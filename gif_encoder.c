@@ -0,0 +1,782 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "gif_encoder.h"
+#include "worker_pool.h"
+
+// Colours are counted in 5-bit-per-channel bins for quantization, keeping
+// the true sums so palette entries are exact means
+#define HISTOGRAM_BINS 32768
+// Nearest palette colour lookups are cached per 6-bit-per-channel cell
+#define NEAREST_CELLS 262144
+// Largest octree: every bin a leaf five levels down
+#define OCTREE_MAX_NODES (1 + 8 + 64 + 512 + 4096 + 32768)
+#define LZW_HASH_SIZE 8192
+// Peak-to-peak amplitude of the ordered dither, in 8-bit levels
+#define DITHER_SPREAD 16
+
+typedef struct {
+    unsigned char* data;
+    size_t size, capacity;
+    int failed;
+} GifBuffer;
+
+typedef struct {
+    unsigned int count, sum[3];
+    int sortKey;
+} ColorBin;
+
+typedef struct {
+    int children[8];  // node indices, 0 for none (the root is never a child)
+    unsigned int count, sum[3];
+    int depth, leaf;
+} OctreeNode;
+
+typedef struct {
+    unsigned int count;
+    int node;
+} OctreeOrder;
+
+struct GifFrame {
+    unsigned char* rgb;
+    const unsigned char* previous;  // NULL for the first frame
+    int delay;                      // centiseconds
+    GifBuffer out;
+
+    // Scratch, kept per batch slot so jobs never share any
+    unsigned int* histogram;  // HISTOGRAM_BINS x count, r, g, b
+    ColorBin* bins;
+    OctreeNode* octree;  // octree quantizer only
+    OctreeOrder* order;
+    short* nearest;     // NEAREST_CELLS palette indices, -1 not yet known
+    int nearestGlobal;  // nearest holds lookups in the global palette
+    unsigned char* indices;
+    int* hashKeys;
+    short* hashCodes;
+    unsigned char palette[256 * 3];
+};
+
+static const unsigned char bayer8[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26}, {12, 44, 4, 36, 14, 46, 6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22}, {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37},  {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+// ---------------------------------------------------------------- buffers
+
+static void bufferPut(GifBuffer* b, const void* bytes, size_t n) {
+    if (b->failed) {
+        return;
+    }
+    if (b->size + n > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 65536;
+        while (capacity < b->size + n) {
+            capacity *= 2;
+        }
+        unsigned char* data = realloc(b->data, capacity);
+        if (!data) {
+            b->failed = 1;
+            return;
+        }
+        b->data = data;
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, bytes, n);
+    b->size += n;
+}
+
+static void bufferByte(GifBuffer* b, int value) {
+    unsigned char byte = (unsigned char)value;
+    bufferPut(b, &byte, 1);
+}
+
+static void bufferWord(GifBuffer* b, int value) {
+    bufferByte(b, value & 255);
+    bufferByte(b, (value >> 8) & 255);
+}
+
+// ------------------------------------------------------------ histograms
+
+static void histogramAdd(unsigned int* histogram, const unsigned char* p) {
+    unsigned int* bin = histogram + 4 * (((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3));
+    bin[0]++;
+    bin[1] += p[0];
+    bin[2] += p[1];
+    bin[3] += p[2];
+}
+
+static int collectBins(const unsigned int* histogram, ColorBin* bins) {
+    int n = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        const unsigned int* bin = histogram + 4 * i;
+        if (bin[0]) {
+            bins[n].count = bin[0];
+            bins[n].sum[0] = bin[1];
+            bins[n].sum[1] = bin[2];
+            bins[n].sum[2] = bin[3];
+            n++;
+        }
+    }
+    return n;
+}
+
+static void setPaletteEntry(unsigned char* entry, unsigned int count, const unsigned int* sum) {
+    for (int ch = 0; ch < 3; ch++) {
+        entry[ch] = (unsigned char)((sum[ch] + count / 2) / count);
+    }
+}
+
+// ------------------------------------------------------------ median cut
+
+typedef struct {
+    int start, end;  // bins[start..end)
+    unsigned int count;
+    int axis, range;
+} ColorBox;
+
+static void measureBox(const ColorBin* bins, ColorBox* box) {
+    int low[3] = {255, 255, 255}, high[3] = {0, 0, 0};
+    box->count = 0;
+    for (int i = box->start; i < box->end; i++) {
+        box->count += bins[i].count;
+        for (int ch = 0; ch < 3; ch++) {
+            int mean = bins[i].sum[ch] / bins[i].count;
+            if (mean < low[ch]) low[ch] = mean;
+            if (mean > high[ch]) high[ch] = mean;
+        }
+    }
+    box->axis = 0;
+    for (int ch = 1; ch < 3; ch++) {
+        if (high[ch] - low[ch] > high[box->axis] - low[box->axis]) {
+            box->axis = ch;
+        }
+    }
+    box->range = high[box->axis] - low[box->axis];
+}
+
+static int compareBins(const void* a, const void* b) {
+    return ((const ColorBin*)a)->sortKey - ((const ColorBin*)b)->sortKey;
+}
+
+// Split the box with the most pixels times spread at its median pixel,
+// across its widest channel, until there are enough boxes
+static int medianCut(ColorBin* bins, int n, unsigned char* palette) {
+    ColorBox boxes[GIF_MAX_COLORS];
+    int boxCount = 1;
+    boxes[0].start = 0;
+    boxes[0].end = n;
+    measureBox(bins, &boxes[0]);
+
+    while (boxCount < GIF_MAX_COLORS) {
+        int best = -1;
+        double bestScore = 0.0;
+        for (int i = 0; i < boxCount; i++) {
+            double score = (double)boxes[i].count * boxes[i].range;
+            if (boxes[i].end - boxes[i].start > 1 && score > bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        ColorBox* box = &boxes[best];
+        for (int i = box->start; i < box->end; i++) {
+            bins[i].sortKey = bins[i].sum[box->axis] / bins[i].count;
+        }
+        qsort(bins + box->start, box->end - box->start, sizeof(ColorBin), compareBins);
+
+        unsigned int below = 0;
+        int split = box->start + 1;
+        for (int i = box->start; i < box->end - 1; i++) {
+            below += bins[i].count;
+            if (below >= box->count / 2) {
+                split = i + 1;
+                break;
+            }
+        }
+        ColorBox* upper = &boxes[boxCount++];
+        upper->start = split;
+        upper->end = box->end;
+        box->end = split;
+        measureBox(bins, box);
+        measureBox(bins, upper);
+    }
+
+    for (int i = 0; i < boxCount; i++) {
+        unsigned int sum[3] = {0, 0, 0};
+        for (int j = boxes[i].start; j < boxes[i].end; j++) {
+            for (int ch = 0; ch < 3; ch++) {
+                sum[ch] += bins[j].sum[ch];
+            }
+        }
+        setPaletteEntry(palette + i * 3, boxes[i].count, sum);
+    }
+    return boxCount;
+}
+
+// ---------------------------------------------------------------- octree
+
+static int compareOrder(const void* a, const void* b) {
+    unsigned int countA = ((const OctreeOrder*)a)->count, countB = ((const OctreeOrder*)b)->count;
+    return countA < countB ? -1 : countA > countB;
+}
+
+static void collectLeaves(const OctreeNode* nodes, int node, unsigned char* palette, int* colors) {
+    if (nodes[node].leaf) {
+        setPaletteEntry(palette + *colors * 3, nodes[node].count, nodes[node].sum);
+        (*colors)++;
+        return;
+    }
+    for (int i = 0; i < 8; i++) {
+        if (nodes[node].children[i]) {
+            collectLeaves(nodes, nodes[node].children[i], palette, colors);
+        }
+    }
+}
+
+// Each bin is a leaf five levels down; the least used nodes of the deepest
+// level are folded into single leaves until few enough remain
+static int octreeQuantize(const ColorBin* bins, int n, OctreeNode* nodes, OctreeOrder* order,
+                          unsigned char* palette) {
+    int nodeCount = 1;
+    memset(&nodes[0], 0, sizeof(OctreeNode));
+    for (int i = 0; i < n; i++) {
+        int rgb[3];
+        for (int ch = 0; ch < 3; ch++) {
+            rgb[ch] = (bins[i].sum[ch] / bins[i].count) >> 3;
+        }
+        int node = 0;
+        for (int depth = 0;; depth++) {
+            nodes[node].count += bins[i].count;
+            for (int ch = 0; ch < 3; ch++) {
+                nodes[node].sum[ch] += bins[i].sum[ch];
+            }
+            if (depth == 5) {
+                nodes[node].leaf = 1;
+                break;
+            }
+            int shift = 4 - depth;
+            int child = (((rgb[0] >> shift) & 1) << 2) | (((rgb[1] >> shift) & 1) << 1) | ((rgb[2] >> shift) & 1);
+            if (!nodes[node].children[child]) {
+                memset(&nodes[nodeCount], 0, sizeof(OctreeNode));
+                nodes[nodeCount].depth = depth + 1;
+                nodes[node].children[child] = nodeCount++;
+            }
+            node = nodes[node].children[child];
+        }
+    }
+
+    int leaves = 0;
+    for (int i = 0; i < nodeCount; i++) {
+        leaves += nodes[i].leaf;
+    }
+    for (int depth = 4; depth >= 0 && leaves > GIF_MAX_COLORS; depth--) {
+        int count = 0;
+        for (int i = 0; i < nodeCount; i++) {
+            if (nodes[i].depth == depth && !nodes[i].leaf) {
+                order[count].count = nodes[i].count;
+                order[count].node = i;
+                count++;
+            }
+        }
+        qsort(order, count, sizeof(OctreeOrder), compareOrder);
+        for (int i = 0; i < count && leaves > GIF_MAX_COLORS; i++) {
+            OctreeNode* node = &nodes[order[i].node];
+            int children = 0;
+            for (int c = 0; c < 8; c++) {
+                children += node->children[c] != 0;
+            }
+            node->leaf = 1;
+            leaves -= children - 1;
+        }
+    }
+
+    int colors = 0;
+    collectLeaves(nodes, 0, palette, &colors);
+    return colors;
+}
+
+static int quantize(GifFrame* f, GifQuantizer quantizer, const unsigned int* histogram, unsigned char* palette) {
+    int n = collectBins(histogram, f->bins);
+    if (n == 0) {
+        memset(palette, 0, 3);
+        return 1;
+    }
+    if (quantizer == GIF_QUANTIZE_OCTREE) {
+        return octreeQuantize(f->bins, n, f->octree, f->order, palette);
+    }
+    return medianCut(f->bins, n, palette);
+}
+
+static int nearestColor(GifFrame* f, const unsigned char* palette, int colors, int r, int g, int b) {
+    int cell = ((r >> 2) << 12) | ((g >> 2) << 6) | (b >> 2);
+    if (f->nearest[cell] >= 0) {
+        return f->nearest[cell];
+    }
+    // Match the cell's centre rather than this pixel, so the cache gives the
+    // same answer whichever pixel filled it
+    r = ((r >> 2) << 2) + 2;
+    g = ((g >> 2) << 2) + 2;
+    b = ((b >> 2) << 2) + 2;
+    int best = 0, bestDistance = 1 << 30;
+    for (int i = 0; i < colors; i++) {
+        int dr = r - palette[i * 3 + 0], dg = g - palette[i * 3 + 1], db = b - palette[i * 3 + 2];
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    f->nearest[cell] = (short)best;
+    return best;
+}
+
+// ------------------------------------------------------------------- LZW
+
+typedef struct {
+    GifBuffer* out;
+    unsigned int bits;
+    int bitCount;
+    unsigned char block[255];
+    int blockSize;
+} BitWriter;
+
+static void flushBlock(BitWriter* w) {
+    if (w->blockSize > 0) {
+        bufferByte(w->out, w->blockSize);
+        bufferPut(w->out, w->block, w->blockSize);
+        w->blockSize = 0;
+    }
+}
+
+static void putCode(BitWriter* w, int code, int size) {
+    w->bits |= (unsigned int)code << w->bitCount;
+    w->bitCount += size;
+    while (w->bitCount >= 8) {
+        w->block[w->blockSize++] = w->bits & 255;
+        w->bits >>= 8;
+        w->bitCount -= 8;
+        if (w->blockSize == 255) {
+            flushBlock(w);
+        }
+    }
+}
+
+// 8-bit indices as GIF image data: the minimum code size, then the codes in
+// sub-blocks of up to 255 bytes. The string table is a hash of
+// (prefix code, next index) pairs and starts over once it holds 4096 codes.
+static void lzwEncode(GifFrame* f, size_t count, GifBuffer* out) {
+    const int clearCode = 256, endCode = 257;
+    int codeSize = 9, lastCode = endCode;
+    BitWriter w = {out, 0, 0, {0}, 0};
+
+    memset(f->hashKeys, -1, LZW_HASH_SIZE * sizeof(int));
+    bufferByte(out, 8);
+    putCode(&w, clearCode, codeSize);
+
+    int prefix = f->indices[0];
+    for (size_t i = 1; i < count; i++) {
+        int next = f->indices[i];
+        int key = (prefix << 8) | next;
+        unsigned int slot = ((unsigned int)key * 2654435761u) >> 19;
+        while (f->hashKeys[slot] != -1 && f->hashKeys[slot] != key) {
+            slot = (slot + 1) & (LZW_HASH_SIZE - 1);
+        }
+        if (f->hashKeys[slot] == key) {
+            prefix = f->hashCodes[slot];
+            continue;
+        }
+
+        putCode(&w, prefix, codeSize);
+        f->hashKeys[slot] = key;
+        f->hashCodes[slot] = (short)++lastCode;
+        if (lastCode >= (1 << codeSize)) {
+            codeSize++;
+        }
+        if (lastCode == 4095) {
+            putCode(&w, clearCode, codeSize);
+            memset(f->hashKeys, -1, LZW_HASH_SIZE * sizeof(int));
+            codeSize = 9;
+            lastCode = endCode;
+        }
+        prefix = next;
+    }
+    putCode(&w, prefix, codeSize);
+    putCode(&w, endCode, codeSize);
+    if (w.bitCount > 0) {
+        w.block[w.blockSize++] = w.bits & 255;
+    }
+    flushBlock(&w);
+    bufferByte(out, 0);
+}
+
+// ---------------------------------------------------------------- frames
+
+static void putImage(GifFrame* f, int left, int top, int width, int height, int transparent,
+                     const unsigned char* localPalette) {
+    GifBuffer* out = &f->out;
+    // Graphic control: leave the frame in place for the next to draw over
+    bufferByte(out, 0x21);
+    bufferByte(out, 0xF9);
+    bufferByte(out, 4);
+    bufferByte(out, (1 << 2) | (transparent ? 1 : 0));
+    bufferWord(out, f->delay);
+    bufferByte(out, GIF_TRANSPARENT_INDEX);
+    bufferByte(out, 0);
+
+    bufferByte(out, 0x2C);
+    bufferWord(out, left);
+    bufferWord(out, top);
+    bufferWord(out, width);
+    bufferWord(out, height);
+    bufferByte(out, localPalette ? 0x87 : 0);
+    if (localPalette) {
+        bufferPut(out, localPalette, 256 * 3);
+    }
+    lzwEncode(f, (size_t)width * height, out);
+}
+
+// Worker pool job: quantize and compress one frame of the batch
+static void encodeFrame(void* ctx, int job) {
+    GifEncoder* ge = ctx;
+    GifFrame* f = &ge->batch[job];
+    const int width = ge->width, height = ge->height;
+    const unsigned char* rgb = f->rgb;
+    const unsigned char* previous = f->previous;
+    f->out.size = 0;
+
+    // The rectangle that changed since the previous frame
+    int left = 0, top = 0, right = width, bottom = height;
+    if (previous) {
+        size_t row = (size_t)width * 3;
+        top = height;
+        bottom = 0;
+        left = width;
+        right = 0;
+        for (int y = 0; y < height; y++) {
+            const unsigned char* a = rgb + y * row;
+            const unsigned char* b = previous + y * row;
+            if (memcmp(a, b, row) == 0) {
+                continue;
+            }
+            if (y < top) top = y;
+            bottom = y + 1;
+            int x0 = 0, x1 = width - 1;
+            while (memcmp(a + x0 * 3, b + x0 * 3, 3) == 0) x0++;
+            while (memcmp(a + x1 * 3, b + x1 * 3, 3) == 0) x1--;
+            if (x0 < left) left = x0;
+            if (x1 + 1 > right) right = x1 + 1;
+        }
+        if (top >= bottom) {
+            // Nothing moved: one transparent pixel holds the frame's delay
+            f->indices[0] = GIF_TRANSPARENT_INDEX;
+            putImage(f, 0, 0, 1, 1, 1, NULL);
+            return;
+        }
+    }
+
+    const unsigned char* palette = ge->palette;
+    int colors = ge->paletteColors;
+    if (ge->options.palette == GIF_PALETTE_FRAME) {
+        memset(f->histogram, 0, HISTOGRAM_BINS * 4 * sizeof(unsigned int));
+        for (int y = top; y < bottom; y++) {
+            for (int x = left; x < right; x++) {
+                size_t i = ((size_t)y * width + x) * 3;
+                if (!previous || memcmp(rgb + i, previous + i, 3) != 0) {
+                    histogramAdd(f->histogram, rgb + i);
+                }
+            }
+        }
+        memset(f->palette, 0, sizeof(f->palette));
+        colors = quantize(f, ge->options.quantizer, f->histogram, f->palette);
+        palette = f->palette;
+        memset(f->nearest, -1, NEAREST_CELLS * sizeof(short));
+        f->nearestGlobal = 0;
+    } else if (!f->nearestGlobal) {
+        memset(f->nearest, -1, NEAREST_CELLS * sizeof(short));
+        f->nearestGlobal = 1;
+    }
+
+    unsigned char* index = f->indices;
+    for (int y = top; y < bottom; y++) {
+        for (int x = left; x < right; x++) {
+            size_t i = ((size_t)y * width + x) * 3;
+            if (previous && memcmp(rgb + i, previous + i, 3) == 0) {
+                *index++ = GIF_TRANSPARENT_INDEX;
+                continue;
+            }
+            int r = rgb[i], g = rgb[i + 1], b = rgb[i + 2];
+            if (ge->options.dither) {
+                int offset = (bayer8[y & 7][x & 7] * 2 - 63) * DITHER_SPREAD / 128;
+                r = r + offset < 0 ? 0 : r + offset > 255 ? 255 : r + offset;
+                g = g + offset < 0 ? 0 : g + offset > 255 ? 255 : g + offset;
+                b = b + offset < 0 ? 0 : b + offset > 255 ? 255 : b + offset;
+            }
+            *index++ = (unsigned char)nearestColor(f, palette, colors, r, g, b);
+        }
+    }
+
+    putImage(f, left, top, right - left, bottom - top, previous != NULL,
+             ge->options.palette == GIF_PALETTE_FRAME ? palette : NULL);
+}
+
+// ------------------------------------------------------------------ file
+
+static void writeBytes(GifEncoder* ge, const void* bytes, size_t n) {
+    if (ge->file && fwrite(bytes, 1, n, ge->file) != n) {
+        ge->failed = 1;
+    }
+    ge->bytes += n;
+}
+
+static void sampleColors(GifEncoder* ge, const unsigned char* rgb, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        histogramAdd(ge->sampleHistogram, rgb + i * 3);
+    }
+    ge->samples++;
+}
+
+static void writeHeader(GifEncoder* ge) {
+    GifBuffer header = {0};
+    bufferPut(&header, "GIF89a", 6);
+    bufferWord(&header, ge->width);
+    bufferWord(&header, ge->height);
+    bufferByte(&header, ge->options.palette == GIF_PALETTE_GLOBAL ? 0xF7 : 0x70);
+    bufferByte(&header, 0);
+    bufferByte(&header, 0);
+    if (ge->options.palette == GIF_PALETTE_GLOBAL) {
+        bufferPut(&header, ge->palette, 256 * 3);
+    }
+    // NETSCAPE2.0: loop forever
+    bufferPut(&header, "\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+    if (header.failed) {
+        ge->failed = 1;
+    } else {
+        writeBytes(ge, header.data, header.size);
+    }
+    free(header.data);
+    ge->headerWritten = 1;
+}
+
+static void encodeBatch(GifEncoder* ge) {
+    if (ge->batchCount == 0) {
+        return;
+    }
+    if (!ge->headerWritten) {
+        if (ge->options.palette == GIF_PALETTE_GLOBAL) {
+            if (!ge->samples) {
+                // No samples at all: fall back to the first frame's colours
+                sampleColors(ge, ge->batch[0].rgb, (size_t)ge->width * ge->height);
+            }
+            memset(ge->palette, 0, sizeof(ge->palette));
+            ge->paletteColors = quantize(&ge->batch[0], ge->options.quantizer, ge->sampleHistogram, ge->palette);
+        }
+        writeHeader(ge);
+    }
+
+    for (int i = 0; i < ge->batchCount; i++) {
+        ge->batch[i].previous = i > 0 ? ge->batch[i - 1].rgb : ge->previous;
+    }
+    workerPoolRun(encodeFrame, ge, ge->batchCount);
+
+    for (int i = 0; i < ge->batchCount; i++) {
+        GifBuffer* out = &ge->batch[i].out;
+        if (out->failed) {
+            ge->failed = 1;
+        } else {
+            writeBytes(ge, out->data, out->size);
+        }
+    }
+
+    // The batch's last frame is the next one's reference; trade buffers
+    // rather than copy it
+    GifFrame* last = &ge->batch[ge->batchCount - 1];
+    if (!ge->previous) {
+        ge->previous = malloc((size_t)ge->width * ge->height * 3);
+        if (!ge->previous) {
+            ge->failed = 1;
+            ge->batchCount = 0;
+            return;
+        }
+    }
+    unsigned char* swap = ge->previous;
+    ge->previous = last->rgb;
+    last->rgb = swap;
+    ge->batchCount = 0;
+}
+
+// ------------------------------------------------------------------- API
+
+void gifOptionsDefault(GifOptions* options) {
+    options->palette = GIF_PALETTE_GLOBAL;
+    options->quantizer = GIF_QUANTIZE_MEDIAN_CUT;
+    options->dither = 0;
+    options->scale = 1;
+}
+
+int gifOption(GifOptions* options, const char* arg) {
+    if (strncmp(arg, "--gif-palette=", 14) == 0) {
+        if (strcmp(arg + 14, "frame") == 0) {
+            options->palette = GIF_PALETTE_FRAME;
+        } else if (strcmp(arg + 14, "global") == 0) {
+            options->palette = GIF_PALETTE_GLOBAL;
+        } else {
+            printf("Unknown GIF palette '%s' (global or frame), using global\n", arg + 14);
+            options->palette = GIF_PALETTE_GLOBAL;
+        }
+    } else if (strncmp(arg, "--gif-quantizer=", 16) == 0) {
+        if (strcmp(arg + 16, "octree") == 0) {
+            options->quantizer = GIF_QUANTIZE_OCTREE;
+        } else if (strcmp(arg + 16, "median-cut") == 0) {
+            options->quantizer = GIF_QUANTIZE_MEDIAN_CUT;
+        } else {
+            printf("Unknown GIF quantizer '%s' (median-cut or octree), using median-cut\n", arg + 16);
+            options->quantizer = GIF_QUANTIZE_MEDIAN_CUT;
+        }
+    } else if (strcmp(arg, "--gif-dither") == 0) {
+        options->dither = 1;
+    } else if (strncmp(arg, "--gif-scale=", 12) == 0) {
+        options->scale = atoi(arg + 12);
+        if (options->scale < 1) {
+            options->scale = 1;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static void freeFrame(GifFrame* f) {
+    free(f->rgb);
+    free(f->out.data);
+    free(f->histogram);
+    free(f->bins);
+    free(f->octree);
+    free(f->order);
+    free(f->nearest);
+    free(f->indices);
+    free(f->hashKeys);
+    free(f->hashCodes);
+}
+
+static int allocFrame(GifFrame* f, size_t pixels, int octree) {
+    memset(f, 0, sizeof(*f));
+    f->rgb = malloc(pixels * 3);
+    f->histogram = malloc(HISTOGRAM_BINS * 4 * sizeof(unsigned int));
+    f->bins = malloc(HISTOGRAM_BINS * sizeof(ColorBin));
+    f->nearest = malloc(NEAREST_CELLS * sizeof(short));
+    f->indices = malloc(pixels);
+    f->hashKeys = malloc(LZW_HASH_SIZE * sizeof(int));
+    f->hashCodes = malloc(LZW_HASH_SIZE * sizeof(short));
+    if (octree) {
+        f->octree = malloc(OCTREE_MAX_NODES * sizeof(OctreeNode));
+        f->order = malloc(OCTREE_MAX_NODES * sizeof(OctreeOrder));
+    }
+    return f->rgb && f->histogram && f->bins && f->nearest && f->indices && f->hashKeys && f->hashCodes &&
+           (!octree || (f->octree && f->order));
+}
+
+int gifEncoderOpen(GifEncoder* ge, const char* path, const GifOptions* options, int width, int height, double fps) {
+    memset(ge, 0, sizeof(*ge));
+    ge->options = *options;
+    ge->sourceWidth = width;
+    ge->sourceHeight = height;
+    ge->width = width / options->scale;
+    ge->height = height / options->scale;
+    ge->fps = fps > 0.0 ? fps : 30.0;
+    if (ge->width < 1 || ge->height < 1 || ge->width > 65535 || ge->height > 65535) {
+        printf("Cannot make a %dx%d GIF\n", ge->width, ge->height);
+        return 0;
+    }
+
+    ge->sampleHistogram = calloc(HISTOGRAM_BINS * 4, sizeof(unsigned int));
+    ge->batchCapacity = workerPoolThreads() + 1;
+    ge->batch = calloc(ge->batchCapacity, sizeof(GifFrame));
+    int ok = ge->sampleHistogram && ge->batch;
+    for (int i = 0; ok && i < ge->batchCapacity; i++) {
+        ok = allocFrame(&ge->batch[i], (size_t)ge->width * ge->height, options->quantizer == GIF_QUANTIZE_OCTREE);
+    }
+    if (ok) {
+        ge->file = fopen(path, "wb");
+        if (!ge->file) {
+            printf("Cannot write %s\n", path);
+        }
+    } else {
+        printf("Cannot allocate the GIF encoder\n");
+    }
+    if (!ge->file) {
+        ge->failed = 1;
+        gifEncoderClose(ge);
+        return 0;
+    }
+    return 1;
+}
+
+void gifEncoderSample(GifEncoder* ge, const unsigned char* rgb) {
+    sampleColors(ge, rgb, (size_t)ge->sourceWidth * ge->sourceHeight);
+}
+
+void gifEncoderAddFrame(GifEncoder* ge, const unsigned char* rgb) {
+    GifFrame* f = &ge->batch[ge->batchCount];
+    int scale = ge->options.scale;
+    if (scale == 1) {
+        memcpy(f->rgb, rgb, (size_t)ge->width * ge->height * 3);
+    } else {
+        // Box filter down to the GIF's size
+        for (int y = 0; y < ge->height; y++) {
+            for (int x = 0; x < ge->width; x++) {
+                int sum[3] = {0, 0, 0};
+                for (int by = 0; by < scale; by++) {
+                    const unsigned char* in = rgb + ((size_t)(y * scale + by) * ge->sourceWidth + x * scale) * 3;
+                    for (int bx = 0; bx < scale * 3; bx += 3) {
+                        sum[0] += in[bx];
+                        sum[1] += in[bx + 1];
+                        sum[2] += in[bx + 2];
+                    }
+                }
+                unsigned char* out = f->rgb + ((size_t)y * ge->width + x) * 3;
+                for (int ch = 0; ch < 3; ch++) {
+                    out[ch] = (unsigned char)((sum[ch] + scale * scale / 2) / (scale * scale));
+                }
+            }
+        }
+    }
+
+    // Delays are whole centiseconds; round the running time so they
+    // average out to the frame rate (3, 4, 3 at 30 fps)
+    int start = (int)(ge->frames * 100.0 / ge->fps + 0.5);
+    int end = (int)((ge->frames + 1) * 100.0 / ge->fps + 0.5);
+    f->delay = end - start;
+    ge->frames++;
+
+    if (++ge->batchCount == ge->batchCapacity) {
+        encodeBatch(ge);
+    }
+}
+
+int gifEncoderClose(GifEncoder* ge) {
+    if (ge->file) {
+        encodeBatch(ge);
+        if (!ge->headerWritten) {
+            writeHeader(ge);
+        }
+        writeBytes(ge, "\x3B", 1);
+        if (fclose(ge->file) != 0) {
+            ge->failed = 1;
+        }
+    }
+    for (int i = 0; ge->batch && i < ge->batchCapacity; i++) {
+        freeFrame(&ge->batch[i]);
+    }
+    free(ge->batch);
+    free(ge->sampleHistogram);
+    free(ge->previous);
+    int ok = !ge->failed;
+    ge->file = NULL;
+    ge->batch = NULL;
+    ge->sampleHistogram = NULL;
+    ge->previous = NULL;
+    return ok;
+}
@@ -0,0 +1,94 @@
+#ifndef GIF_ENCODER_H
+#define GIF_ENCODER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Animated GIF output for captured frames, with no external tools.
+//
+// Colours are reduced to 255 per palette by median cut or an octree, either
+// one global palette, built from sample frames given before the first real
+// one, or one per frame. --gif-dither adds an 8x8 ordered (Bayer) dither
+// before each pixel takes its nearest palette colour, which trades banding
+// in the gradients for a fine fixed pattern. Palette index 255 is kept for
+// transparency: each frame only covers the rectangle that changed since
+// the previous one, and the pixels inside it that did not change are left
+// transparent so the previous frame shows through.
+//
+// Frames are collected in batches and encoded in parallel on the worker
+// pool (worker_pool.h), one frame per job, since with the previous frame
+// at hand each one's quantization, dithering and LZW compression depend on
+// nothing else. The encoded frames are then written out in order.
+
+#define GIF_MAX_COLORS 255
+#define GIF_TRANSPARENT_INDEX 255
+// Frames a capture should draw across its length for a global palette
+#define GIF_PALETTE_SAMPLES 16
+
+typedef enum {
+    GIF_PALETTE_GLOBAL,
+    GIF_PALETTE_FRAME
+} GifPaletteMode;
+
+typedef enum {
+    GIF_QUANTIZE_MEDIAN_CUT,
+    GIF_QUANTIZE_OCTREE
+} GifQuantizer;
+
+typedef struct {
+    GifPaletteMode palette;
+    GifQuantizer quantizer;
+    int dither;
+    int scale;  // shrink frames by this whole factor
+} GifOptions;
+
+typedef struct GifFrame GifFrame;
+
+typedef struct {
+    FILE* file;
+    GifOptions options;
+    int sourceWidth, sourceHeight;
+    int width, height;  // after scaling
+    double fps;
+    int frames;
+    size_t bytes;
+
+    // The global palette, and the colour histogram of the samples for it
+    unsigned int* sampleHistogram;
+    int samples;
+    unsigned char palette[256 * 3];
+    int paletteColors;
+    int headerWritten;
+
+    GifFrame* batch;
+    int batchCapacity, batchCount;
+    unsigned char* previous;  // the last frame of the previous batch, or NULL
+    int failed;
+} GifEncoder;
+
+// Global median-cut palette, no dithering, full size
+void gifOptionsDefault(GifOptions* options);
+
+// Take arg if it is one of the GIF options: --gif-palette=global|frame,
+// --gif-quantizer=median-cut|octree, --gif-dither and --gif-scale=N.
+// Returns 1 if it was.
+int gifOption(GifOptions* options, const char* arg);
+
+// Create path for frames of width x height at fps. Start the worker pool
+// first to encode on more than one core. Returns 0 on failure.
+int gifEncoderOpen(GifEncoder* ge, const char* path, const GifOptions* options, int width, int height, double fps);
+
+// Add a frame's colours to the global palette; only before the first
+// gifEncoderAddFrame. Without samples the palette comes from the first
+// frame alone. Row order does not matter.
+void gifEncoderSample(GifEncoder* ge, const unsigned char* rgb);
+
+// Append a frame of RGB pixels, top row first. Frames are copied; every
+// batchCapacity of them are encoded and written before this returns.
+void gifEncoderAddFrame(GifEncoder* ge, const unsigned char* rgb);
+
+// Encode what is left, finish the file and free everything; bytes and
+// frames stay readable. Returns 0 if writing failed at any point.
+int gifEncoderClose(GifEncoder* ge);
+
+#endif
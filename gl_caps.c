@@ -0,0 +1,55 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+#include "gl_caps.h"
+
+// glGetStringi is a GL 3.0 entry point that neither the Windows opengl32
+// import library nor the macOS legacy headers provide
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define GL_CAPS_INDEXED 1
+#endif
+
+int glCapsVersionAtLeast(int wantMajor, int wantMinor) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int major = 0, minor = 0;
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) {
+        return 0;
+    }
+    return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+}
+
+int glCapsListHas(const char* list, const char* name) {
+    size_t length = strlen(name);
+    for (const char* p = list; p && (p = strstr(p, name)) != NULL; p += length) {
+        if ((p == list || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int glCapsHasExtension(const char* name) {
+#ifdef GL_CAPS_INDEXED
+    if (glCapsVersionAtLeast(3, 0)) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension && strcmp(extension, name) == 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+#endif
+    return glCapsListHas((const char*)glGetString(GL_EXTENSIONS), name);
+}
@@ -0,0 +1,19 @@
+#ifndef GL_CAPS_H
+#define GL_CAPS_H
+
+// What the current OpenGL context supports, for the modules that take a
+// faster path when it is there. Both queries need a current context.
+
+// Whether GL_VERSION is at least major.minor
+int glCapsVersionAtLeast(int major, int minor);
+
+// Whether the context advertises the extension, matched as a whole name.
+// GL 3.0 and later contexts are asked through the indexed list, the only
+// one core profiles have; older ones through the GL_EXTENSIONS string.
+int glCapsHasExtension(const char* name);
+
+// Whether name is one of the words in a space-separated extension list,
+// such as GL_EXTENSIONS or an EGL extension string
+int glCapsListHas(const char* list, const char* name);
+
+#endif
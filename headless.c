@@ -0,0 +1,321 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gl_caps.h"
+#include "headless.h"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define HEADLESS_SUPPORTED 1
+#include <dlfcn.h>
+#endif
+
+#ifdef HEADLESS_SUPPORTED
+// The few EGL and OSMesa definitions used, so building needs neither header
+#define EGL_NONE 0x3038
+#define EGL_EXTENSIONS 0x3055
+#define EGL_SURFACE_TYPE 0x3033
+#define EGL_RENDERABLE_TYPE 0x3040
+#define EGL_OPENGL_BIT 0x0008
+#define EGL_OPENGL_API 0x30A2
+#define EGL_CONTEXT_MAJOR_VERSION 0x3098
+#define EGL_CONTEXT_MINOR_VERSION 0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK 0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT 0x0001
+#define EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT 0x0002
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+
+#define OSMESA_FORMAT 0x22
+#define OSMESA_RGBA GL_RGBA
+#define OSMESA_DEPTH_BITS 0x30
+#define OSMESA_STENCIL_BITS 0x31
+#define OSMESA_PROFILE 0x33
+#define OSMESA_CORE_PROFILE 0x34
+#define OSMESA_COMPAT_PROFILE 0x35
+#define OSMESA_CONTEXT_MAJOR_VERSION 0x36
+#define OSMESA_CONTEXT_MINOR_VERSION 0x37
+
+typedef void* (*EglGetProcAddressFn)(const char* name);
+typedef const char* (*EglQueryStringFn)(void* display, int name);
+typedef void* (*EglGetPlatformDisplayFn)(unsigned int platform, void* nativeDisplay, const int* attribs);
+typedef unsigned int (*EglInitializeFn)(void* display, int* major, int* minor);
+typedef unsigned int (*EglBindApiFn)(unsigned int api);
+typedef unsigned int (*EglChooseConfigFn)(void* display, const int* attribs, void** configs, int size, int* count);
+typedef void* (*EglCreateContextFn)(void* display, void* config, void* share, const int* attribs);
+typedef unsigned int (*EglMakeCurrentFn)(void* display, void* draw, void* read, void* context);
+typedef unsigned int (*EglDestroyContextFn)(void* display, void* context);
+typedef unsigned int (*EglTerminateFn)(void* display);
+
+typedef void* (*OSMesaCreateContextAttribsFn)(const int* attribs, void* share);
+typedef unsigned char (*OSMesaMakeCurrentFn)(void* context, void* buffer, unsigned int type, int width, int height);
+typedef void (*OSMesaDestroyContextFn)(void* context);
+
+static void* openLibrary(const char* const* names) {
+    for (int i = 0; names[i]; i++) {
+        void* library = dlopen(names[i], RTLD_NOW | RTLD_GLOBAL);
+        if (library) {
+            return library;
+        }
+    }
+    return NULL;
+}
+
+static int createEgl(HeadlessContext* h, int major, int minor, int core) {
+    static const char* names[] = {"libEGL.so.1", "libEGL.so", NULL};
+    h->library = openLibrary(names);
+    if (!h->library) {
+        fprintf(stderr, "Headless EGL: libEGL not found\n");
+        return 0;
+    }
+    EglGetProcAddressFn getProcAddress = (EglGetProcAddressFn)dlsym(h->library, "eglGetProcAddress");
+    EglQueryStringFn queryString = (EglQueryStringFn)dlsym(h->library, "eglQueryString");
+    EglInitializeFn initialize = (EglInitializeFn)dlsym(h->library, "eglInitialize");
+    EglBindApiFn bindApi = (EglBindApiFn)dlsym(h->library, "eglBindAPI");
+    EglChooseConfigFn chooseConfig = (EglChooseConfigFn)dlsym(h->library, "eglChooseConfig");
+    EglCreateContextFn createContext = (EglCreateContextFn)dlsym(h->library, "eglCreateContext");
+    EglMakeCurrentFn makeCurrent = (EglMakeCurrentFn)dlsym(h->library, "eglMakeCurrent");
+    if (!getProcAddress || !queryString || !initialize || !bindApi || !chooseConfig || !createContext ||
+        !makeCurrent) {
+        fprintf(stderr, "Headless EGL: libEGL is missing core entry points\n");
+        return 0;
+    }
+
+    // Client extensions are queried without a display
+    const char* clientExtensions = queryString(NULL, EGL_EXTENSIONS);
+    EglGetPlatformDisplayFn getPlatformDisplay =
+        (EglGetPlatformDisplayFn)getProcAddress("eglGetPlatformDisplayEXT");
+    if (!glCapsListHas(clientExtensions, "EGL_MESA_platform_surfaceless") || !getPlatformDisplay) {
+        fprintf(stderr, "Headless EGL: EGL_MESA_platform_surfaceless is not supported\n");
+        return 0;
+    }
+    h->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, NULL, NULL);
+    int eglMajor = 0, eglMinor = 0;
+    if (!h->display || !initialize(h->display, &eglMajor, &eglMinor)) {
+        fprintf(stderr, "Headless EGL: cannot initialize the surfaceless display\n");
+        h->display = NULL;
+        return 0;
+    }
+    if (!glCapsListHas(queryString(h->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        fprintf(stderr, "Headless EGL: EGL_KHR_surfaceless_context is not supported\n");
+        return 0;
+    }
+
+    // No surface is ever created, so any config that renders desktop GL will do
+    const int configAttribs[] = {EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    void* config = NULL;
+    int count = 0;
+    if (!bindApi(EGL_OPENGL_API) || !chooseConfig(h->display, configAttribs, &config, 1, &count) || count < 1) {
+        fprintf(stderr, "Headless EGL: no desktop OpenGL config\n");
+        return 0;
+    }
+
+    int contextAttribs[7] = {EGL_NONE};
+    if (major > 0) {
+        contextAttribs[0] = EGL_CONTEXT_MAJOR_VERSION;
+        contextAttribs[1] = major;
+        contextAttribs[2] = EGL_CONTEXT_MINOR_VERSION;
+        contextAttribs[3] = minor;
+        contextAttribs[4] = EGL_CONTEXT_OPENGL_PROFILE_MASK;
+        contextAttribs[5] =
+            core ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT;
+        contextAttribs[6] = EGL_NONE;
+    }
+    h->context = createContext(h->display, config, NULL, contextAttribs);
+    if (!h->context) {
+        fprintf(stderr, "Headless EGL: cannot create a GL %d.%d context\n", major, minor);
+        return 0;
+    }
+    if (!makeCurrent(h->display, NULL, NULL, h->context)) {
+        fprintf(stderr, "Headless EGL: cannot make the context current\n");
+        return 0;
+    }
+    h->backend = HEADLESS_EGL;
+    return 1;
+}
+
+static int createOsmesa(HeadlessContext* h, int major, int minor, int core) {
+    static const char* names[] = {"libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so", NULL};
+    h->library = openLibrary(names);
+    if (!h->library) {
+        fprintf(stderr, "Headless OSMesa: libOSMesa not found\n");
+        return 0;
+    }
+    OSMesaCreateContextAttribsFn createContext =
+        (OSMesaCreateContextAttribsFn)dlsym(h->library, "OSMesaCreateContextAttribs");
+    OSMesaMakeCurrentFn makeCurrent = (OSMesaMakeCurrentFn)dlsym(h->library, "OSMesaMakeCurrent");
+    if (!createContext || !makeCurrent) {
+        fprintf(stderr, "Headless OSMesa: libOSMesa is too old (needs OSMesaCreateContextAttribs)\n");
+        return 0;
+    }
+
+    int attribs[] = {OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 24, OSMESA_STENCIL_BITS, 8,
+                     OSMESA_PROFILE, core ? OSMESA_CORE_PROFILE : OSMESA_COMPAT_PROFILE,
+                     0, 0, 0, 0, 0};
+    if (major > 0) {
+        attribs[8] = OSMESA_CONTEXT_MAJOR_VERSION;
+        attribs[9] = major;
+        attribs[10] = OSMESA_CONTEXT_MINOR_VERSION;
+        attribs[11] = minor;
+    }
+    h->context = createContext(attribs, NULL);
+    h->buffer = malloc((size_t)h->width * h->height * 4);
+    if (!h->context || !h->buffer) {
+        fprintf(stderr, "Headless OSMesa: cannot create a GL %d.%d context\n", major, minor);
+        return 0;
+    }
+    if (!makeCurrent(h->context, h->buffer, GL_UNSIGNED_BYTE, h->width, h->height)) {
+        fprintf(stderr, "Headless OSMesa: cannot make the context current\n");
+        return 0;
+    }
+    h->backend = HEADLESS_OSMESA;
+
+    // The program's GL calls go through the libGL it was linked with. If
+    // that does not dispatch to OSMesa, nothing is current as far as it knows.
+    if (!glGetString(GL_VERSION)) {
+        fprintf(stderr, "Headless OSMesa: this libGL does not dispatch to OSMesa; rebuild with make OSMESA=1\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int createFramebuffer(HeadlessContext* h) {
+    if (!glCapsVersionAtLeast(3, 0) && !glCapsHasExtension("GL_ARB_framebuffer_object")) {
+        // OSMesa can still draw straight into its own buffer
+        if (h->backend == HEADLESS_OSMESA) {
+            glViewport(0, 0, h->width, h->height);
+            return 1;
+        }
+        fprintf(stderr, "Headless: framebuffer objects are not supported\n");
+        return 0;
+    }
+    glGenRenderbuffers(1, &h->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, h->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, h->width, h->height);
+    glGenRenderbuffers(1, &h->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, h->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, h->width, h->height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &h->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, h->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, h->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, h->depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Headless: the %dx%d framebuffer is incomplete\n", h->width, h->height);
+        return 0;
+    }
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, h->width, h->height);
+    return 1;
+}
+
+// Undo a partly created backend so the next one starts clean
+static void releaseBackend(HeadlessContext* h) {
+    if (h->library) {
+        if (h->display) {
+            EglMakeCurrentFn makeCurrent = (EglMakeCurrentFn)dlsym(h->library, "eglMakeCurrent");
+            EglDestroyContextFn destroyContext = (EglDestroyContextFn)dlsym(h->library, "eglDestroyContext");
+            EglTerminateFn terminate = (EglTerminateFn)dlsym(h->library, "eglTerminate");
+            if (makeCurrent) makeCurrent(h->display, NULL, NULL, NULL);
+            if (h->context && destroyContext) destroyContext(h->display, h->context);
+            if (terminate) terminate(h->display);
+        } else if (h->context) {
+            OSMesaDestroyContextFn destroyContext =
+                (OSMesaDestroyContextFn)dlsym(h->library, "OSMesaDestroyContext");
+            if (destroyContext) destroyContext(h->context);
+        }
+        dlclose(h->library);
+    }
+    free(h->buffer);
+    h->library = NULL;
+    h->display = NULL;
+    h->context = NULL;
+    h->buffer = NULL;
+    h->backend = HEADLESS_NONE;
+}
+#endif
+
+int headlessCreate(HeadlessContext* h, const char* backend, int width, int height, int major, int minor,
+                   int core) {
+    memset(h, 0, sizeof(*h));
+    h->width = width;
+    h->height = height;
+#ifdef HEADLESS_SUPPORTED
+    int automatic = !backend || strcmp(backend, "auto") == 0;
+    if (!automatic && strcmp(backend, "egl") != 0 && strcmp(backend, "osmesa") != 0) {
+        fprintf(stderr, "Unknown headless backend '%s' (expected egl, osmesa or auto)\n", backend);
+        return 0;
+    }
+
+    if (automatic || strcmp(backend, "egl") == 0) {
+        if (createEgl(h, major, minor, core) && createFramebuffer(h)) {
+            return 1;
+        }
+        releaseBackend(h);
+    }
+    if (automatic || strcmp(backend, "osmesa") == 0) {
+        if (createOsmesa(h, major, minor, core) && createFramebuffer(h)) {
+            return 1;
+        }
+        releaseBackend(h);
+    }
+    return 0;
+#else
+    (void)backend;
+    (void)major;
+    (void)minor;
+    (void)core;
+    fprintf(stderr, "Headless rendering is not available on this platform\n");
+    return 0;
+#endif
+}
+
+const char* headlessBackendName(const HeadlessContext* h) {
+    switch (h->backend) {
+        case HEADLESS_EGL:
+            return "egl";
+        case HEADLESS_OSMESA:
+            return "osmesa";
+        default:
+            return "none";
+    }
+}
+
+void headlessFinishFrame(HeadlessContext* h) {
+    (void)h;
+    glFinish();
+}
+
+double headlessTime(void) {
+#ifdef HEADLESS_SUPPORTED
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1.0e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+void headlessDestroy(HeadlessContext* h) {
+#ifdef HEADLESS_SUPPORTED
+    if (h->fbo) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &h->fbo);
+        glDeleteRenderbuffers(1, &h->color);
+        glDeleteRenderbuffers(1, &h->depth);
+        h->fbo = 0;
+    }
+    releaseBackend(h);
+#endif
+}
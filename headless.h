@@ -0,0 +1,57 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// GL contexts with no window system at all, for render farm nodes without
+// an X server. Two backends, picked at runtime:
+//
+//   egl     EGL on Mesa's surfaceless platform (EGL_MESA_platform_surfaceless),
+//           which needs no display connection and drives the GPU or
+//           llvmpipe just like a window would
+//   osmesa  Mesa's off-screen renderer, rendering into client memory on the
+//           CPU. The GL calls must reach it: with a libglvnd libGL they do
+//           not, and creation fails with a hint to link against libOSMesa
+//           (make OSMESA=1) instead.
+//
+// Both libraries are opened with dlopen, so a build needs neither and a
+// windowed run never touches them. Either way the frame is drawn into a
+// framebuffer object (color plus depth/stencil) that stays bound in place
+// of a window's back buffer, so glReadPixels reads the frame back as usual.
+// Code that switches framebuffers must restore the previous binding rather
+// than bind framebuffer 0.
+//
+// Not available on Windows or macOS, where headlessCreate always fails.
+
+typedef enum { HEADLESS_NONE, HEADLESS_EGL, HEADLESS_OSMESA } HeadlessBackend;
+
+typedef struct {
+    HeadlessBackend backend;
+    int width, height;
+
+    void* library;
+    void* display;  // EGL
+    void* context;  // EGL or OSMesa
+    unsigned char* buffer;  // OSMesa's own color buffer, unused behind the FBO
+
+    unsigned int fbo, color, depth;
+} HeadlessContext;
+
+// Create a context and make it current with a width x height framebuffer
+// object bound. backend is "egl", "osmesa", or "auto" / NULL to try EGL and
+// then OSMesa. major 0 takes the newest compatibility context available,
+// otherwise core selects a core or compatibility profile of at least
+// major.minor. Returns 0 and prints why to stderr if no backend works.
+int headlessCreate(HeadlessContext* h, const char* backend, int width, int height, int major, int minor,
+                   int core);
+
+const char* headlessBackendName(const HeadlessContext* h);
+
+// Stands in for the buffer swap: hands the frame to the GPU and waits
+// for it, so per-frame timings cover the drawing as they would on screen
+void headlessFinishFrame(HeadlessContext* h);
+
+// Monotonic seconds, for programs that have no glfwGetTime without GLFW
+double headlessTime(void);
+
+void headlessDestroy(HeadlessContext* h);
+
+#endif
@@ -0,0 +1,136 @@
+#include "idle_governor.h"
+
+#include <time.h>
+
+// How long a minimised window sleeps between checks of glfwWindowShouldClose
+#define IDLE_STATIC_POLL 0.5
+
+// Process CPU time, all threads included. On Windows clock() counts wall
+// time instead, which makes the CPU figures an upper bound there.
+static double processSeconds(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void refreshCallback(GLFWwindow* window) {
+    idleGovernorDamage(glfwGetWindowUserPointer(window));
+}
+
+static void iconifyCallback(GLFWwindow* window, int iconified) {
+    (void)iconified;
+    idleGovernorDamage(glfwGetWindowUserPointer(window));
+}
+
+void idleGovernorInit(IdleGovernor* g, GLFWwindow* window, double idleAfter, double idleFps,
+                      double reportInterval) {
+    double now = glfwGetTime();
+    g->idleAfter = idleAfter;
+    g->idleInterval = idleFps > 0.0 ? 1.0 / idleFps : 0.0;
+    g->reportInterval = reportInterval;
+    g->refreshRate = 60.0;
+    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+    if (mode && mode->refreshRate > 0) {
+        g->refreshRate = mode->refreshRate;
+    }
+
+    g->lastInput = now;
+    g->lastFrame = now;
+    g->damaged = 1;
+    g->woken = 0;
+    g->reportStart = now;
+    g->cpuStart = processSeconds();
+    g->frames = 0;
+    g->throttledFrames = 0;
+    g->asleep = 0.0;
+
+    glfwSetWindowUserPointer(window, g);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    glfwSetWindowIconifyCallback(window, iconifyCallback);
+}
+
+void idleGovernorInput(IdleGovernor* g) {
+    g->lastInput = glfwGetTime();
+    g->woken = 1;
+}
+
+void idleGovernorDamage(IdleGovernor* g) {
+    g->damaged = 1;
+    g->woken = 1;
+}
+
+void idleGovernorWait(IdleGovernor* g, GLFWwindow* window, IdleActivity activity) {
+    double now = glfwGetTime();
+    if (glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
+        activity = IDLE_STATIC;
+    } else if (g->damaged || now - g->lastInput < g->idleAfter) {
+        activity = IDLE_ANIMATING;
+    }
+    g->damaged = 0;
+    g->woken = 0;
+
+    if (activity == IDLE_ANIMATING || (activity == IDLE_SLOW && g->idleInterval <= 0.0)) {
+        g->lastFrame = now;
+        return;
+    }
+
+    // Input and damage callbacks set woken from inside glfwWaitEventsTimeout
+    while (!g->woken && !glfwWindowShouldClose(window)) {
+        double timeout = IDLE_STATIC_POLL;
+        if (activity == IDLE_SLOW) {
+            timeout = g->lastFrame + g->idleInterval - now;
+            if (timeout <= 0.0) {
+                break;
+            }
+        }
+        glfwWaitEventsTimeout(timeout);
+        double after = glfwGetTime();
+        g->asleep += after - now;
+        now = after;
+    }
+    // Woken by input: this frame and the next idleAfter seconds run at full rate
+    if (!g->woken) {
+        g->throttledFrames++;
+    }
+    g->lastFrame = now;
+}
+
+void idleGovernorFrameDone(IdleGovernor* g, FILE* f) {
+    double now = glfwGetTime();
+    g->frames++;
+    if (g->reportInterval > 0.0 && now - g->reportStart >= g->reportInterval) {
+        idleGovernorReport(g, f);
+    }
+}
+
+void idleGovernorReport(IdleGovernor* g, FILE* f) {
+    double now = glfwGetTime();
+    double cpuNow = processSeconds();
+    double wall = now - g->reportStart;
+    if (wall <= 0.0) {
+        return;
+    }
+
+    // Left alone, the time spent asleep would have gone on frames at the
+    // rate achieved while awake (at most the refresh rate), each costing as
+    // much CPU as the frames that were drawn
+    double cpu = cpuNow - g->cpuStart;
+    double perFrame = g->frames > 0 ? cpu / g->frames : 0.0;
+    double awake = wall - g->asleep;
+    double rate = awake > 0.0 ? g->frames / awake : g->refreshRate;
+    if (rate > g->refreshRate) {
+        rate = g->refreshRate;
+    }
+    double skipped = rate * g->asleep;
+    fprintf(f,
+            "idle: %.1f of %.0f fps drawn (%d throttled), asleep %.0f%%, cpu %.1f%% of a core at %.2f ms/frame, "
+            "saving ~%.1f%% of a core\n",
+            g->frames / wall, g->refreshRate, g->throttledFrames, 100.0 * g->asleep / wall, 100.0 * cpu / wall,
+            perFrame * 1000.0, 100.0 * skipped * perFrame / wall);
+    fflush(f);
+
+    g->reportStart = now;
+    g->cpuStart = cpuNow;
+    g->frames = 0;
+    g->throttledFrames = 0;
+    g->asleep = 0.0;
+}
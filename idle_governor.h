@@ -0,0 +1,63 @@
+#ifndef IDLE_GOVERNOR_H
+#define IDLE_GOVERNOR_H
+
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+
+// Decides how often an always-on visual needs to redraw. Each frame the
+// program says how lively its scene is; while nobody has touched the window
+// for idleAfter seconds, gentle scenes drop to idleFps and a minimised
+// window stops drawing altogether. The wait happens in
+// glfwWaitEventsTimeout, so input (reported through idleGovernorInput)
+// wakes it at once and the next frame is drawn at full rate.
+
+#define IDLE_DEFAULT_FPS 20.0
+#define IDLE_DEFAULT_AFTER 10.0  // seconds
+#define IDLE_DEFAULT_REPORT 10.0  // seconds between --idle-stats lines
+
+typedef enum {
+    IDLE_ANIMATING,  // fast or attention-grabbing motion: draw every frame
+    IDLE_SLOW,  // only slow motion that still reads well at idleFps
+    IDLE_STATIC  // nothing changes until input or damage
+} IdleActivity;
+
+typedef struct {
+    double idleAfter;  // seconds without input before throttling
+    double idleInterval;  // frame interval while throttled, 0 to never throttle slow scenes
+    double reportInterval;  // seconds between stats lines, 0 for none
+    double refreshRate;  // what the display would draw unthrottled
+
+    double lastInput;
+    double lastFrame;  // when the latest frame started
+    int damaged;  // redraw once at full rate, e.g. after a resize or expose
+    int woken;  // input arrived while waiting
+
+    // Since the last report
+    double reportStart;
+    double cpuStart;
+    int frames;
+    int throttledFrames;
+    double asleep;
+} IdleGovernor;
+
+// idleFps <= 0 keeps slow scenes at full rate. Installs refresh and
+// iconify callbacks on window to track damage.
+void idleGovernorInit(IdleGovernor* g, GLFWwindow* window, double idleAfter, double idleFps,
+                      double reportInterval);
+
+// Call from every input callback
+void idleGovernorInput(IdleGovernor* g);
+
+// Something visible changed without input (resize, state toggled by a timer)
+void idleGovernorDamage(IdleGovernor* g);
+
+// Block until the next frame is due
+void idleGovernorWait(IdleGovernor* g, GLFWwindow* window, IdleActivity activity);
+
+// Count a drawn frame and print a stats line when one is due
+void idleGovernorFrameDone(IdleGovernor* g, FILE* f);
+
+// Print the stats gathered since the last line
+void idleGovernorReport(IdleGovernor* g, FILE* f);
+
+#endif
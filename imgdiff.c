@@ -0,0 +1,203 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Compares a rendered frame with a golden image the way a viewer would see
+// the difference, for the regression harness (regress.sh). Both are binary
+// PPMs. A frame larger than the golden by a whole factor is box-filtered
+// down to its size first, so single-pixel edge and rasterisation noise
+// averages out, and the pixels are compared in CIELAB, where a distance
+// (delta E) of about 2.3 is the smallest difference most people can see.
+//
+// The frame passes while the mean delta E stays under --mean (1.0) and no
+// more than --share percent (0.5) of the pixels differ by over --threshold
+// (10), so a shifted wave or a missing orb fails but driver rounding does
+// not. --diff=FILE writes the per-pixel delta E as a grey PPM, 10x
+// brightened, to show where a failure is. --scale=N writes the frame
+// shrunk by N instead of comparing, which is how goldens are made.
+
+typedef struct {
+    int width, height;
+    unsigned char* rgb;
+} Image;
+
+int readImage(const char* path, Image* image) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("imgdiff: cannot read %s\n", path);
+        return 0;
+    }
+    int maxValue = 0;
+    if (fscanf(f, "P6 %d %d %d", &image->width, &image->height, &maxValue) != 3 || maxValue != 255 ||
+        image->width <= 0 || image->height <= 0 || fgetc(f) == EOF) {
+        printf("imgdiff: %s is not an 8-bit binary PPM\n", path);
+        fclose(f);
+        return 0;
+    }
+    size_t bytes = (size_t)image->width * image->height * 3;
+    image->rgb = malloc(bytes);
+    if (!image->rgb || fread(image->rgb, 1, bytes, f) != bytes) {
+        printf("imgdiff: %s is truncated\n", path);
+        free(image->rgb);
+        image->rgb = NULL;
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+    return 1;
+}
+
+int writeImage(const char* path, const Image* image) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        printf("imgdiff: cannot write %s\n", path);
+        return 0;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", image->width, image->height);
+    fwrite(image->rgb, 1, (size_t)image->width * image->height * 3, f);
+    fclose(f);
+    return 1;
+}
+
+// Average each factor x factor block into one pixel
+int shrinkImage(const Image* in, int factor, Image* out) {
+    out->width = in->width / factor;
+    out->height = in->height / factor;
+    out->rgb = malloc((size_t)out->width * out->height * 3);
+    if (!out->rgb) {
+        return 0;
+    }
+    for (int y = 0; y < out->height; y++) {
+        for (int x = 0; x < out->width; x++) {
+            for (int ch = 0; ch < 3; ch++) {
+                int sum = 0;
+                for (int by = 0; by < factor; by++) {
+                    const unsigned char* row = in->rgb + ((size_t)(y * factor + by) * in->width + x * factor) * 3;
+                    for (int bx = 0; bx < factor; bx++) {
+                        sum += row[bx * 3 + ch];
+                    }
+                }
+                out->rgb[((size_t)y * out->width + x) * 3 + ch] = (sum + factor * factor / 2) / (factor * factor);
+            }
+        }
+    }
+    return 1;
+}
+
+// sRGB bytes to CIELAB under D65
+void toLab(const unsigned char* rgb, float lab[3]) {
+    float linear[3];
+    for (int ch = 0; ch < 3; ch++) {
+        float c = rgb[ch] / 255.0f;
+        linear[ch] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    float xyz[3] = {
+        (0.4124f * linear[0] + 0.3576f * linear[1] + 0.1805f * linear[2]) / 0.95047f,
+        0.2126f * linear[0] + 0.7152f * linear[1] + 0.0722f * linear[2],
+        (0.0193f * linear[0] + 0.1192f * linear[1] + 0.9505f * linear[2]) / 1.08883f,
+    };
+    for (int i = 0; i < 3; i++) {
+        xyz[i] = xyz[i] > 0.008856f ? cbrtf(xyz[i]) : 7.787f * xyz[i] + 16.0f / 116.0f;
+    }
+    lab[0] = 116.0f * xyz[1] - 16.0f;
+    lab[1] = 500.0f * (xyz[0] - xyz[1]);
+    lab[2] = 200.0f * (xyz[1] - xyz[2]);
+}
+
+int main(int argc, char* argv[]) {
+    double meanLimit = 1.0;
+    double shareLimit = 0.5;
+    double threshold = 10.0;
+    int scale = 0;
+    const char* diffPath = NULL;
+    const char* paths[2] = {NULL, NULL};
+    int pathCount = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--mean=", 7) == 0) {
+            meanLimit = atof(argv[i] + 7);
+        } else if (strncmp(argv[i], "--share=", 8) == 0) {
+            shareLimit = atof(argv[i] + 8);
+        } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--scale=", 8) == 0) {
+            scale = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--diff=", 7) == 0) {
+            diffPath = argv[i] + 7;
+        } else if (pathCount < 2) {
+            paths[pathCount++] = argv[i];
+        }
+    }
+    if (pathCount != 2) {
+        printf("Usage: imgdiff [--mean=DE] [--share=PERCENT] [--threshold=DE] [--diff=FILE] frame.ppm golden.ppm\n");
+        printf("       imgdiff --scale=N frame.ppm golden.ppm\n");
+        return 2;
+    }
+
+    Image frame, golden;
+    if (!readImage(paths[0], &frame)) {
+        return 2;
+    }
+
+    if (scale > 0) {
+        if (!shrinkImage(&frame, scale, &golden) || !writeImage(paths[1], &golden)) {
+            return 2;
+        }
+        printf("imgdiff: wrote %s, %dx%d\n", paths[1], golden.width, golden.height);
+        return 0;
+    }
+
+    if (!readImage(paths[1], &golden)) {
+        return 2;
+    }
+    int factor = frame.width / golden.width;
+    if (factor < 1 || frame.width != golden.width * factor || frame.height != golden.height * factor) {
+        printf("imgdiff: %s is %dx%d, which does not shrink to the golden's %dx%d\n", paths[0], frame.width,
+               frame.height, golden.width, golden.height);
+        return 1;
+    }
+    if (factor > 1) {
+        Image shrunk;
+        if (!shrinkImage(&frame, factor, &shrunk)) {
+            return 2;
+        }
+        free(frame.rgb);
+        frame = shrunk;
+    }
+
+    Image diff = {golden.width, golden.height, NULL};
+    if (diffPath) {
+        diff.rgb = malloc((size_t)diff.width * diff.height * 3);
+    }
+    int pixels = golden.width * golden.height;
+    int over = 0;
+    double total = 0.0, worst = 0.0;
+    for (int i = 0; i < pixels; i++) {
+        float a[3], b[3];
+        toLab(frame.rgb + (size_t)i * 3, a);
+        toLab(golden.rgb + (size_t)i * 3, b);
+        double deltaE = sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) +
+                             (a[2] - b[2]) * (a[2] - b[2]));
+        total += deltaE;
+        if (deltaE > worst) worst = deltaE;
+        if (deltaE > threshold) over++;
+        if (diff.rgb) {
+            unsigned char grey = deltaE * 10.0 > 255.0 ? 255 : (unsigned char)(deltaE * 10.0);
+            memset(diff.rgb + (size_t)i * 3, grey, 3);
+        }
+    }
+    if (diff.rgb) {
+        writeImage(diffPath, &diff);
+    }
+
+    double mean = total / pixels;
+    double share = 100.0 * over / pixels;
+    int pass = mean <= meanLimit && share <= shareLimit;
+    printf("imgdiff: mean dE %.2f (limit %.2f), %.2f%% of pixels over %.0f (limit %.2f%%), worst %.1f: %s\n", mean,
+           meanLimit, share, threshold, shareLimit, worst, pass ? "ok" : "CHANGED");
+
+    free(frame.rgb);
+    free(golden.rgb);
+    free(diff.rgb);
+    return pass ? 0 : 1;
+}
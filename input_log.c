@@ -0,0 +1,253 @@
+#include "input_log.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static const char inputLogMagic[8] = {'P', 'E', 'A', 'C', 'E', 'I', 'N', 'P'};
+
+enum {
+    RECORD_FRAME = 1,
+    RECORD_CURSOR,
+    RECORD_BUTTON,
+    RECORD_SCROLL,
+    RECORD_KEY,
+    RECORD_RESIZE,
+};
+
+// Fixed little-endian encoding, so a log replays on any machine
+
+static void putU8(FILE* f, int v) {
+    fputc(v & 0xff, f);
+}
+
+static void putU32(FILE* f, uint32_t v) {
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(v >> (i * 8));
+    }
+    fwrite(bytes, 1, 4, f);
+}
+
+static void putF64(FILE* f, double v) {
+    uint64_t bits;
+    unsigned char bytes[8];
+    memcpy(&bits, &v, 8);
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(bits >> (i * 8));
+    }
+    fwrite(bytes, 1, 8, f);
+}
+
+static int getU8(FILE* f, int* v) {
+    int c = fgetc(f);
+    if (c == EOF) {
+        return 0;
+    }
+    *v = c;
+    return 1;
+}
+
+static int getU32(FILE* f, uint32_t* v) {
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, f) != 4) {
+        return 0;
+    }
+    *v = 0;
+    for (int i = 0; i < 4; i++) {
+        *v |= (uint32_t)bytes[i] << (i * 8);
+    }
+    return 1;
+}
+
+static int getI32(FILE* f, int* v) {
+    uint32_t u;
+    if (!getU32(f, &u)) {
+        return 0;
+    }
+    *v = (int32_t)u;
+    return 1;
+}
+
+static int getF64(FILE* f, double* v) {
+    unsigned char bytes[8];
+    if (fread(bytes, 1, 8, f) != 8) {
+        return 0;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+        bits |= (uint64_t)bytes[i] << (i * 8);
+    }
+    memcpy(v, &bits, 8);
+    return 1;
+}
+
+int inputLogRecord(InputLog* log, const char* path, double (*clock)(void)) {
+    memset(log, 0, sizeof(*log));
+    log->file = fopen(path, "wb");
+    if (!log->file) {
+        fprintf(stderr, "Cannot write input log %s\n", path);
+        return 0;
+    }
+    fwrite(inputLogMagic, 1, sizeof(inputLogMagic), log->file);
+    log->clock = clock;
+    log->startTime = clock();
+    putU32(log->file, INPUT_LOG_VERSION);
+    putF64(log->file, log->startTime);
+    log->mode = INPUT_LOG_RECORDING;
+    return 1;
+}
+
+int inputLogReplay(InputLog* log, const char* path) {
+    memset(log, 0, sizeof(*log));
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open input log %s\n", path);
+        return 0;
+    }
+
+    char magic[sizeof(inputLogMagic)];
+    uint32_t version = 0;
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, inputLogMagic, sizeof(magic)) != 0 ||
+        !getU32(f, &version) || !getF64(f, &log->startTime)) {
+        fprintf(stderr, "%s is not an input log\n", path);
+        fclose(f);
+        return 0;
+    }
+    if (version != INPUT_LOG_VERSION) {
+        fprintf(stderr, "%s is input log version %u, expected %d\n", path, version, INPUT_LOG_VERSION);
+        fclose(f);
+        return 0;
+    }
+    log->file = f;
+    log->time = log->startTime;
+    log->mode = INPUT_LOG_REPLAYING;
+    return 1;
+}
+
+// Dispatch one event record. Returns 0 if it is cut short.
+static int replayEvent(InputLog* log, int type, GLFWwindow* window, const InputLogHandlers* h) {
+    FILE* f = log->file;
+    double x, y;
+    int a, b, c, d;
+    if (!getF64(f, &log->time)) {
+        return 0;
+    }
+    switch (type) {
+        case RECORD_CURSOR:
+            if (!getF64(f, &x) || !getF64(f, &y)) return 0;
+            if (h->cursor) h->cursor(window, x, y);
+            break;
+        case RECORD_BUTTON:
+            if (!getU8(f, &a) || !getU8(f, &b) || !getU8(f, &c) || !getF64(f, &x) || !getF64(f, &y)) return 0;
+            if (h->button) h->button(window, a, b, c, x, y);
+            break;
+        case RECORD_SCROLL:
+            if (!getF64(f, &x) || !getF64(f, &y)) return 0;
+            if (h->scroll) h->scroll(window, x, y);
+            break;
+        case RECORD_KEY:
+            if (!getI32(f, &a) || !getI32(f, &b) || !getU8(f, &c) || !getU8(f, &d)) return 0;
+            if (h->key) h->key(window, a, b, c, d);
+            break;
+        case RECORD_RESIZE:
+            if (!getI32(f, &a) || !getI32(f, &b)) return 0;
+            if (h->resize) h->resize(window, a, b);
+            break;
+        default:
+            fprintf(stderr, "Unknown input log record %d after frame %d\n", type, log->frames);
+            return 0;
+    }
+    log->events++;
+    return 1;
+}
+
+int inputLogFrame(InputLog* log, GLFWwindow* window, const InputLogHandlers* handlers, double* time) {
+    if (log->mode == INPUT_LOG_RECORDING) {
+        putU8(log->file, RECORD_FRAME);
+        putF64(log->file, *time);
+        log->frames++;
+        return 1;
+    }
+    if (log->mode != INPUT_LOG_REPLAYING) {
+        return 1;
+    }
+
+    int type;
+    while (getU8(log->file, &type)) {
+        if (type == RECORD_FRAME) {
+            if (!getF64(log->file, &log->time)) {
+                break;
+            }
+            *time = log->time;
+            log->frames++;
+            return 1;
+        }
+        if (!replayEvent(log, type, window, handlers)) {
+            break;
+        }
+    }
+    return 0;
+}
+
+void inputLogCursor(InputLog* log, double x, double y) {
+    if (log->mode == INPUT_LOG_RECORDING) {
+        putU8(log->file, RECORD_CURSOR);
+        putF64(log->file, log->clock());
+        putF64(log->file, x);
+        putF64(log->file, y);
+        log->events++;
+    }
+}
+
+void inputLogButton(InputLog* log, int button, int action, int mods, double x, double y) {
+    if (log->mode == INPUT_LOG_RECORDING) {
+        putU8(log->file, RECORD_BUTTON);
+        putF64(log->file, log->clock());
+        putU8(log->file, button);
+        putU8(log->file, action);
+        putU8(log->file, mods);
+        putF64(log->file, x);
+        putF64(log->file, y);
+        log->events++;
+    }
+}
+
+void inputLogScroll(InputLog* log, double xoffset, double yoffset) {
+    if (log->mode == INPUT_LOG_RECORDING) {
+        putU8(log->file, RECORD_SCROLL);
+        putF64(log->file, log->clock());
+        putF64(log->file, xoffset);
+        putF64(log->file, yoffset);
+        log->events++;
+    }
+}
+
+void inputLogKey(InputLog* log, int key, int scancode, int action, int mods) {
+    if (log->mode == INPUT_LOG_RECORDING) {
+        putU8(log->file, RECORD_KEY);
+        putF64(log->file, log->clock());
+        putU32(log->file, (uint32_t)key);
+        putU32(log->file, (uint32_t)scancode);
+        putU8(log->file, action);
+        putU8(log->file, mods);
+        log->events++;
+    }
+}
+
+void inputLogResize(InputLog* log, int width, int height) {
+    if (log->mode == INPUT_LOG_RECORDING) {
+        putU8(log->file, RECORD_RESIZE);
+        putF64(log->file, log->clock());
+        putU32(log->file, (uint32_t)width);
+        putU32(log->file, (uint32_t)height);
+        log->events++;
+    }
+}
+
+void inputLogClose(InputLog* log) {
+    if (log->file) {
+        fclose(log->file);
+    }
+    log->file = NULL;
+    log->mode = INPUT_LOG_OFF;
+}
@@ -0,0 +1,75 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+
+// Input recording and replay. While recording, each frame's clock reading
+// and every input event, stamped with the clock when it arrived, go into a
+// compact binary log. Replaying feeds the same events back at the same
+// points in the frame sequence, and the program reads its clock from the
+// log instead of wall time. Two replays of a log therefore drive a program
+// through identical frames, so profiles and before/after comparisons see
+// exactly the same interaction.
+//
+// The log is a header (magic, version, clock at the start) followed by
+// records of a type byte, the clock reading and a fixed payload, all
+// little-endian:
+//
+//   frame   f64 time
+//   cursor  f64 time, f64 x, f64 y
+//   button  f64 time, u8 button, u8 action, u8 mods, f64 x, f64 y
+//   scroll  f64 time, f64 xoffset, f64 yoffset
+//   key     f64 time, i32 key, i32 scancode, u8 action, u8 mods
+//   resize  f64 time, i32 width, i32 height (framebuffer)
+//
+// Events recorded after frame N's record are replayed just before frame
+// N + 1, which is when the live program saw them.
+
+#define INPUT_LOG_VERSION 1
+
+typedef enum { INPUT_LOG_OFF, INPUT_LOG_RECORDING, INPUT_LOG_REPLAYING } InputLogMode;
+
+// What replay calls for each event. Button events carry the cursor position
+// at the click, since the handler cannot ask GLFW for it. Unused entries may
+// be NULL.
+typedef struct {
+    void (*cursor)(GLFWwindow* window, double x, double y);
+    void (*button)(GLFWwindow* window, int button, int action, int mods, double x, double y);
+    void (*scroll)(GLFWwindow* window, double xoffset, double yoffset);
+    void (*key)(GLFWwindow* window, int key, int scancode, int action, int mods);
+    void (*resize)(GLFWwindow* window, int width, int height);
+} InputLogHandlers;
+
+typedef struct {
+    FILE* file;
+    InputLogMode mode;
+    double (*clock)(void);  // stamps events while recording
+    double startTime;  // the clock when recording began
+    double time;  // while replaying, the clock of the latest record
+    int frames;
+    int events;
+} InputLog;
+
+// Both return 0, and leave the log off, if the file cannot be opened or is
+// not an input log, and print why to stderr. A replay starts with time at
+// the recording's startTime.
+int inputLogRecord(InputLog* log, const char* path, double (*clock)(void));
+int inputLogReplay(InputLog* log, const char* path);
+
+// Call at the start of every frame with the frame's clock reading. Recording
+// logs it; replaying first dispatches the events due before this frame,
+// each with time set to when it arrived, then replaces *time with the
+// recorded reading. Returns 0 once a replay runs out of frames.
+int inputLogFrame(InputLog* log, GLFWwindow* window, const InputLogHandlers* handlers, double* time);
+
+// Call from the GLFW callbacks. They do nothing unless recording.
+void inputLogCursor(InputLog* log, double x, double y);
+void inputLogButton(InputLog* log, int button, int action, int mods, double x, double y);
+void inputLogScroll(InputLog* log, double xoffset, double yoffset);
+void inputLogKey(InputLog* log, int key, int scancode, int action, int mods);
+void inputLogResize(InputLog* log, int width, int height);
+
+void inputLogClose(InputLog* log);
+
+#endif
@@ -3,105 +3,230 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+
+#include "headless.h"
+#include "input_log.h"
+#include "shader_program.h"
+#include "snapshot.h"
+#include "wave_interaction.h"
+#include "wave_presets.h"
+#include "wave_shader.h"
 
 float zoomLevel = 1.0f;
+WaveInteractions interactions;
+
+// --snapshot=FILE draws a fixed-time frame for the regression harness
+// (snapshot.h); --headless, which needs it, does so with no window
+Snapshot snapshot;
+HeadlessContext headless;
+
+// --record=FILE logs live input with each frame's clock; --replay=FILE
+// ignores live input and drives the same handlers, and the clock, from a log
+InputLog inputLog;
 
-const char* vertexShaderSource = "#version 330 core\n"
-    "layout (location = 0) in vec3 aPos;\n"
-    "out vec2 TexCoord;\n"
-    "uniform float zoom;\n"
-    "void main() {\n"
-    "   gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);\n"
-    "   TexCoord = aPos.xy / zoom;\n"
-    "}\n";
-
-const char* fragmentShaderSource = "#version 330 core\n"
-    "out vec4 FragColor;\n"
-    "in vec2 TexCoord;\n"
-    "uniform float time;\n"
-    "uniform float zoom;\n"
-    "void main() {\n"
-    "   vec2 pos = TexCoord;\n"
-    "   float wave = sin(pos.x * 3.0 + time) * 0.15;\n"
-    "   wave += sin(pos.x * 5.0 - time * 0.8) * 0.08;\n"
-    "   wave += sin(pos.x * 7.0 + time * 1.2) * 0.04;\n"
-    "   wave += sin(pos.x * 2.0 + pos.y * 4.0 + time * 0.5) * 0.05;\n"
-    "   float waveY = pos.y + wave;\n"
-    "   \n"
-    "   float gradient = (waveY + 1.0) * 0.5;\n"
-    "   vec3 deepBlue = vec3(0.1, 0.3, 0.6);\n"
-    "   vec3 skyBlue = vec3(0.53, 0.81, 0.92);\n"
-    "   vec3 lavender = vec3(0.9, 0.8, 1.0);\n"
-    "   vec3 peach = vec3(1.0, 0.85, 0.7);\n"
-    "   \n"
-    "   vec3 color = mix(deepBlue, skyBlue, gradient);\n"
-    "   color = mix(color, lavender, gradient * gradient);\n"
-    "   color = mix(color, peach, sin(time * 0.3 + pos.x * 0.5) * 0.15 + 0.15);\n"
-    "   \n"
-    "   // Add wave distortion to create flowing effect\n"
-    "   float intensity = 1.0 - smoothstep(-0.5, 0.5, abs(waveY));\n"
-    "   color = mix(color * 0.8, color * 1.2, intensity);\n"
-    "   \n"
-    "   FragColor = vec4(color, 1.0);\n"
-    "}\n";
+// Wall time, from GLFW or, when it is not running, the headless clock
+double wallClock() {
+    return headless.backend != HEADLESS_NONE ? headlessTime() : glfwGetTime();
+}
+
+// The clock reading the current frame is drawn at
+double currentTime() {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return inputLog.time;
+    }
+    return snapshot.path ? snapshotClock(&snapshot) : wallClock();
+}
+
+// Uniforms, in the order of shaderUniforms
+enum { UNIFORM_TIME, UNIFORM_ZOOM, UNIFORM_ASPECT };
+const char* const shaderUniforms[] = {"time", "zoom", "aspect", NULL};
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    inputLogResize(&inputLog, width, height);
     glViewport(0, 0, width, height);
 }
 
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+void applyScroll(GLFWwindow* window, double xoffset, double yoffset) {
     zoomLevel += (float)yoffset * 0.1f;
     if (zoomLevel < 0.5f) zoomLevel = 0.5f;
     if (zoomLevel > 3.0f) zoomLevel = 3.0f;
 }
 
-unsigned int compileShader(unsigned int type, const char* source) {
-    unsigned int shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogScroll(&inputLog, xoffset, yoffset);
+    applyScroll(window, xoffset, yoffset);
+}
+
+// The zoom uniform: how far the view reaches from the centre
+float viewScale() {
+    return 1.0f / zoomLevel;
+}
 
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        printf("Shader compilation failed: %s\n", infoLog);
+// Window coordinates to the shader's view coordinates (wavePos)
+void cursorToView(GLFWwindow* window, double xpos, double ypos, float* x, float* y) {
+    int width = headless.width, height = headless.height;
+    if (window) {
+        glfwGetWindowSize(window, &width, &height);
     }
+    if (width <= 0 || height <= 0) {
+        *x = *y = 0.0f;
+        return;
+    }
+    *x = ((float)(xpos / width) * 2.0f - 1.0f) * viewScale();
+    *y = (1.0f - (float)(ypos / height) * 2.0f) * viewScale();
+}
 
-    return shader;
+// Left: ripple and whirlpool, right: freeze and ice crystal
+void applyButton(GLFWwindow* window, int button, int action, int mods, double xpos, double ypos) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT && button != GLFW_MOUSE_BUTTON_RIGHT) {
+        return;
+    }
+    float x, y;
+    cursorToView(window, xpos, ypos, &x, &y);
+    waveInteractionsButton(&interactions, button == GLFW_MOUSE_BUTTON_LEFT ? 0 : 1, action == GLFW_PRESS, x, y,
+                           currentTime());
 }
 
-int main() {
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
-        return -1;
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
     }
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    inputLogButton(&inputLog, button, action, mods, xpos, ypos);
+    applyButton(window, button, action, mods, xpos, ypos);
+}
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+void applyCursor(GLFWwindow* window, double xpos, double ypos) {
+    float x, y;
+    cursorToView(window, xpos, ypos, &x, &y);
+    waveInteractionsDrag(&interactions, x, y);
+}
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
-    if (!window) {
-        printf("Failed to create window\n");
-        glfwTerminate();
+void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogCursor(&inputLog, xpos, ypos);
+    applyCursor(window, xpos, ypos);
+}
+
+// Pointer positions in a log only mean the same thing at the same size
+void replayResize(GLFWwindow* window, int width, int height) {
+    static int warned = 0;
+    int currentWidth = headless.width, currentHeight = headless.height;
+    if (window) {
+        glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
+    }
+    if (!warned && (width != currentWidth || height != currentHeight)) {
+        fprintf(stderr, "Input log was recorded at %dx%d, replaying at %dx%d\n", width, height, currentWidth,
+                currentHeight);
+        warned = 1;
+    }
+}
+
+const InputLogHandlers replayHandlers = {applyCursor, applyButton, applyScroll, NULL, replayResize};
+
+int main(int argc, char* argv[]) {
+    // --shader-cache=DIR keeps linked program binaries there (empty: off)
+    // --record=FILE / --replay=FILE log live input or replay it (input_log.h)
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    snapshotInit(&snapshot);
+    int headlessMode = 0;
+    const char* headlessBackend = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--shader-cache=", 15) == 0) {
+            shaderCacheSetDirectory(argv[i] + 15);
+        } else if (snapshotOption(&snapshot, argv[i])) {
+            continue;
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            recordPath = argv[i] + 9;
+        } else if (strncmp(argv[i], "--replay=", 9) == 0) {
+            replayPath = argv[i] + 9;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = 1;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessMode = 1;
+            headlessBackend = argv[i] + 11;
+        }
+    }
+
+    // Without a window only the end of the log or the snapshot can end the
+    // run
+    if (headlessMode && !replayPath && !snapshot.path) {
+        printf("--headless needs --replay or --snapshot\n");
         return -1;
     }
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    // Headless runs never start GLFW and leave window NULL
+    GLFWwindow* window = NULL;
+    if (headlessMode) {
+        if (!headlessCreate(&headless, headlessBackend, 800, 600, 3, 3, 1)) {
+            printf("Failed to create a headless context\n");
+            return -1;
+        }
+    } else {
+        if (!glfwInit()) {
+            printf("Failed to initialize GLFW\n");
+            return -1;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (snapshot.path) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+
+        window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
+        if (!window) {
+            printf("Failed to create window\n");
+            glfwTerminate();
+            return -1;
+        }
 
-    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetCursorPosCallback(window, cursor_position_callback);
+        if (snapshot.path) {
+            glfwSwapInterval(0);
+        }
+    }
+    if (replayPath) {
+        inputLogReplay(&inputLog, replayPath);
+    } else if (recordPath) {
+        inputLogRecord(&inputLog, recordPath, currentTime);
+    }
+    if (headlessMode && inputLog.mode != INPUT_LOG_REPLAYING && !snapshot.path) {
+        headlessDestroy(&headless);
+        return -1;
+    }
 
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    static char vertexShaderSource[WAVE_SHADER_SOURCE_SIZE], fragmentShaderSource[WAVE_SHADER_SOURCE_SIZE];
+    waveShaderSource(&wavePresetPeaceful, WAVE_SHADER_VERTEX, vertexShaderSource, sizeof(vertexShaderSource));
+    waveShaderSource(&wavePresetPeaceful, WAVE_SHADER_FRAGMENT, fragmentShaderSource, sizeof(fragmentShaderSource));
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    double buildStart = wallClock();
+    ShaderProgram shader;
+    if (!shaderProgramBuild(&shader, "peaceful", vertexShaderSource, fragmentShaderSource, shaderUniforms)) {
+        if (window) {
+            glfwTerminate();
+        } else {
+            headlessDestroy(&headless);
+        }
+        return -1;
+    }
+    printf("Shaders %s in %.1f ms\n", shader.cached ? "loaded from the cache" : "compiled",
+           (wallClock() - buildStart) * 1000.0);
+    waveInteractionsInit(&interactions);
+    waveInteractionsAttach(shader.program);
 
     // Create a simple full-screen quad
     float vertices[] = {
@@ -136,31 +261,63 @@ int main() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    while (!glfwWindowShouldClose(window)) {
+    while (!window || !glfwWindowShouldClose(window)) {
+        // Log this frame's clock, or replay the input due before it and
+        // take the recorded clock
+        double frameTime = currentTime();
+        if (!inputLogFrame(&inputLog, window, &replayHandlers, &frameTime)) {
+            break;
+        }
+        double frameStart = wallClock();
         glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
+        glUseProgram(shader.program);
 
-        float timeValue = glfwGetTime();
-        int timeLoc = glGetUniformLocation(shaderProgram, "time");
-        glUniform1f(timeLoc, timeValue);
-
-        int zoomLoc = glGetUniformLocation(shaderProgram, "zoom");
-        glUniform1f(zoomLoc, zoomLevel);
+        float timeValue = frameTime;
+        glUniform1f(shader.uniforms[UNIFORM_TIME], timeValue);
+        // The shader scales view coordinates by zoom; zooming in here shrinks them
+        glUniform1f(shader.uniforms[UNIFORM_ZOOM], viewScale());
+        int width = headless.width, height = headless.height;
+        if (window) {
+            glfwGetFramebufferSize(window, &width, &height);
+        }
+        glUniform1f(shader.uniforms[UNIFORM_ASPECT], height > 0 ? (float)width / height : 1.0f);
+        waveInteractionsUpdate(&interactions, timeValue);
 
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        snapshotCapture(&snapshot, width, height);
+        if (window) {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        } else {
+            headlessFinishFrame(&headless);
+        }
+        if (snapshotFrameDone(&snapshot, (wallClock() - frameStart) * 1000.0)) {
+            break;
+        }
+    }
+
+    if (inputLog.mode == INPUT_LOG_RECORDING) {
+        printf("Recorded %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    } else if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        printf("Replayed %d frames and %d input events\n", inputLog.frames, inputLog.events);
     }
+    inputLogClose(&inputLog);
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    waveInteractionsDestroy(&interactions);
+    shaderProgramDestroy(&shader);
 
-    glfwTerminate();
+    snapshotDestroy(&snapshot);
+    if (window) {
+        glfwTerminate();
+    } else {
+        headlessDestroy(&headless);
+    }
     return 0;
 }
\ No newline at end of file
@@ -2,122 +2,240 @@
 #include <GLFW/glfw3.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include "headless.h"
+#include "input_log.h"
+#include "render_scale.h"
+#include "shader_program.h"
+#include "snapshot.h"
+#include "wave_interaction.h"
+#include "wave_presets.h"
+#include "wave_shader.h"
+
 float zoomLevel = 1.0f;
+WaveInteractions interactions;
+
+// --snapshot=FILE draws a fixed-time frame for the regression harness
+// (snapshot.h); --headless, which needs it, does so with no window
+Snapshot snapshot;
+HeadlessContext headless;
+
+// --record=FILE logs live input with each frame's clock; --replay=FILE
+// ignores live input and drives the same handlers, and the clock, from a log
+InputLog inputLog;
+
+// Wall time, from GLFW or, when it is not running, the headless clock
+double wallClock() {
+    return headless.backend != HEADLESS_NONE ? headlessTime() : glfwGetTime();
+}
+
+// The clock reading the current frame is drawn at
+double currentTime() {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return inputLog.time;
+    }
+    return snapshot.path ? snapshotClock(&snapshot) : wallClock();
+}
 
-const char* vertexShaderSource = "#version 330 core\n"
-    "layout (location = 0) in vec3 aPos;\n"
-    "out vec2 FragCoord;\n"
-    "void main() {\n"
-    "   gl_Position = vec4(aPos, 1.0);\n"
-    "   FragCoord = aPos.xy;\n"
-    "}\n";
-
-const char* fragmentShaderSource = "#version 330 core\n"
-    "out vec4 FragColor;\n"
-    "in vec2 FragCoord;\n"
-    "uniform float time;\n"
-    "uniform float zoom;\n"
-    "uniform vec2 resolution;\n"
-    "\n"
-    "void main() {\n"
-    "   vec2 uv = FragCoord * zoom;\n"
-    "   \n"
-    "   // Create multiple wave layers\n"
-    "   float wave = 0.0;\n"
-    "   wave += sin(uv.x * 6.0 + time * 2.0) * 0.1;\n"
-    "   wave += sin(uv.x * 4.0 - time * 1.5) * 0.15;\n"
-    "   wave += sin(uv.x * 8.0 + uv.y * 3.0 + time) * 0.05;\n"
-    "   wave += cos(uv.x * 2.0 + time * 0.8) * 0.2;\n"
-    "   \n"
-    "   // Apply wave to y coordinate\n"
-    "   float distorted_y = uv.y - wave * 0.5;\n"
-    "   \n"
-    "   // Create color gradient based on wave height\n"
-    "   float gradient = (distorted_y + 1.0) * 0.5;\n"
-    "   \n"
-    "   // Ocean colors\n"
-    "   vec3 deepWater = vec3(0.0, 0.1, 0.3);\n"
-    "   vec3 midWater = vec3(0.0, 0.3, 0.5);\n"
-    "   vec3 shallowWater = vec3(0.2, 0.5, 0.7);\n"
-    "   vec3 foam = vec3(0.9, 0.95, 1.0);\n"
-    "   \n"
-    "   vec3 color;\n"
-    "   if (gradient < 0.25) {\n"
-    "       color = mix(deepWater, midWater, gradient * 4.0);\n"
-    "   } else if (gradient < 0.5) {\n"
-    "       color = mix(midWater, shallowWater, (gradient - 0.25) * 4.0);\n"
-    "   } else if (gradient < 0.75) {\n"
-    "       color = mix(shallowWater, foam, (gradient - 0.5) * 4.0);\n"
-    "   } else {\n"
-    "       color = foam;\n"
-    "   }\n"
-    "   \n"
-    "   // Add shimmer effect\n"
-    "   float shimmer = sin(uv.x * 20.0 + time * 5.0) * sin(uv.y * 20.0 - time * 3.0);\n"
-    "   color += shimmer * 0.05;\n"
-    "   \n"
-    "   FragColor = vec4(color, 1.0);\n"
-    "}\n";
+// Uniforms, in the order of shaderUniforms
+enum { UNIFORM_TIME, UNIFORM_ZOOM, UNIFORM_ASPECT };
+const char* const shaderUniforms[] = {"time", "zoom", "aspect", NULL};
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    inputLogResize(&inputLog, width, height);
     glViewport(0, 0, width, height);
 }
 
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+void applyScroll(GLFWwindow* window, double xoffset, double yoffset) {
     zoomLevel -= (float)yoffset * 0.1f;
     if (zoomLevel < 0.3f) zoomLevel = 0.3f;
     if (zoomLevel > 3.0f) zoomLevel = 3.0f;
 }
 
-unsigned int compileShader(unsigned int type, const char* source) {
-    unsigned int shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogScroll(&inputLog, xoffset, yoffset);
+    applyScroll(window, xoffset, yoffset);
+}
+
+// The zoom uniform: how far the view reaches from the centre
+float viewScale() {
+    return zoomLevel;
+}
 
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        printf("Shader compilation failed: %s\n", infoLog);
+// Window coordinates to the shader's view coordinates (wavePos)
+void cursorToView(GLFWwindow* window, double xpos, double ypos, float* x, float* y) {
+    int width = headless.width, height = headless.height;
+    if (window) {
+        glfwGetWindowSize(window, &width, &height);
+    }
+    if (width <= 0 || height <= 0) {
+        *x = *y = 0.0f;
+        return;
     }
+    *x = ((float)(xpos / width) * 2.0f - 1.0f) * viewScale();
+    *y = (1.0f - (float)(ypos / height) * 2.0f) * viewScale();
+}
 
-    return shader;
+// Left: ripple and whirlpool, right: freeze and ice crystal
+void applyButton(GLFWwindow* window, int button, int action, int mods, double xpos, double ypos) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT && button != GLFW_MOUSE_BUTTON_RIGHT) {
+        return;
+    }
+    float x, y;
+    cursorToView(window, xpos, ypos, &x, &y);
+    waveInteractionsButton(&interactions, button == GLFW_MOUSE_BUTTON_LEFT ? 0 : 1, action == GLFW_PRESS, x, y,
+                           currentTime());
 }
 
-int main() {
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
-        return -1;
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
     }
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    inputLogButton(&inputLog, button, action, mods, xpos, ypos);
+    applyButton(window, button, action, mods, xpos, ypos);
+}
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+void applyCursor(GLFWwindow* window, double xpos, double ypos) {
+    float x, y;
+    cursorToView(window, xpos, ypos, &x, &y);
+    waveInteractionsDrag(&interactions, x, y);
+}
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
-    if (!window) {
-        printf("Failed to create window\n");
-        glfwTerminate();
-        return -1;
+void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
     }
+    inputLogCursor(&inputLog, xpos, ypos);
+    applyCursor(window, xpos, ypos);
+}
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+// Pointer positions in a log only mean the same thing at the same size
+void replayResize(GLFWwindow* window, int width, int height) {
+    static int warned = 0;
+    int currentWidth = headless.width, currentHeight = headless.height;
+    if (window) {
+        glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
+    }
+    if (!warned && (width != currentWidth || height != currentHeight)) {
+        fprintf(stderr, "Input log was recorded at %dx%d, replaying at %dx%d\n", width, height, currentWidth,
+                currentHeight);
+        warned = 1;
+    }
+}
+
+const InputLogHandlers replayHandlers = {applyCursor, applyButton, applyScroll, NULL, replayResize};
+
+int main(int argc, char* argv[]) {
+    // --frame-budget=MS renders at a lower resolution when the full-screen
+    // shader cannot keep up, between --min-scale and the full window.
+    // --shader-cache=DIR keeps linked program binaries there (empty: off).
+    double frameBudget = 0.0;
+    float minScale = RENDER_SCALE_DEFAULT_MIN;
+    // --record=FILE / --replay=FILE log live input or replay it (input_log.h)
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    snapshotInit(&snapshot);
+    int headlessMode = 0;
+    const char* headlessBackend = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--frame-budget=", 15) == 0) {
+            frameBudget = atof(argv[i] + 15);
+        } else if (strncmp(argv[i], "--min-scale=", 12) == 0) {
+            minScale = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--shader-cache=", 15) == 0) {
+            shaderCacheSetDirectory(argv[i] + 15);
+        } else if (snapshotOption(&snapshot, argv[i])) {
+            continue;
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            recordPath = argv[i] + 9;
+        } else if (strncmp(argv[i], "--replay=", 9) == 0) {
+            replayPath = argv[i] + 9;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = 1;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessMode = 1;
+            headlessBackend = argv[i] + 11;
+        }
+    }
 
-    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    // Without a window only the end of the log or the snapshot can end the
+    // run
+    if (headlessMode && !replayPath && !snapshot.path) {
+        printf("--headless needs --replay or --snapshot\n");
+        return -1;
+    }
 
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    // Headless runs never start GLFW and leave window NULL
+    GLFWwindow* window = NULL;
+    if (headlessMode) {
+        if (!headlessCreate(&headless, headlessBackend, 800, 600, 3, 3, 1)) {
+            printf("Failed to create a headless context\n");
+            return -1;
+        }
+    } else {
+        if (!glfwInit()) {
+            printf("Failed to initialize GLFW\n");
+            return -1;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (snapshot.path) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+
+        window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
+        if (!window) {
+            printf("Failed to create window\n");
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetCursorPosCallback(window, cursor_position_callback);
+        if (snapshot.path) {
+            glfwSwapInterval(0);
+        }
+    }
+    if (replayPath) {
+        inputLogReplay(&inputLog, replayPath);
+    } else if (recordPath) {
+        inputLogRecord(&inputLog, recordPath, currentTime);
+    }
+    if (headlessMode && inputLog.mode != INPUT_LOG_REPLAYING && !snapshot.path) {
+        headlessDestroy(&headless);
+        return -1;
+    }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    static char vertexShaderSource[WAVE_SHADER_SOURCE_SIZE], fragmentShaderSource[WAVE_SHADER_SOURCE_SIZE];
+    waveShaderSource(&wavePresetPeacefulWaves, WAVE_SHADER_VERTEX, vertexShaderSource, sizeof(vertexShaderSource));
+    waveShaderSource(&wavePresetPeacefulWaves, WAVE_SHADER_FRAGMENT, fragmentShaderSource, sizeof(fragmentShaderSource));
+
+    double buildStart = wallClock();
+    ShaderProgram shader;
+    if (!shaderProgramBuild(&shader, "peaceful_waves", vertexShaderSource, fragmentShaderSource, shaderUniforms)) {
+        if (window) {
+            glfwTerminate();
+        } else {
+            headlessDestroy(&headless);
+        }
+        return -1;
+    }
+    printf("Shaders %s in %.1f ms\n", shader.cached ? "loaded from the cache" : "compiled",
+           (wallClock() - buildStart) * 1000.0);
+    waveInteractionsInit(&interactions);
+    waveInteractionsAttach(shader.program);
 
     // Full screen quad
     float vertices[] = {
@@ -151,36 +269,88 @@ int main() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    while (!glfwWindowShouldClose(window)) {
-        glClearColor(0.0f, 0.1f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+    RenderScale renderScale;
+    int dynamicResolution = 0;
+    if (frameBudget > 0.0) {
+        dynamicResolution = renderScaleInit(&renderScale, frameBudget, minScale, 1.0f);
+        if (!dynamicResolution) {
+            printf("Offscreen rendering unavailable, drawing at full resolution\n");
+        }
+    }
 
-        glUseProgram(shaderProgram);
+    while (!window || !glfwWindowShouldClose(window)) {
+        // Log this frame's clock, or replay the input due before it and
+        // take the recorded clock
+        double frameTime = currentTime();
+        if (!inputLogFrame(&inputLog, window, &replayHandlers, &frameTime)) {
+            break;
+        }
+        double frameStart = wallClock();
+        int width = headless.width, height = headless.height;
+        if (window) {
+            glfwGetFramebufferSize(window, &width, &height);
+        }
+        if (dynamicResolution) {
+            renderScaleBegin(&renderScale, width, height);
+        }
 
-        float timeValue = glfwGetTime();
-        int timeLoc = glGetUniformLocation(shaderProgram, "time");
-        glUniform1f(timeLoc, timeValue);
+        glClearColor(0.0f, 0.1f, 0.2f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
 
-        int zoomLoc = glGetUniformLocation(shaderProgram, "zoom");
-        glUniform1f(zoomLoc, zoomLevel);
+        glUseProgram(shader.program);
 
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
-        int resLoc = glGetUniformLocation(shaderProgram, "resolution");
-        glUniform2f(resLoc, (float)width, (float)height);
+        float timeValue = frameTime;
+        glUniform1f(shader.uniforms[UNIFORM_TIME], timeValue);
+        glUniform1f(shader.uniforms[UNIFORM_ZOOM], viewScale());
+        glUniform1f(shader.uniforms[UNIFORM_ASPECT], height > 0 ? (float)width / height : 1.0f);
+        waveInteractionsUpdate(&interactions, timeValue);
 
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (dynamicResolution) {
+            renderScaleEnd(&renderScale);
+        }
+        snapshotCapture(&snapshot, width, height);
+        if (window) {
+            glfwSwapBuffers(window);
+        } else {
+            headlessFinishFrame(&headless);
+        }
+        double frameMs = (wallClock() - frameStart) * 1000.0;
+        if (dynamicResolution) {
+            renderScaleFrameDone(&renderScale, frameMs);
+        }
+        if (window) {
+            glfwPollEvents();
+        }
+        if (snapshotFrameDone(&snapshot, frameMs)) {
+            break;
+        }
     }
 
+    if (dynamicResolution) {
+        renderScaleDestroy(&renderScale);
+    }
+
+    if (inputLog.mode == INPUT_LOG_RECORDING) {
+        printf("Recorded %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    } else if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        printf("Replayed %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    }
+    inputLogClose(&inputLog);
+
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    waveInteractionsDestroy(&interactions);
+    shaderProgramDestroy(&shader);
 
-    glfwTerminate();
+    snapshotDestroy(&snapshot);
+    if (window) {
+        glfwTerminate();
+    } else {
+        headlessDestroy(&headless);
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "palette.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void paletteDefault(Palette* p) {
+    static const float stops[4][4] = {
+        {0.0f, 0.1f, 0.3f, 0.6f},
+        {0.33f, 0.53f, 0.81f, 0.92f},
+        {0.66f, 0.9f, 0.8f, 1.0f},
+        {0.99f, 1.0f, 0.85f, 0.7f},
+    };
+
+    p->count = 4;
+    for (int i = 0; i < 4; i++) {
+        p->position[i] = stops[i][0];
+        p->color[i][0] = stops[i][1];
+        p->color[i][1] = stops[i][2];
+        p->color[i][2] = stops[i][3];
+    }
+}
+
+int paletteLoad(Palette* p, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open palette %s\n", path);
+        return 0;
+    }
+
+    Palette loaded;
+    loaded.count = 0;
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char* comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        float pos, r, g, b;
+        char extra;
+        int fields = sscanf(line, " %f %f %f %f %c", &pos, &r, &g, &b, &extra);
+        if (fields == EOF) {
+            continue;
+        }
+        if (fields != 4 || loaded.count == PALETTE_MAX_STOPS ||
+            (loaded.count > 0 && pos < loaded.position[loaded.count - 1])) {
+            fprintf(stderr,
+                    "%s:%d: expected 'position red green blue' with non-decreasing positions (at most %d stops)\n",
+                    path, lineNumber, PALETTE_MAX_STOPS);
+            fclose(f);
+            return 0;
+        }
+        loaded.position[loaded.count] = pos;
+        loaded.color[loaded.count][0] = r;
+        loaded.color[loaded.count][1] = g;
+        loaded.color[loaded.count][2] = b;
+        loaded.count++;
+    }
+    fclose(f);
+
+    if (loaded.count == 0) {
+        fprintf(stderr, "%s: no colour stops\n", path);
+        return 0;
+    }
+    *p = loaded;
+    return 1;
+}
+
+void paletteBake(const Palette* p, const float tint[3], PaletteLut* lut) {
+    float* channels[3] = {lut->r, lut->g, lut->b};
+    int stop = 0;
+
+    for (int i = 0; i < PALETTE_LUT_SIZE; i++) {
+        float x = i / (float)(PALETTE_LUT_SIZE - 1);
+        while (stop < p->count - 2 && x >= p->position[stop + 1]) {
+            stop++;
+        }
+
+        // Lerp between stop and the one after it, clamped at the ends
+        int next = stop + 1 < p->count ? stop + 1 : stop;
+        float span = p->position[next] - p->position[stop];
+        float t = span > 0.0f ? (x - p->position[stop]) / span : 0.0f;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+
+        for (int ch = 0; ch < 3; ch++) {
+            float from = p->color[stop][ch], to = p->color[next][ch];
+            channels[ch][i] = (from + (to - from) * t) * tint[ch];
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+// Colour gradients as data. A palette is a list of colour stops along
+// [0, 1], loaded from a small text file or taken from the built-in default,
+// and baked into a lookup table so shading a vertex is one indexed load per
+// channel instead of a search through the stops.
+//
+// Palette files hold one stop per line: a position followed by red, green
+// and blue in [0, 1]. Positions must not decrease. Blank lines and anything
+// after '#' are ignored.
+//
+//   # position  red   green  blue
+//   0.00        0.10  0.30   0.60
+//   1.00        1.00  0.85   0.70
+
+#define PALETTE_MAX_STOPS 16
+#define PALETTE_LUT_SIZE 256
+
+typedef struct {
+    int count;
+    float position[PALETTE_MAX_STOPS];
+    float color[PALETTE_MAX_STOPS][3];
+} Palette;
+
+// Channel-separated so SIMD code can gather each channel with one index vector
+typedef struct {
+    float r[PALETTE_LUT_SIZE];
+    float g[PALETTE_LUT_SIZE];
+    float b[PALETTE_LUT_SIZE];
+} PaletteLut;
+
+// Deep blue, sky blue, lavender, peach: the original waves gradient
+void paletteDefault(Palette* p);
+
+// Returns 0 (leaving p untouched) if the file cannot be read or a line is
+// malformed, and prints which one to stderr
+int paletteLoad(Palette* p, const char* path);
+
+// Entry i holds the colour at i / (PALETTE_LUT_SIZE - 1), multiplied by
+// tint. Outside the first and last stops the end colours hold.
+void paletteBake(const Palette* p, const float tint[3], PaletteLut* lut);
+
+#endif
@@ -0,0 +1,131 @@
+#!/bin/bash
+#
+# Regression checks for every program. Each one draws a fixed-time frame
+# with --snapshot (snapshot.h), which must match its golden image in golden/
+# (compared by imgdiff.c), and its median frame time must stay within
+# REGRESS_SLOWDOWN percent (25) of this machine's baseline. The baseline is
+# kept in regress/baseline.txt and recorded by the first run, since frame
+# times only compare on the same machine.
+#
+#   ./regress.sh            check, exiting non-zero on any failure
+#   ./regress.sh --update   accept the current frames and frame times
+#
+# Everything runs --headless by default; REGRESS_HEADLESS=--headless=osmesa
+# picks the backend, and REGRESS_HEADLESS= uses hidden windows instead.
+# Goldens are drawn by Mesa's llvmpipe; other drivers round and smooth
+# differently, which IMGDIFF_FLAGS (e.g. "--mean=2 --share=2") can allow for.
+
+UPDATE=0
+if [ "$1" = "--update" ]; then
+    UPDATE=1
+fi
+MAKE=${MAKE:-make}
+HEADLESS=${REGRESS_HEADLESS---headless}
+SLOWDOWN=${REGRESS_SLOWDOWN:-25}
+OUT=regress
+BASELINE=$OUT/baseline.txt
+# Goldens are stored at a quarter of the frame size
+SCALE=4
+
+mkdir -p $OUT golden
+touch $BASELINE
+: > $OUT/times.txt
+failures=0
+
+fail() {
+    echo "FAIL $1: $2"
+    failures=$((failures + 1))
+}
+
+# build NAME TARGET: make one program, logging to regress/NAME.build
+build() {
+    if ! $MAKE $2 > $OUT/$1.build 2>&1; then
+        fail $1 "does not build, see $OUT/$1.build"
+        return 1
+    fi
+}
+
+# checkFrame NAME FRAME GOLDEN
+checkFrame() {
+    if [ $UPDATE = 1 ]; then
+        ./imgdiff --scale=$SCALE $2 golden/$3.ppm > /dev/null || fail $1 "cannot write golden/$3.ppm"
+    elif [ ! -f golden/$3.ppm ]; then
+        fail $1 "no golden/$3.ppm (./regress.sh --update makes one)"
+    elif ! ./imgdiff $IMGDIFF_FLAGS --diff=$OUT/$1.diff.ppm $2 golden/$3.ppm > $OUT/$1.imgdiff; then
+        fail $1 "frame differs from golden/$3.ppm, see $OUT/$1.diff.ppm"
+        cat $OUT/$1.imgdiff
+        return 1
+    fi
+}
+
+# checkTime NAME MS
+checkTime() {
+    echo "$1 $2" >> $OUT/times.txt
+    local baseline=$(awk -v name=$1 '$1 == name { print $2 }' $BASELINE)
+    if [ $UPDATE = 1 ] || [ -z "$baseline" ]; then
+        echo "ok   $1: $2 ms per frame (new baseline)"
+    elif awk -v now=$2 -v then=$baseline -v slack=$SLOWDOWN 'BEGIN { exit !(now > then * (1 + slack / 100)) }'; then
+        fail $1 "$2 ms per frame, over $SLOWDOWN% slower than the baseline $baseline ms"
+        return 1
+    else
+        echo "ok   $1: $2 ms per frame (baseline $baseline ms)"
+    fi
+}
+
+# snapshot NAME BINARY [GOLDEN]: draw, compare and time one program
+snapshot() {
+    local name=$1 binary=$2 golden=${3:-$1}
+    rm -f $OUT/$name.ppm
+    if ! ./$binary $HEADLESS --snapshot=$OUT/$name.ppm > $OUT/$name.log 2>&1 || [ ! -f $OUT/$name.ppm ]; then
+        fail $name "no snapshot, see $OUT/$name.log"
+        return
+    fi
+    checkFrame $name $OUT/$name.ppm $golden &&
+        checkTime $name $(sed -n 's/^snapshot: .* p50 \([0-9.]*\) ms.*/\1/p' $OUT/$name.log)
+}
+
+build imgdiff imgdiff || exit 1
+
+build waves waves && snapshot waves waves
+build simple simple && snapshot simple simple
+build peaceful peaceful && snapshot peaceful peaceful
+build peaceful_waves peaceful_waves && snapshot peaceful_waves peaceful_waves
+build transformer transformer && snapshot transformer transformer
+
+# Both capture tools build to ./capture; the GLEW one is kept aside first
+if $MAKE capture-advanced > $OUT/capture_advanced.build 2>&1; then
+    mv capture capture_advanced
+    snapshot capture_advanced capture_advanced
+else
+    echo "SKIP capture_advanced: does not build (needs GLEW), see $OUT/capture_advanced.build"
+fi
+rm -f capture
+build capture capture && snapshot capture capture
+
+# The CPU renderer must draw what the shader programs do, at the same time
+if build render_cpu render_cpu; then
+    for program in peaceful peaceful_waves; do
+        name=render_cpu_$program
+        if ! ./render_cpu --program=$program --time=2 --output=$OUT/$name.ppm > $OUT/$name.log 2>&1; then
+            fail $name "cannot render, see $OUT/$name.log"
+            continue
+        fi
+        # Goldens belong to the GPU programs, so only check against them
+        UPDATE=0 checkFrame $name $OUT/$name.ppm $program &&
+            ./render_cpu --program=$program --time=1 --frames=60 --fps=60 > $OUT/$name.log 2>&1 &&
+            checkTime $name $(sed -n 's/.* \([0-9.]*\) ms per frame.*/\1/p' $OUT/$name.log)
+    done
+fi
+
+if [ $UPDATE = 1 ]; then
+    cp $OUT/times.txt $BASELINE
+else
+    # Programs seen for the first time join the baseline
+    awk 'NR == FNR { known[$1] = 1; next } !($1 in known)' $BASELINE $OUT/times.txt >> $BASELINE
+fi
+
+if [ $failures -gt 0 ]; then
+    echo "$failures regression check(s) failed"
+    exit 1
+fi
+echo "All regression checks passed"
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wave_presets.h"
+#include "wave_raster.h"
+#include "worker_pool.h"
+
+// Renders the full-screen wave shaders on the CPU (wave_raster.h), with no
+// OpenGL, for frame generation on machines without a GL stack and as a
+// reference for the GPU programs. Frames start at --time and step at --fps;
+// the view is the programs' own at their default zoom.
+
+double currentTime() {
+#ifndef _WIN32
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1.0e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// RGBA, top row first, to a binary PPM
+int writeFrame(const char* path, const unsigned char* rgba, int width, int height) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        printf("Cannot write %s\n", path);
+        return 0;
+    }
+    unsigned char* row = malloc(width * 3);
+    if (!row) {
+        fclose(f);
+        return 0;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* in = rgba + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = in[x * 4 + 0];
+            row[x * 3 + 1] = in[x * 4 + 1];
+            row[x * 3 + 2] = in[x * 4 + 2];
+        }
+        fwrite(row, 1, width * 3, f);
+    }
+    free(row);
+    fclose(f);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    // --program=peaceful (main.c) or peaceful_waves (main_waves.c)
+    // --size=WxH, --time=T for the first frame, --frames=N at --fps=F
+    // --output=PATTERN writes each frame as a PPM, the frame number going
+    //   through the pattern's printf conversion (frames/frame_%05d.ppm);
+    //   without it the frames are only timed
+    // --threads=N worker threads (0: render thread only), --kernel=NAME
+    const char* program = "peaceful_waves";
+    int width = 800, height = 600;
+    double startTime = 0.0, fps = 30.0;
+    int frames = 1;
+    const char* outputPattern = NULL;
+    int threads = -1;
+    const char* kernelName = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--program=", 10) == 0) {
+            program = argv[i] + 10;
+        } else if (strncmp(argv[i], "--size=", 7) == 0) {
+            if (sscanf(argv[i] + 7, "%dx%d", &width, &height) != 2) {
+                width = 0;
+            }
+        } else if (strncmp(argv[i], "--time=", 7) == 0) {
+            startTime = atof(argv[i] + 7);
+        } else if (strncmp(argv[i], "--frames=", 9) == 0) {
+            frames = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--fps=", 6) == 0) {
+            fps = atof(argv[i] + 6);
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            outputPattern = argv[i] + 9;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--kernel=", 9) == 0) {
+            kernelName = argv[i] + 9;
+        }
+    }
+
+    const WaveShaderConfig* config;
+    if (strcmp(program, "peaceful") == 0) {
+        config = &wavePresetPeaceful;
+    } else if (strcmp(program, "peaceful_waves") == 0) {
+        config = &wavePresetPeacefulWaves;
+    } else {
+        printf("Unknown program '%s' (peaceful or peaceful_waves)\n", program);
+        return -1;
+    }
+    if (width <= 0 || height <= 0 || frames <= 0 || fps <= 0.0) {
+        printf("Need a positive --size, --frames and --fps\n");
+        return -1;
+    }
+
+    const WaveRasterKernel* kernel = waveRasterSelect(kernelName);
+    if (!kernel) {
+        printf("Raster kernel '%s' is not available, using the default\n", kernelName);
+        kernel = waveRasterSelect(NULL);
+    }
+    workerPoolInit(threads);
+
+    unsigned char* rgba = malloc((size_t)width * height * 4);
+    if (!rgba) {
+        printf("Cannot allocate a %dx%d frame\n", width, height);
+        workerPoolDestroy();
+        return -1;
+    }
+
+    WaveRasterFrame frame = {0};
+    frame.zoom = 1.0f;  // both programs start unzoomed
+    frame.aspect = (float)width / height;
+
+    double renderTime = 0.0;
+    int status = 0;
+    for (int n = 0; n < frames; n++) {
+        frame.time = startTime + n / fps;
+
+        double start = currentTime();
+        waveRasterRender(kernel, config, &frame, rgba, width, height);
+        renderTime += currentTime() - start;
+
+        if (outputPattern) {
+            char path[1024];
+            snprintf(path, sizeof(path), outputPattern, n);
+            if (!writeFrame(path, rgba, width, height)) {
+                status = -1;
+                break;
+            }
+        }
+    }
+
+    printf("%s: %d frames of %dx%d in %.1f ms, %.2f ms per frame (%.1f Mpixel/s), %s kernel, %d threads\n",
+           program, frames, width, height, renderTime * 1000.0, renderTime * 1000.0 / frames,
+           (double)width * height * frames / renderTime / 1.0e6, waveRasterKernelName(kernel),
+           workerPoolThreads() + 1);
+
+    free(rgba);
+    workerPoolDestroy();
+    return status;
+}
@@ -0,0 +1,233 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gl_caps.h"
+#include "render_scale.h"
+
+// Framebuffer objects, blits and timer queries are GL 3.x entry points that
+// neither the Windows opengl32 import library nor the macOS legacy context
+// provide
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define RENDER_SCALE_FBO 1
+#endif
+
+// Aim this far under the budget so ordinary jitter does not overrun it
+#define RENDER_SCALE_HEADROOM 0.9
+// Weight of each new measurement in the smoothed cost
+#define RENDER_SCALE_SMOOTHING 0.2
+// Frames to wait after a change before raising the scale, long enough for
+// measurements taken at the new scale to come back
+#define RENDER_SCALE_COOLDOWN (RENDER_SCALE_QUERY_RING + 4)
+
+#ifdef RENDER_SCALE_FBO
+// Software rasterizers queue draws and run them when the frame is flushed,
+// so timestamps around the draw calls only see the queueing
+static int contextIsSoftware(void) {
+    static const char* names[] = {"llvmpipe", "softpipe", "SwiftShader", "GDI Generic", "Software", NULL};
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    for (int i = 0; renderer && names[i]; i++) {
+        if (strstr(renderer, names[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void allocateTarget(RenderScale* r) {
+    r->targetWidth = (int)ceilf(r->windowWidth * r->maxScale);
+    r->targetHeight = (int)ceilf(r->windowHeight * r->maxScale);
+    if (r->targetWidth < 1) r->targetWidth = 1;
+    if (r->targetHeight < 1) r->targetHeight = 1;
+
+    glBindRenderbuffer(GL_RENDERBUFFER, r->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, r->targetWidth, r->targetHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+// Fold one measurement of a frame drawn at scale into the full-resolution cost
+static void addSample(RenderScale* r, double ms, float scale) {
+    double fullMs = ms / (scale * scale);
+    if (r->measured) {
+        r->fullCostMs += (fullMs - r->fullCostMs) * RENDER_SCALE_SMOOTHING;
+    } else {
+        r->fullCostMs = fullMs;
+        r->measured = 1;
+    }
+}
+
+static void readQueries(RenderScale* r, int index) {
+    GLuint64 start = 0, end = 0;
+    int slot = index % RENDER_SCALE_QUERY_RING;
+    glGetQueryObjectui64v(r->queries[slot][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(r->queries[slot][1], GL_QUERY_RESULT, &end);
+    addSample(r, (end - start) / 1.0e6, r->queryScale[slot]);
+}
+
+// Drain whatever results are ready, and the oldest regardless once the ring
+// is full so Begin always has a free slot
+static void collectQueries(RenderScale* r) {
+    while (r->pending > 0) {
+        int oldest = r->issued - r->pending;
+        GLint available = 0;
+        glGetQueryObjectiv(r->queries[oldest % RENDER_SCALE_QUERY_RING][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && r->pending < RENDER_SCALE_QUERY_RING) {
+            break;
+        }
+        readQueries(r, oldest);
+        r->pending--;
+    }
+}
+
+// Choose the next frame's scale. Drops apply at once; rises wait out the
+// cooldown and climb a step at a time, so a brief lull does not bounce the
+// resolution straight back up into a slow frame.
+static void updateScale(RenderScale* r) {
+    if (r->cooldown > 0) {
+        r->cooldown--;
+    }
+    if (!r->measured || r->fullCostMs <= 0.0) {
+        return;
+    }
+
+    float fit = (float)sqrt(r->budgetMs * RENDER_SCALE_HEADROOM / r->fullCostMs);
+    fit = floorf(fit / RENDER_SCALE_STEP) * RENDER_SCALE_STEP;
+    if (fit < r->minScale) fit = r->minScale;
+    if (fit > r->maxScale) fit = r->maxScale;
+
+    if (fit < r->scale) {
+        r->scale = fit;
+        r->cooldown = RENDER_SCALE_COOLDOWN;
+    } else if (fit > r->scale && r->cooldown == 0) {
+        r->scale += RENDER_SCALE_STEP;
+        if (r->scale > fit) r->scale = fit;
+        r->cooldown = RENDER_SCALE_COOLDOWN;
+    }
+}
+#endif
+
+int renderScaleInit(RenderScale* r, double budgetMs, float minScale, float maxScale) {
+    memset(r, 0, sizeof(*r));
+    if (maxScale > 1.0f) maxScale = 1.0f;
+    if (minScale < RENDER_SCALE_STEP) minScale = RENDER_SCALE_STEP;
+    if (minScale > maxScale) minScale = maxScale;
+    r->minScale = minScale;
+    r->maxScale = maxScale;
+    r->scale = maxScale;
+    r->budgetMs = budgetMs;
+
+#ifdef RENDER_SCALE_FBO
+    if (!glCapsVersionAtLeast(3, 0) && !glCapsHasExtension("GL_ARB_framebuffer_object")) {
+        return 0;
+    }
+    glGenFramebuffers(1, &r->fbo);
+    glGenRenderbuffers(1, &r->color);
+    r->supported = 1;
+
+    if (!contextIsSoftware() && (glCapsVersionAtLeast(3, 3) || glCapsHasExtension("GL_ARB_timer_query"))) {
+        glGenQueries(RENDER_SCALE_QUERY_RING * 2, &r->queries[0][0]);
+        r->timerSupported = 1;
+    }
+#endif
+    return r->supported;
+}
+
+void renderScaleBegin(RenderScale* r, int windowWidth, int windowHeight) {
+#ifdef RENDER_SCALE_FBO
+    if (!r->supported) {
+        return;
+    }
+    GLint output = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &output);
+    r->output = output;
+    if (windowWidth != r->windowWidth || windowHeight != r->windowHeight) {
+        r->windowWidth = windowWidth;
+        r->windowHeight = windowHeight;
+        allocateTarget(r);
+        glBindFramebuffer(GL_FRAMEBUFFER, r->fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, r->color);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, r->fbo);
+    }
+
+    r->width = (int)(windowWidth * r->scale + 0.5f);
+    r->height = (int)(windowHeight * r->scale + 0.5f);
+    if (r->width < 1) r->width = 1;
+    if (r->height < 1) r->height = 1;
+    glViewport(0, 0, r->width, r->height);
+
+    if (r->timerSupported) {
+        int slot = r->issued % RENDER_SCALE_QUERY_RING;
+        r->queryScale[slot] = r->scale;
+        glQueryCounter(r->queries[slot][0], GL_TIMESTAMP);
+    }
+#else
+    (void)r;
+    (void)windowWidth;
+    (void)windowHeight;
+#endif
+}
+
+void renderScaleEnd(RenderScale* r) {
+#ifdef RENDER_SCALE_FBO
+    if (!r->supported) {
+        return;
+    }
+    if (r->timerSupported) {
+        glQueryCounter(r->queries[r->issued % RENDER_SCALE_QUERY_RING][1], GL_TIMESTAMP);
+        r->issued++;
+        r->pending++;
+    }
+
+    // A 1:1 copy stays exact; anything smaller is filtered up
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, r->fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, r->output);
+    int exact = r->width == r->windowWidth && r->height == r->windowHeight;
+    glBlitFramebuffer(0, 0, r->width, r->height, 0, 0, r->windowWidth, r->windowHeight, GL_COLOR_BUFFER_BIT,
+                      exact ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, r->output);
+    glViewport(0, 0, r->windowWidth, r->windowHeight);
+#else
+    (void)r;
+#endif
+}
+
+void renderScaleFrameDone(RenderScale* r, double frameMs) {
+#ifdef RENDER_SCALE_FBO
+    if (!r->supported) {
+        return;
+    }
+    if (r->timerSupported) {
+        collectQueries(r);
+    } else {
+        addSample(r, frameMs, r->scale);
+    }
+    updateScale(r);
+#else
+    (void)r;
+    (void)frameMs;
+#endif
+}
+
+void renderScaleDestroy(RenderScale* r) {
+#ifdef RENDER_SCALE_FBO
+    if (r->timerSupported) {
+        glDeleteQueries(RENDER_SCALE_QUERY_RING * 2, &r->queries[0][0]);
+    }
+    if (r->supported) {
+        glDeleteRenderbuffers(1, &r->color);
+        glDeleteFramebuffers(1, &r->fbo);
+    }
+#endif
+    r->supported = 0;
+    r->timerSupported = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef RENDER_SCALE_H
+#define RENDER_SCALE_H
+
+// Dynamic resolution for fill-bound scenes. Each frame is drawn into an
+// offscreen framebuffer at some fraction of the window size and stretched
+// onto the window, and a controller picks that fraction to keep the frame
+// time inside a budget: long frames lower the resolution, headroom raises
+// it again. The controller assumes the cost grows with the pixel count, so
+// one measurement at any scale predicts the scale that fits the budget.
+//
+// The scene time comes from a pair of GL_TIMESTAMP queries around the draw,
+// read back a few frames late so the pipeline never stalls. Timestamps
+// rather than a GL_TIME_ELAPSED query, because --bench already has one of
+// those open around the whole frame. Software rasterizers do their fragment
+// work when the frame is flushed, out of sight of any query, so there and
+// without timer queries the controller follows the whole frame time the
+// caller reports instead.
+//
+// The offscreen target is allocated at maxScale of the window and only its
+// lower-left corner is drawn to, so changing the scale never reallocates.
+
+#define RENDER_SCALE_QUERY_RING 4
+// Scales are rounded to this so jitter in the timings does not resize
+// every frame
+#define RENDER_SCALE_STEP (1.0f / 32.0f)
+#define RENDER_SCALE_DEFAULT_MIN 0.5f
+
+typedef struct {
+    float minScale, maxScale;
+    float scale;  // the current frame's
+    double budgetMs;
+
+    int supported;  // 0 without framebuffer objects: Begin and End do nothing
+    unsigned int fbo, color;
+    unsigned int output;  // the framebuffer Begin found bound: 0, or a headless target
+    int targetWidth, targetHeight;  // allocated size
+    int windowWidth, windowHeight;
+    int width, height;  // drawn this frame
+
+    int timerSupported;  // 0 on software rasterizers too
+    unsigned int queries[RENDER_SCALE_QUERY_RING][2];  // start and end timestamps
+    float queryScale[RENDER_SCALE_QUERY_RING];  // the scale each pair measured
+    int issued;  // pairs recorded so far
+    int pending;  // recorded but not yet read back
+
+    // Smoothed milliseconds per frame at full resolution (scale 1)
+    double fullCostMs;
+    int measured;
+    int cooldown;  // frames before the scale may rise again
+} RenderScale;
+
+// Needs a current context. budgetMs is the frame time to stay under and the
+// scale stays within [minScale, maxScale]. Returns 0, and leaves rendering
+// to the window, without GL 3.0 or ARB_framebuffer_object.
+int renderScaleInit(RenderScale* r, double budgetMs, float minScale, float maxScale);
+
+// Redirect drawing into the offscreen target at the current scale and set
+// the viewport to match
+void renderScaleBegin(RenderScale* r, int windowWidth, int windowHeight);
+
+// Stretch the frame onto the window, or whichever framebuffer was bound at Begin
+void renderScaleEnd(RenderScale* r);
+
+// Pick the next frame's scale, after the swap. frameMs runs from the start
+// of the frame to the return from the swap, and only counts without usable
+// timer queries.
+void renderScaleFrameDone(RenderScale* r, double frameMs);
+
+void renderScaleDestroy(RenderScale* r);
+
+#endif
@@ -0,0 +1,273 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gl_caps.h"
+#include "shader_program.h"
+
+// Program binaries are GL 4.1 entry points that neither the Windows
+// opengl32 import library nor the macOS legacy headers provide
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define SHADER_BINARY_CACHE 1
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SHADER_CACHE_VERSION 1
+#define SHADER_LOG_SIZE 1024
+
+static const char shaderCacheMagic[8] = {'P', 'E', 'A', 'C', 'E', 'S', 'H', 'D'};
+
+static char cacheDirectory[512];
+static int cacheDirectoryChosen = 0;
+
+void shaderCacheSetDirectory(const char* directory) {
+    snprintf(cacheDirectory, sizeof(cacheDirectory), "%s", directory ? directory : "");
+    cacheDirectoryChosen = 1;
+}
+
+static unsigned int compileShader(unsigned int type, const char* source, const char* name) {
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    int success;
+    char infoLog[SHADER_LOG_SIZE];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        printf("%s %s shader compilation failed: %s\n", name, type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+               infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+#ifdef SHADER_BINARY_CACHE
+static int binariesSupported(void) {
+    static int supported = -1;
+    if (supported < 0) {
+        GLint formats = 0;
+        if (glCapsVersionAtLeast(4, 1) || glCapsHasExtension("GL_ARB_get_program_binary")) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0;
+    }
+    return supported;
+}
+
+static uint64_t hashString(uint64_t hash, const char* s) {
+    // The terminator goes in too, so "ab" + "c" and "a" + "bc" differ
+    do {
+        hash ^= (unsigned char)*s;
+        hash *= 1099511628211ull;
+    } while (*s++);
+    return hash;
+}
+
+static uint64_t programKey(const char* vertexSource, const char* fragmentSource) {
+    const GLenum driverStrings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, vertexSource);
+    hash = hashString(hash, fragmentSource);
+    for (int i = 0; i < 3; i++) {
+        const char* s = (const char*)glGetString(driverStrings[i]);
+        hash = hashString(hash, s ? s : "");
+    }
+    return hash;
+}
+
+// Settle on the cache directory the first time it is needed
+static const char* cacheRoot(void) {
+    if (!cacheDirectoryChosen) {
+        const char* xdg = getenv("XDG_CACHE_HOME");
+        const char* home = getenv("HOME");
+        if (xdg && *xdg) {
+            snprintf(cacheDirectory, sizeof(cacheDirectory), "%s/peace", xdg);
+        } else if (home && *home) {
+            snprintf(cacheDirectory, sizeof(cacheDirectory), "%s/.cache/peace", home);
+        }
+        cacheDirectoryChosen = 1;
+    }
+    return cacheDirectory[0] ? cacheDirectory : NULL;
+}
+
+// mkdir -p
+static int makeDirectories(const char* path) {
+    char partial[sizeof(cacheDirectory)];
+    snprintf(partial, sizeof(partial), "%s", path);
+    for (char* p = partial + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char saved = *p;
+            *p = '\0';
+            if (mkdir(partial, 0755) != 0 && errno != EEXIST) {
+                return 0;
+            }
+            *p = saved;
+            if (saved == '\0') {
+                return 1;
+            }
+        }
+    }
+}
+
+static void cachePath(char* path, size_t size, const char* name, uint64_t key) {
+    snprintf(path, size, "%s/%s-%016llx.bin", cacheRoot(), name, (unsigned long long)key);
+}
+
+// The file is the magic, then version, format, length and key, then the
+// binary. The key is stored as well as named so a renamed file cannot load.
+static int loadBinary(unsigned int program, const char* name, uint64_t key) {
+    char path[sizeof(cacheDirectory) + 64];
+    cachePath(path, sizeof(path), name, key);
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return 0;
+    }
+
+    char magic[sizeof(shaderCacheMagic)];
+    uint32_t version = 0, format = 0, length = 0;
+    uint64_t storedKey = 0;
+    void* binary = NULL;
+    int ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+             memcmp(magic, shaderCacheMagic, sizeof(magic)) == 0 && fread(&version, sizeof(version), 1, f) == 1 &&
+             version == SHADER_CACHE_VERSION && fread(&format, sizeof(format), 1, f) == 1 &&
+             fread(&length, sizeof(length), 1, f) == 1 && fread(&storedKey, sizeof(storedKey), 1, f) == 1 &&
+             storedKey == key && length > 0 && (binary = malloc(length)) != NULL &&
+             fread(binary, 1, length, f) == length;
+    fclose(f);
+
+    GLint linked = 0;
+    if (ok) {
+        glProgramBinary(program, format, binary, length);
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    free(binary);
+    return linked;
+}
+
+// Write to a private temporary name and rename it into place, so programs
+// starting side by side never read a half-written file
+static void storeBinary(unsigned int program, const char* name, uint64_t key) {
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0 || !makeDirectories(cacheRoot())) {
+        return;
+    }
+    void* binary = malloc(size);
+    GLenum format = 0;
+    GLsizei length = 0;
+    if (!binary) {
+        return;
+    }
+    glGetProgramBinary(program, size, &length, &format, binary);
+
+    char path[sizeof(cacheDirectory) + 64];
+    char temporary[sizeof(path) + 32];
+    cachePath(path, sizeof(path), name, key);
+    snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, (long)getpid());
+    FILE* f = fopen(temporary, "wb");
+    if (f) {
+        uint32_t version = SHADER_CACHE_VERSION, format32 = format, length32 = length;
+        fwrite(shaderCacheMagic, 1, sizeof(shaderCacheMagic), f);
+        fwrite(&version, sizeof(version), 1, f);
+        fwrite(&format32, sizeof(format32), 1, f);
+        fwrite(&length32, sizeof(length32), 1, f);
+        fwrite(&key, sizeof(key), 1, f);
+        int written = length > 0 && fwrite(binary, 1, length, f) == (size_t)length;
+        if (fclose(f) == 0 && written) {
+            rename(temporary, path);
+        } else {
+            remove(temporary);
+        }
+    }
+    free(binary);
+}
+#endif
+
+static int compileAndLink(unsigned int program, const char* name, const char* vertexSource,
+                          const char* fragmentSource) {
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, name);
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, name);
+    if (!vertexShader || !fragmentShader) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    int success;
+    char infoLog[SHADER_LOG_SIZE];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        printf("%s program link failed: %s\n", name, infoLog);
+        return 0;
+    }
+    return 1;
+}
+
+int shaderProgramBuild(ShaderProgram* p, const char* name, const char* vertexSource, const char* fragmentSource,
+                       const char* const* uniformNames) {
+    memset(p, 0, sizeof(*p));
+    p->program = glCreateProgram();
+
+#ifdef SHADER_BINARY_CACHE
+    int useCache = cacheRoot() && binariesSupported();
+    uint64_t key = useCache ? programKey(vertexSource, fragmentSource) : 0;
+    if (useCache && loadBinary(p->program, name, key)) {
+        p->cached = 1;
+    } else {
+        if (useCache) {
+            // A refused binary can leave the program unusable; start over
+            glDeleteProgram(p->program);
+            p->program = glCreateProgram();
+            glProgramParameteri(p->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        if (!compileAndLink(p->program, name, vertexSource, fragmentSource)) {
+            shaderProgramDestroy(p);
+            return 0;
+        }
+        if (useCache) {
+            storeBinary(p->program, name, key);
+        }
+    }
+#else
+    if (!compileAndLink(p->program, name, vertexSource, fragmentSource)) {
+        shaderProgramDestroy(p);
+        return 0;
+    }
+#endif
+
+    for (int i = 0; uniformNames && uniformNames[i] && i < SHADER_MAX_UNIFORMS; i++) {
+        p->uniforms[i] = glGetUniformLocation(p->program, uniformNames[i]);
+        p->uniformCount = i + 1;
+    }
+    return 1;
+}
+
+void shaderProgramDestroy(ShaderProgram* p) {
+    if (p->program) {
+        glDeleteProgram(p->program);
+    }
+    p->program = 0;
+    p->uniformCount = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+// Linked GLSL programs with their uniform locations looked up once, at link
+// time, instead of by name every frame, and a disk cache of linked program
+// binaries so later launches skip the compiler altogether.
+//
+// The cache holds one file per program, named after the program and a
+// 64-bit FNV-1a hash of its sources and of the GL vendor, renderer and
+// version strings, so a driver update or an edited shader simply misses.
+// A binary the driver refuses is recompiled and the file rewritten. The
+// cache needs GL 4.1 or ARB_get_program_binary and a driver that offers at
+// least one binary format; without them programs are always compiled.
+
+#define SHADER_MAX_UNIFORMS 16
+
+typedef struct {
+    unsigned int program;
+    int cached;  // 1 if the binary came from the disk cache
+    int uniformCount;
+    int uniforms[SHADER_MAX_UNIFORMS];  // locations, in the order the names were given
+} ShaderProgram;
+
+// Where binaries are kept: $XDG_CACHE_HOME/peace, else ~/.cache/peace, unless
+// set here first. NULL or "" turns the cache off.
+void shaderCacheSetDirectory(const char* directory);
+
+// Compile and link (or load) a program and look up uniformNames, a NULL
+// terminated list. name labels the cache file and error messages. Returns 0
+// and prints the compiler or linker log on failure.
+int shaderProgramBuild(ShaderProgram* p, const char* name, const char* vertexSource, const char* fragmentSource,
+                       const char* const* uniformNames);
+
+void shaderProgramDestroy(ShaderProgram* p);
+
+#endif
@@ -0,0 +1,47 @@
+#include "sim_clock.h"
+
+void simClockInit(SimClock* c, double step, int maxSteps, double now) {
+    c->step = step;
+    c->maxSteps = maxSteps;
+    c->time = now;
+    c->accumulator = 0.0;
+    c->lastNow = now;
+    c->frameSteps = 0;
+    c->dropped = 0;
+}
+
+void simClockBegin(SimClock* c, double now) {
+    // A clock that jumped backwards (a rewound replay, say) restarts from here
+    if (now > c->lastNow) {
+        c->accumulator += now - c->lastNow;
+    }
+    c->lastNow = now;
+    c->frameSteps = 0;
+}
+
+int simClockStep(SimClock* c) {
+    // The slack absorbs rounding when the frame clock itself ticks in steps
+    double due = c->step * (1.0 - 1e-6);
+    if (c->accumulator < due) {
+        return 0;
+    }
+    if (c->frameSteps == c->maxSteps) {
+        // Keep the fraction of a step so presentation stays smooth
+        long long behind = (long long)(c->accumulator / c->step);
+        c->accumulator -= behind * c->step;
+        c->dropped += behind;
+        return 0;
+    }
+    c->accumulator -= c->step;
+    if (c->accumulator < 0.0) {
+        c->accumulator = 0.0;
+    }
+    c->time += c->step;
+    c->frameSteps++;
+    return 1;
+}
+
+float simClockAlpha(const SimClock* c) {
+    float alpha = (float)(c->accumulator / c->step);
+    return alpha < 1.0f ? alpha : 1.0f;
+}
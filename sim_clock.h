@@ -0,0 +1,34 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+// Fixed-timestep simulation clock. Each frame hands it the current time;
+// the caller then runs one simulation step per simClockStep() that returns
+// 1 and draws the state interpolated simClockAlpha() of the way from the
+// previous step to the latest one. Animation speed is then independent of
+// the render rate, and a frame that falls behind catches up by running
+// several steps. A frame that falls more than maxSteps behind drops the
+// rest of the backlog, so a stall never turns into a spiral of
+// ever-longer frames.
+
+typedef struct {
+    double step;  // seconds per simulation step
+    int maxSteps;  // most steps one frame may run
+    double time;  // simulated time of the latest step
+    double accumulator;  // elapsed time not yet simulated
+    double lastNow;
+    int frameSteps;  // steps run so far this frame
+    long long dropped;  // steps skipped because a frame fell too far behind
+} SimClock;
+
+void simClockInit(SimClock* c, double step, int maxSteps, double now);
+
+// Start a frame at time now
+void simClockBegin(SimClock* c, double now);
+
+// Returns 1 and advances c->time by one step while a step is due
+int simClockStep(SimClock* c);
+
+// How far presentation sits between the previous step and the latest one
+float simClockAlpha(const SimClock* c);
+
+#endif
@@ -9,6 +9,18 @@
 #include <GLFW/glfw3.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "headless.h"
+#include "snapshot.h"
+
+// --headless draws with no window system, into an offscreen framebuffer
+HeadlessContext headless;
+
+// Wall time, from GLFW or, when it is not running, the headless clock
+double wallClock() {
+    return headless.backend != HEADLESS_NONE ? headlessTime() : glfwGetTime();
+}
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
@@ -18,38 +30,73 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glMatrixMode(GL_MODELVIEW);
 }
 
-int main() {
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
-        return -1;
+int main(int argc, char* argv[]) {
+    // --snapshot=FILE draws a fixed-time frame for the regression harness
+    // (snapshot.h); --headless, which needs it, does so with no window
+    Snapshot snapshot;
+    snapshotInit(&snapshot);
+    int headlessMode = 0;
+    const char* headlessBackend = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (snapshotOption(&snapshot, argv[i])) {
+            continue;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = 1;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessMode = 1;
+            headlessBackend = argv[i] + 11;
+        }
     }
-
-    GLFWwindow* window =
-        glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
-    if (!window) {
-        printf("Failed to create window\n");
-        glfwTerminate();
+    if (headlessMode && !snapshot.path) {
+        printf("--headless needs --snapshot\n");
         return -1;
     }
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSwapInterval(1);  // Enable vsync
+    // Headless runs never start GLFW and leave window NULL
+    GLFWwindow* window = NULL;
+    int width = 800, height = 600;
+    if (headlessMode) {
+        if (!headlessCreate(&headless, headlessBackend, width, height, 0, 0,
+                            0)) {
+            printf("Failed to create a headless context\n");
+            return -1;
+        }
+    } else {
+        if (!glfwInit()) {
+            printf("Failed to initialize GLFW\n");
+            return -1;
+        }
+        if (snapshot.path) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+
+        window = glfwCreateWindow(width, height, "Peaceful Waves", NULL, NULL);
+        if (!window) {
+            printf("Failed to create window\n");
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        // Enable vsync, except for snapshots, which time their frames
+        glfwSwapInterval(snapshot.path ? 0 : 1);
+        glfwGetFramebufferSize(window, &width, &height);
+    }
 
     // Initialize projection
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
     glViewport(0, 0, width, height);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     glOrtho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
     glMatrixMode(GL_MODELVIEW);
 
-    while (!glfwWindowShouldClose(window)) {
-        float time = glfwGetTime();
+    while (!window || !glfwWindowShouldClose(window)) {
+        double frameStart = wallClock();
+        float time = snapshot.path ? snapshotClock(&snapshot) : glfwGetTime();
 
         // Clear with a soft background gradient that shifts colors
         float bgHue = sin(time * 0.1) * 0.5 + 0.5;
@@ -115,10 +162,23 @@ int main() {
             glEnd();
         }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        snapshotCapture(&snapshot, width, height);
+        if (window) {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        } else {
+            headlessFinishFrame(&headless);
+        }
+        if (snapshotFrameDone(&snapshot, (wallClock() - frameStart) * 1000.0)) {
+            break;
+        }
     }
 
-    glfwTerminate();
+    snapshotDestroy(&snapshot);
+    if (window) {
+        glfwTerminate();
+    } else {
+        headlessDestroy(&headless);
+    }
     return 0;
 }
\ No newline at end of file
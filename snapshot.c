@@ -0,0 +1,94 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+void snapshotInit(Snapshot* s) {
+    memset(s, 0, sizeof(*s));
+    s->time = SNAPSHOT_DEFAULT_TIME;
+    s->frames = SNAPSHOT_DEFAULT_FRAMES;
+}
+
+int snapshotOption(Snapshot* s, const char* arg) {
+    if (strncmp(arg, "--snapshot=", 11) == 0) {
+        s->path = arg + 11;
+    } else if (strncmp(arg, "--snapshot-time=", 16) == 0) {
+        s->time = atof(arg + 16);
+    } else if (strncmp(arg, "--snapshot-frames=", 18) == 0) {
+        s->frames = atoi(arg + 18);
+        if (s->frames < 1) {
+            s->frames = 1;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+double snapshotClock(const Snapshot* s) {
+    return s->time - (s->frames - 1 - s->frame) * SNAPSHOT_TIMESTEP;
+}
+
+void snapshotCapture(Snapshot* s, int width, int height) {
+    if (!s->path || s->frame != s->frames - 1 || width <= 0 || height <= 0) {
+        return;
+    }
+    free(s->pixels);
+    s->pixels = malloc((size_t)width * height * 3);
+    if (!s->pixels) {
+        return;
+    }
+    s->width = width;
+    s->height = height;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, s->pixels);
+}
+
+static int writeSnapshot(const Snapshot* s) {
+    FILE* f = fopen(s->path, "wb");
+    if (!f) {
+        return 0;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", s->width, s->height);
+    for (int y = s->height - 1; y >= 0; y--) {
+        fwrite(s->pixels + (size_t)y * s->width * 3, 1, s->width * 3, f);
+    }
+    return fclose(f) == 0;
+}
+
+int snapshotFrameDone(Snapshot* s, double frameMs) {
+    if (!s->path) {
+        return 0;
+    }
+    if (!s->samples.samples) {
+        benchSamplesInit(&s->samples, s->frames);
+    }
+    benchSamplesAdd(&s->samples, frameMs);
+    if (++s->frame < s->frames) {
+        return 0;
+    }
+
+    if (!s->pixels || !writeSnapshot(s)) {
+        printf("Failed to write the snapshot to %s\n", s->path);
+    }
+    BenchSummary summary;
+    if (benchSummarize(&s->samples, &summary)) {
+        printf("snapshot: %d frames, p50 %.3f ms, mean %.3f ms\n", summary.count, summary.p50, summary.mean);
+    }
+    return 1;
+}
+
+void snapshotDestroy(Snapshot* s) {
+    free(s->pixels);
+    s->pixels = NULL;
+    benchSamplesFree(&s->samples);
+}
@@ -0,0 +1,50 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Fixed-time frames for the regression harness (regress.sh). With
+// --snapshot=FILE a program draws --snapshot-frames frames (60 by default)
+// on a simulated 60 Hz clock that reaches --snapshot-time (2 seconds) on
+// the last one, writes that frame to FILE as a PPM and stops. It then
+// prints one line for the harness to record:
+//
+//   snapshot: 60 frames, p50 1.234 ms, mean 1.301 ms
+//
+// Each frame is timed from the start of drawing to the end of the swap (or
+// headlessFinishFrame), so the figures only mean something without vsync.
+
+#include "bench.h"
+
+#define SNAPSHOT_DEFAULT_TIME 2.0
+#define SNAPSHOT_DEFAULT_FRAMES 60
+#define SNAPSHOT_TIMESTEP (1.0 / 60.0)
+
+typedef struct {
+    const char* path;  // NULL when off
+    double time;
+    int frames;
+    int frame;  // frames finished so far
+
+    unsigned char* pixels;  // the last frame, bottom row first
+    int width, height;
+    BenchSamples samples;
+} Snapshot;
+
+// Off, with the default time and frame count
+void snapshotInit(Snapshot* s);
+
+// Take arg if it is one of the snapshot options. Returns 1 if it was.
+int snapshotOption(Snapshot* s, const char* arg);
+
+// The clock reading the next frame is drawn at
+double snapshotClock(const Snapshot* s);
+
+// Call once the frame is drawn, before the swap; reads back the last one
+void snapshotCapture(Snapshot* s, int width, int height);
+
+// Call after the swap with the frame's time. Returns 1 once the last frame
+// is done, after writing the file and printing the summary.
+int snapshotFrameDone(Snapshot* s, double frameMs);
+
+void snapshotDestroy(Snapshot* s);
+
+#endif
@@ -0,0 +1,221 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gl_caps.h"
+#include "sprites.h"
+#include "stream_buffer.h"
+
+// Instancing needs GL 3.3 entry points, which only libGL on Linux/BSD exports
+// directly; Windows and macOS legacy contexts use the fan fallback.
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define SPRITES_INSTANCED 1
+#endif
+
+// Unit circle rim, shared by both paths so no cos/sin runs per sprite
+static float unitCircle[SPRITE_SEGMENTS + 1][2];
+static int unitCircleReady = 0;
+
+static void buildUnitCircle(void) {
+    for (int j = 0; j <= SPRITE_SEGMENTS; j++) {
+        float angle = j * 2.0f * 3.14159f / SPRITE_SEGMENTS;
+        unitCircle[j][0] = cosf(angle);
+        unitCircle[j][1] = sinf(angle);
+    }
+    unitCircleReady = 1;
+}
+
+#ifdef SPRITES_INSTANCED
+static int instanced = 0;
+static GLuint spriteProgram = 0;
+static GLuint meshVBO = 0;
+static StreamBuffer instanceStream;
+static GLint cornerAttrib, centerSizeAttrib, colorAttrib;
+
+static const char* spriteVertexShaderSource = "#version 120\n"
+    "attribute vec3 aCorner;\n"      // unit circle offset, z = 1 at the fan centre
+    "attribute vec4 aCenterSize;\n"  // centre x, y, radius, rim alpha factor
+    "attribute vec4 aColor;\n"
+    "varying vec4 vColor;\n"
+    "void main() {\n"
+    "   vColor = vec4(aColor.rgb, aColor.a * mix(aCenterSize.w, 1.0, aCorner.z));\n"
+    "   vec2 pos = aCenterSize.xy + aCorner.xy * aCenterSize.z;\n"
+    "   gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* spriteFragmentShaderSource = "#version 120\n"
+    "varying vec4 vColor;\n"
+    "void main() {\n"
+    "   gl_FragColor = vColor;\n"
+    "}\n";
+
+static GLuint compileSpriteShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        fprintf(stderr, "Sprite shader compilation failed: %s\n", infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+static int contextHasInstancing(void) {
+    return glCapsVersionAtLeast(3, 3);
+}
+#endif
+
+int spriteRendererInit(void) {
+    buildUnitCircle();
+
+#ifdef SPRITES_INSTANCED
+    if (!contextHasInstancing()) {
+        return 0;
+    }
+
+    GLuint vertexShader = compileSpriteShader(GL_VERTEX_SHADER, spriteVertexShaderSource);
+    GLuint fragmentShader = compileSpriteShader(GL_FRAGMENT_SHADER, spriteFragmentShaderSource);
+    if (!vertexShader || !fragmentShader) {
+        if (vertexShader) glDeleteShader(vertexShader);
+        if (fragmentShader) glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    spriteProgram = glCreateProgram();
+    glAttachShader(spriteProgram, vertexShader);
+    glAttachShader(spriteProgram, fragmentShader);
+    glBindAttribLocation(spriteProgram, 0, "aCorner");
+    glLinkProgram(spriteProgram);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    int success;
+    glGetProgramiv(spriteProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(spriteProgram);
+        spriteProgram = 0;
+        return 0;
+    }
+
+    cornerAttrib = glGetAttribLocation(spriteProgram, "aCorner");
+    centerSizeAttrib = glGetAttribLocation(spriteProgram, "aCenterSize");
+    colorAttrib = glGetAttribLocation(spriteProgram, "aColor");
+
+    // Fan: centre vertex followed by the closed rim
+    float mesh[(SPRITE_SEGMENTS + 2) * 3] = {0.0f, 0.0f, 1.0f};
+    for (int j = 0; j <= SPRITE_SEGMENTS; j++) {
+        mesh[(j + 1) * 3 + 0] = unitCircle[j][0];
+        mesh[(j + 1) * 3 + 1] = unitCircle[j][1];
+        mesh[(j + 1) * 3 + 2] = 0.0f;
+    }
+
+    glGenBuffers(1, &meshVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(mesh), mesh, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!streamBufferInit(&instanceStream, SPRITE_STREAM_CAPACITY * sizeof(Sprite))) {
+        glDeleteBuffers(1, &meshVBO);
+        glDeleteProgram(spriteProgram);
+        return 0;
+    }
+
+    instanced = 1;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void spriteRendererDestroy(void) {
+#ifdef SPRITES_INSTANCED
+    if (instanced) {
+        glDeleteBuffers(1, &meshVBO);
+        streamBufferDestroy(&instanceStream);
+        glDeleteProgram(spriteProgram);
+        instanced = 0;
+    }
+#endif
+}
+
+static void spriteDrawFans(const Sprite* sprites, int count) {
+    if (!unitCircleReady) {
+        buildUnitCircle();
+    }
+
+    for (int i = 0; i < count; i++) {
+        const Sprite* s = &sprites[i];
+        glBegin(GL_TRIANGLE_FAN);
+        glColor4f(s->r, s->g, s->b, s->a);
+        glVertex2f(s->x, s->y);
+        glColor4f(s->r, s->g, s->b, s->a * s->edgeAlpha);
+        for (int j = 0; j <= SPRITE_SEGMENTS; j++) {
+            glVertex2f(s->x + unitCircle[j][0] * s->size, s->y + unitCircle[j][1] * s->size);
+        }
+        glEnd();
+    }
+}
+
+void spriteDraw(const Sprite* sprites, int count) {
+    if (count <= 0) {
+        return;
+    }
+
+#ifdef SPRITES_INSTANCED
+    // Batches beyond the streaming capacity take the fan path
+    size_t offset;
+    Sprite* instances = NULL;
+    if (instanced) {
+        streamBufferBeginFrame(&instanceStream);
+        instances = streamBufferReserve(&instanceStream, count * sizeof(Sprite), &offset);
+    }
+    if (instances) {
+        memcpy(instances, sprites, count * sizeof(Sprite));
+        streamBufferCommit(&instanceStream);
+
+        glUseProgram(spriteProgram);
+
+        glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        glEnableVertexAttribArray(cornerAttrib);
+        glVertexAttribPointer(cornerAttrib, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+        const char* base = streamBufferBind(&instanceStream, offset);
+        glEnableVertexAttribArray(centerSizeAttrib);
+        glVertexAttribPointer(centerSizeAttrib, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), base);
+        glVertexAttribDivisor(centerSizeAttrib, 1);
+        glEnableVertexAttribArray(colorAttrib);
+        glVertexAttribPointer(colorAttrib, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + 4 * sizeof(float));
+        glVertexAttribDivisor(colorAttrib, 1);
+
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, SPRITE_SEGMENTS + 2, count);
+        streamBufferEndFrame(&instanceStream);
+
+        glVertexAttribDivisor(centerSizeAttrib, 0);
+        glVertexAttribDivisor(colorAttrib, 0);
+        glDisableVertexAttribArray(cornerAttrib);
+        glDisableVertexAttribArray(centerSizeAttrib);
+        glDisableVertexAttribArray(colorAttrib);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glUseProgram(0);
+        return;
+    }
+#endif
+
+    spriteDrawFans(sprites, count);
+}
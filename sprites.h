@@ -0,0 +1,26 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+// Batched circular sprites (orbs, particles, markers). All sprites share one
+// unit-circle fan; each instance only carries its centre, radius and colour.
+
+#define SPRITE_SEGMENTS 20
+// Most sprites one spriteDraw() call can stream to the instanced path
+#define SPRITE_STREAM_CAPACITY 1024
+
+typedef struct {
+    float x, y;
+    float size;
+    float edgeAlpha;  // rim alpha relative to the centre: 0 gives a soft glow, 1 a solid disc
+    float r, g, b, a;
+} Sprite;
+
+// Set up the instanced path. Returns 0 when the context lacks instancing, in
+// which case spriteDraw() falls back to one fan per sprite.
+int spriteRendererInit(void);
+void spriteRendererDestroy(void);
+
+// Draw sprites in order, with a single instanced call when available
+void spriteDraw(const Sprite* sprites, int count);
+
+#endif
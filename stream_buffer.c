@@ -0,0 +1,196 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gl_caps.h"
+#include "stream_buffer.h"
+
+// VBOs are GL 1.5 and buffer storage/sync objects GL 4.4/3.2 entry points.
+// The Windows opengl32 import library exports neither, and the macOS legacy
+// context stops at 2.1.
+#ifndef _WIN32
+#define STREAM_BUFFER_VBO 1
+#endif
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define STREAM_BUFFER_STORAGE 1
+#endif
+
+#ifdef STREAM_BUFFER_STORAGE
+static int initPersistent(StreamBuffer* sb) {
+    if (!glCapsVersionAtLeast(4, 4) && !(glCapsHasExtension("GL_ARB_buffer_storage") &&
+                                         (glCapsVersionAtLeast(3, 2) || glCapsHasExtension("GL_ARB_sync")))) {
+        return 0;
+    }
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr size = (GLsizeiptr)(sb->segmentSize * STREAM_BUFFER_SEGMENTS);
+
+    glGenBuffers(1, &sb->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, sb->buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    sb->mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!sb->mapped) {
+        glDeleteBuffers(1, &sb->buffer);
+        sb->buffer = 0;
+        return 0;
+    }
+    return 1;
+}
+#endif
+
+int streamBufferInit(StreamBuffer* sb, size_t segmentSize) {
+    memset(sb, 0, sizeof(*sb));
+    sb->segmentSize = STREAM_BUFFER_ALIGNED(segmentSize);
+    // Begin advances before writing, so the first frame lands in segment 0
+    sb->segment = STREAM_BUFFER_SEGMENTS - 1;
+
+#ifdef STREAM_BUFFER_STORAGE
+    if (initPersistent(sb)) {
+        sb->mode = STREAM_BUFFER_PERSISTENT;
+        return 1;
+    }
+#endif
+
+    sb->staging = malloc(sb->segmentSize);
+    if (!sb->staging) {
+        return 0;
+    }
+    sb->mode = STREAM_BUFFER_CLIENT;
+
+#ifdef STREAM_BUFFER_VBO
+    if (glCapsVersionAtLeast(1, 5)) {
+        glGenBuffers(1, &sb->buffer);
+        sb->mode = STREAM_BUFFER_ORPHAN;
+    }
+#endif
+    return 1;
+}
+
+void streamBufferDestroy(StreamBuffer* sb) {
+#ifdef STREAM_BUFFER_STORAGE
+    for (int i = 0; i < STREAM_BUFFER_SEGMENTS; i++) {
+        if (sb->fences[i]) {
+            glDeleteSync((GLsync)sb->fences[i]);
+        }
+    }
+    if (sb->mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, sb->buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#endif
+#ifdef STREAM_BUFFER_VBO
+    if (sb->buffer) {
+        glDeleteBuffers(1, &sb->buffer);
+    }
+#endif
+    free(sb->staging);
+    memset(sb, 0, sizeof(*sb));
+}
+
+void streamBufferBeginFrame(StreamBuffer* sb) {
+    sb->segment = (sb->segment + 1) % STREAM_BUFFER_SEGMENTS;
+    sb->used = 0;
+    sb->committed = 0;
+
+#ifdef STREAM_BUFFER_STORAGE
+    // Normally signalled long ago: the fence went in STREAM_BUFFER_SEGMENTS frames back
+    GLsync fence = (GLsync)sb->fences[sb->segment];
+    if (fence) {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(fence);
+        sb->fences[sb->segment] = NULL;
+    }
+#endif
+#ifdef STREAM_BUFFER_VBO
+    if (sb->mode == STREAM_BUFFER_ORPHAN) {
+        // The driver hands back fresh storage instead of waiting for the GPU
+        glBindBuffer(GL_ARRAY_BUFFER, sb->buffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)sb->segmentSize, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#endif
+}
+
+void* streamBufferReserve(StreamBuffer* sb, size_t bytes, size_t* offset) {
+    size_t start = sb->used;
+    if (bytes > sb->segmentSize - start) {
+        return NULL;
+    }
+    sb->used = STREAM_BUFFER_ALIGNED(start + bytes);
+    if (sb->used > sb->segmentSize) {
+        sb->used = sb->segmentSize;
+    }
+
+    if (sb->mode == STREAM_BUFFER_PERSISTENT) {
+        *offset = sb->segment * sb->segmentSize + start;
+        return sb->mapped + *offset;
+    }
+    *offset = start;
+    return sb->staging + start;
+}
+
+void streamBufferCommit(StreamBuffer* sb) {
+#ifdef STREAM_BUFFER_VBO
+    if (sb->mode == STREAM_BUFFER_ORPHAN && sb->used > sb->committed) {
+        glBindBuffer(GL_ARRAY_BUFFER, sb->buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)sb->committed, (GLsizeiptr)(sb->used - sb->committed),
+                        sb->staging + sb->committed);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#endif
+    sb->committed = sb->used;
+}
+
+const void* streamBufferBind(StreamBuffer* sb, size_t offset) {
+    if (sb->mode == STREAM_BUFFER_CLIENT) {
+        return sb->staging + offset;
+    }
+#ifdef STREAM_BUFFER_VBO
+    glBindBuffer(GL_ARRAY_BUFFER, sb->buffer);
+#endif
+    return (const void*)offset;
+}
+
+void streamBufferUnbind(StreamBuffer* sb) {
+#ifdef STREAM_BUFFER_VBO
+    if (sb->mode != STREAM_BUFFER_CLIENT) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#else
+    (void)sb;
+#endif
+}
+
+void streamBufferEndFrame(StreamBuffer* sb) {
+#ifdef STREAM_BUFFER_STORAGE
+    if (sb->mode == STREAM_BUFFER_PERSISTENT) {
+        sb->fences[sb->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+#else
+    (void)sb;
+#endif
+}
+
+const char* streamBufferModeName(const StreamBuffer* sb) {
+    switch (sb->mode) {
+        case STREAM_BUFFER_PERSISTENT:
+            return "persistent";
+        case STREAM_BUFFER_ORPHAN:
+            return "orphan";
+        default:
+            return "client";
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <stddef.h>
+
+// Vertex storage for geometry that is rewritten every frame.
+//
+// With GL 4.4 or ARB_buffer_storage the buffer is mapped once, persistently
+// and coherently, and split into STREAM_BUFFER_SEGMENTS segments. Each frame
+// writes the next segment while the GPU may still be reading the previous
+// ones, and a fence per segment stops the CPU from overwriting one the GPU
+// has not finished with. Older contexts orphan the buffer every frame
+// (glBufferData with NULL) and upload a staging copy; builds without VBO
+// entry points draw straight from the staging memory as client arrays.
+
+#define STREAM_BUFFER_SEGMENTS 3
+
+// Every range starts on this boundary, suitably aligned for any vertex
+// attribute type, so a segment that holds several ranges must be sized
+// with each one rounded up
+#define STREAM_BUFFER_ALIGN 64
+#define STREAM_BUFFER_ALIGNED(bytes) (((bytes) + STREAM_BUFFER_ALIGN - 1) & ~(size_t)(STREAM_BUFFER_ALIGN - 1))
+
+typedef enum {
+    STREAM_BUFFER_CLIENT,  // no VBOs: client-side arrays
+    STREAM_BUFFER_ORPHAN,  // glBufferData(NULL) + glBufferSubData
+    STREAM_BUFFER_PERSISTENT  // mapped ring with fences
+} StreamBufferMode;
+
+typedef struct {
+    StreamBufferMode mode;
+    unsigned int buffer;
+    size_t segmentSize;
+    int segment;
+    size_t used;  // bytes reserved in the current segment
+    size_t committed;  // bytes of the current segment already uploaded (orphan mode)
+    unsigned char* mapped;  // all segments (persistent mode)
+    unsigned char* staging;  // one segment (client and orphan modes)
+    void* fences[STREAM_BUFFER_SEGMENTS];  // GLsync
+} StreamBuffer;
+
+// Needs a current context. segmentSize is the most one frame can write.
+// Returns 0 if memory could not be allocated.
+int streamBufferInit(StreamBuffer* sb, size_t segmentSize);
+void streamBufferDestroy(StreamBuffer* sb);
+
+// Start filling the next segment, waiting first if the GPU may still read it
+void streamBufferBeginFrame(StreamBuffer* sb);
+
+// Reserve the next bytes of the current segment; NULL if it is full.
+// *offset receives the value to hand to streamBufferBind for this range.
+void* streamBufferReserve(StreamBuffer* sb, size_t bytes, size_t* offset);
+
+// Make everything reserved so far visible to the GPU. Call after writing
+// and before drawing; only orphan mode has anything to do.
+void streamBufferCommit(StreamBuffer* sb);
+
+// Bind the buffer and return the pointer argument for glVertexPointer,
+// glVertexAttribPointer and friends that addresses offset
+const void* streamBufferBind(StreamBuffer* sb, size_t offset);
+void streamBufferUnbind(StreamBuffer* sb);
+
+// Fence the segment once the draws reading it have been issued
+void streamBufferEndFrame(StreamBuffer* sb);
+
+const char* streamBufferModeName(const StreamBuffer* sb);
+
+#endif
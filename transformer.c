@@ -14,10 +14,31 @@
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
+#include "headless.h"
+#include "idle_governor.h"
+#include "input_log.h"
+#include "sim_clock.h"
+#include "snapshot.h"
+#include "stream_buffer.h"
 
 #define PI 3.14159265359f
 #define NUM_TOKENS 5
 #define NUM_LAYERS 6
+#define SPHERE_SEGMENTS 16
+#define SPHERE_RINGS 12
+#define SPHERE_VERTICES (SPHERE_RINGS * SPHERE_SEGMENTS * 6)
+// Room for one frame's streamed geometry. Text, a point per covered pixel,
+// is nearly all of it; the busiest frames use under 5 MB.
+#define FRAME_STREAM_BYTES (8 << 20)
+
+// The animation advances in fixed steps, whatever the display refresh rate
+#define SIM_TIMESTEP (1.0 / 60.0)
+#define SIM_MAX_STEPS 8
+
+// Animation timeline
+#define LAYER_TIME 3.0f  // 3 seconds per layer (was 1 second)
+#define PASS_TIME (NUM_LAYERS * LAYER_TIME)  // Time per forward pass = 18 seconds
+#define TOTAL_TIME (NUM_TOKENS * PASS_TIME)  // Total animation cycle = 90 seconds
 
 // Camera state
 float zoom = 8.0f;  // Start zoomed all the way in
@@ -35,6 +56,38 @@ double lastMouseY = 0;
 // Animation pause state
 int isPaused = 0;
 
+// While paused only the background and glows drift, so after a spell
+// without input the redraw rate drops to --idle-fps
+IdleGovernor idleGovernor;
+
+// --record=FILE logs live input with each frame's clock; --replay=FILE
+// ignores live input and drives the same handlers, and the clock, from a log
+InputLog inputLog;
+
+// --headless replays a log with no window system: no GLFW window, and
+// frames go to an offscreen framebuffer
+HeadlessContext headlessContext;
+
+// Tracked here because a headless run has no window to ask
+int framebufferWidth = 1200;
+int framebufferHeight = 900;
+
+// --snapshot=FILE draws a fixed-time frame for the regression harness
+// (snapshot.h), on its own simulated clock
+Snapshot snapshot;
+
+// Wall time, from GLFW or, when it is not running, the headless clock
+double wallClock() {
+    return headlessContext.backend != HEADLESS_NONE ? headlessTime() : glfwGetTime();
+}
+
+double currentTime() {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return inputLog.time;
+    }
+    return snapshot.path ? snapshotClock(&snapshot) : wallClock();
+}
+
 // Token colors and labels
 typedef struct {
     float r, g, b;
@@ -58,7 +111,18 @@ Vec3 tokenPositions[NUM_TOKENS][NUM_LAYERS];
 float animationPhase = 0.0f;
 int currentLayer = 0;
 int currentForwardPass = 1;  // Which forward pass we're on (1-5)
-float animationSpeed = 0.01f;  // Adjustable speed multiplier
+float animationSpeed = 0.01f;  // Adjustable speed multiplier, per simulation step
+
+// State that advances step by step. animationPhase and cameraY above are
+// what gets drawn: these two steps blended by the clock's alpha.
+typedef struct {
+    float animationPhase;
+    float cameraY;
+} SimState;
+
+SimClock simClock;
+SimState simPrevious;
+SimState simCurrent;
 
 // Simulated attention weights for visualization (Q @ K^T result)
 float attentionWeights[NUM_TOKENS][NUM_TOKENS];
@@ -69,24 +133,45 @@ unsigned char* fontBuffer = NULL;
 unsigned char* fontBitmap = NULL;
 int bitmapW = 512, bitmapH = 512;
 
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+void applyScroll(GLFWwindow* window, double xoffset, double yoffset) {
     zoom += (float)yoffset * 0.2f;
     if (zoom < 0.5f) zoom = 0.5f;  // Allow much more zoom out
     if (zoom > 8.0f) zoom = 8.0f;
 }
 
-void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogScroll(&inputLog, xoffset, yoffset);
+    idleGovernorInput(&idleGovernor);
+    applyScroll(window, xoffset, yoffset);
+}
+
+void applyButton(GLFWwindow* window, int button, int action, int mods, double xpos, double ypos) {
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == GLFW_PRESS) {
             isDragging = 1;
-            glfwGetCursorPos(window, &lastMouseX, &lastMouseY);
+            lastMouseX = xpos;
+            lastMouseY = ypos;
         } else if (action == GLFW_RELEASE) {
             isDragging = 0;
         }
     }
 }
 
-void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    inputLogButton(&inputLog, button, action, mods, xpos, ypos);
+    idleGovernorInput(&idleGovernor);
+    applyButton(window, button, action, mods, xpos, ypos);
+}
+
+void applyCursor(GLFWwindow* window, double xpos, double ypos) {
     if (isDragging) {
         double dx = xpos - lastMouseX;
         double dy = ypos - lastMouseY;
@@ -100,7 +185,16 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
     }
 }
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogCursor(&inputLog, xpos, ypos);
+    idleGovernorInput(&idleGovernor);
+    applyCursor(window, xpos, ypos);
+}
+
+void applyKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
         isPaused = !isPaused;
     }
@@ -116,16 +210,83 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     }
 
     // Animation scrubbing with arrow keys
+    // Both steps jump, so the blend between them does not smear the cut
     if (key == GLFW_KEY_RIGHT && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
-        animationPhase += 0.5f;  // Fast forward
+        simCurrent.animationPhase += 0.5f;  // Fast forward
+        simPrevious.animationPhase += 0.5f;
     }
     if (key == GLFW_KEY_LEFT && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
-        animationPhase -= 0.5f;  // Rewind
-        if (animationPhase < 0.0f) animationPhase = 0.0f;
+        simCurrent.animationPhase -= 0.5f;  // Rewind
+        simPrevious.animationPhase -= 0.5f;
+        if (simCurrent.animationPhase < 0.0f) simCurrent.animationPhase = 0.0f;
+        if (simPrevious.animationPhase < 0.0f) simPrevious.animationPhase = 0.0f;
     }
 }
 
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogKey(&inputLog, key, scancode, action, mods);
+    idleGovernorInput(&idleGovernor);
+    applyKey(window, key, scancode, action, mods);
+}
+
+// Simple autoregressive: cycle through forward passes. Each forward pass
+// goes through all 6 layers, then moves to next pass.
+void animationPosition(float phase, int* forwardPass, int* layer, float* layerBlend) {
+    float cyclePhase = fmodf(phase, TOTAL_TIME);
+
+    // Determine current forward pass (1-5)
+    *forwardPass = ((int)(cyclePhase / PASS_TIME)) + 1;
+    if (*forwardPass > NUM_TOKENS) *forwardPass = NUM_TOKENS;
+
+    // Within current pass, which layer (0-5)
+    float passLocalTime = fmodf(cyclePhase, PASS_TIME);
+    *layer = (int)(passLocalTime / LAYER_TIME);
+    if (*layer >= NUM_LAYERS) *layer = NUM_LAYERS - 1;
+
+    // Blend between layers
+    *layerBlend = fmodf(passLocalTime, LAYER_TIME) / LAYER_TIME;
+}
+
+// Advance the animation by one SIM_TIMESTEP ending at simulated time t
+void simulationStep(double t) {
+    simPrevious = simCurrent;
+
+    // Animation: progress through layers
+    // Pause at start to show the words
+    if (t < 5.0) {
+        simCurrent.animationPhase = 0.0f;  // Hold at layer 0 for first 5 seconds
+    } else if (!isPaused) {
+        simCurrent.animationPhase += animationSpeed;  // User-adjustable speed!
+    }
+
+    // Camera follows the action - starts at bottom (words) and moves up through layers
+    int forwardPass, layer;
+    float layerBlend;
+    animationPosition(simCurrent.animationPhase, &forwardPass, &layer, &layerBlend);
+    float targetY = -2.5f + (layer + layerBlend) * 0.4f;  // Follow the layers up
+    simCurrent.cameraY += (targetY - simCurrent.cameraY) * 0.05f;  // Smooth following
+}
+
+// Pointer positions in a log only mean the same thing at the same size
+void replayResize(GLFWwindow* window, int width, int height) {
+    static int warned = 0;
+    if (!warned && (width != framebufferWidth || height != framebufferHeight)) {
+        fprintf(stderr, "Input log was recorded at %dx%d, replaying at %dx%d\n", width, height, framebufferWidth,
+                framebufferHeight);
+        warned = 1;
+    }
+}
+
+const InputLogHandlers replayHandlers = {applyCursor, applyButton, applyScroll, applyKey, replayResize};
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    inputLogResize(&inputLog, width, height);
+    idleGovernorDamage(&idleGovernor);
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -139,79 +300,170 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glMatrixMode(GL_MODELVIEW);
 }
 
-void drawSphere(float x, float y, float z, float radius, float r, float g, float b, float alpha) {
-    int segments = 16;
-    int rings = 12;
-
-    glBegin(GL_TRIANGLES);
-    for (int ring = 0; ring < rings; ring++) {
-        float phi0 = PI * ring / rings;
-        float phi1 = PI * (ring + 1) / rings;
-
-        for (int seg = 0; seg < segments; seg++) {
-            float theta0 = 2.0f * PI * seg / segments;
-            float theta1 = 2.0f * PI * (seg + 1) / segments;
-
-            // Vertex positions
-            float x0 = sinf(phi0) * cosf(theta0);
-            float y0 = cosf(phi0);
-            float z0 = sinf(phi0) * sinf(theta0);
-
-            float x1 = sinf(phi0) * cosf(theta1);
-            float y1 = cosf(phi0);
-            float z1 = sinf(phi0) * sinf(theta1);
-
-            float x2 = sinf(phi1) * cosf(theta1);
-            float y2 = cosf(phi1);
-            float z2 = sinf(phi1) * sinf(theta1);
-
-            float x3 = sinf(phi1) * cosf(theta0);
-            float y3 = cosf(phi1);
-            float z3 = sinf(phi1) * sinf(theta0);
-
-            // Lighting based on normal (which equals position for unit sphere)
-            float brightness0 = 0.5f + 0.5f * (x0 * 0.5f + y0 * 0.5f + z0 * 0.3f);
-            float brightness1 = 0.5f + 0.5f * (x1 * 0.5f + y1 * 0.5f + z1 * 0.3f);
-            float brightness2 = 0.5f + 0.5f * (x2 * 0.5f + y2 * 0.5f + z2 * 0.3f);
-            float brightness3 = 0.5f + 0.5f * (x3 * 0.5f + y3 * 0.5f + z3 * 0.3f);
-
-            // First triangle
-            glColor4f(r * brightness0, g * brightness0, b * brightness0, alpha);
-            glVertex3f(x + x0 * radius, y + y0 * radius, z + z0 * radius);
-            glColor4f(r * brightness1, g * brightness1, b * brightness1, alpha);
-            glVertex3f(x + x1 * radius, y + y1 * radius, z + z1 * radius);
-            glColor4f(r * brightness2, g * brightness2, b * brightness2, alpha);
-            glVertex3f(x + x2 * radius, y + y2 * radius, z + z2 * radius);
-
-            // Second triangle
-            glColor4f(r * brightness0, g * brightness0, b * brightness0, alpha);
-            glVertex3f(x + x0 * radius, y + y0 * radius, z + z0 * radius);
-            glColor4f(r * brightness2, g * brightness2, b * brightness2, alpha);
-            glVertex3f(x + x2 * radius, y + y2 * radius, z + z2 * radius);
-            glColor4f(r * brightness3, g * brightness3, b * brightness3, alpha);
-            glVertex3f(x + x3 * radius, y + y3 * radius, z + z3 * radius);
+typedef struct {
+    float x, y, z;
+    float r, g, b, a;
+} ColorVertex;
+
+// Unit sphere triangles with their fixed lighting term (x, y, z, brightness),
+// computed once instead of per orb per frame
+float unitSphere[SPHERE_VERTICES][4];
+
+// All of a frame's geometry is written straight into the streaming buffer:
+// the orbs queued between beginSpheres() and endSpheres(), drawn with a
+// single call, and every run of points, lines, triangles and quads between
+// beginPrimitive() and endPrimitive()
+StreamBuffer frameStream;
+ColorVertex* sphereBatch = NULL;
+size_t sphereBatchOffset = 0;
+int sphereBatchCapacity = 0;
+int sphereBatchCount = 0;
+
+ColorVertex* primitiveBatch = NULL;
+size_t primitiveBatchOffset = 0;
+int primitiveBatchCapacity = 0;
+int primitiveBatchCount = 0;
+GLenum primitiveMode = GL_LINES;
+float primitiveRGBA[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+void buildUnitSphere() {
+    int v = 0;
+    for (int ring = 0; ring < SPHERE_RINGS; ring++) {
+        float phi0 = PI * ring / SPHERE_RINGS;
+        float phi1 = PI * (ring + 1) / SPHERE_RINGS;
+
+        for (int seg = 0; seg < SPHERE_SEGMENTS; seg++) {
+            float theta0 = 2.0f * PI * seg / SPHERE_SEGMENTS;
+            float theta1 = 2.0f * PI * (seg + 1) / SPHERE_SEGMENTS;
+
+            // Quad corners, split into two triangles (0, 1, 2) and (0, 2, 3)
+            float corners[4][3] = {
+                {sinf(phi0) * cosf(theta0), cosf(phi0), sinf(phi0) * sinf(theta0)},
+                {sinf(phi0) * cosf(theta1), cosf(phi0), sinf(phi0) * sinf(theta1)},
+                {sinf(phi1) * cosf(theta1), cosf(phi1), sinf(phi1) * sinf(theta1)},
+                {sinf(phi1) * cosf(theta0), cosf(phi1), sinf(phi1) * sinf(theta0)}
+            };
+            int order[6] = {0, 1, 2, 0, 2, 3};
+
+            for (int k = 0; k < 6; k++) {
+                const float* c = corners[order[k]];
+                unitSphere[v][0] = c[0];
+                unitSphere[v][1] = c[1];
+                unitSphere[v][2] = c[2];
+                // Lighting based on normal (which equals position for unit sphere)
+                unitSphere[v][3] = 0.5f + 0.5f * (c[0] * 0.5f + c[1] * 0.5f + c[2] * 0.3f);
+                v++;
+            }
         }
     }
-    glEnd();
+}
+
+// Draw count streamed vertices starting at offset
+void drawStreamed(GLenum mode, size_t offset, int count) {
+    const char* base = streamBufferBind(&frameStream, offset);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(ColorVertex), base);
+    glColorPointer(4, GL_FLOAT, sizeof(ColorVertex), base + 3 * sizeof(float));
+    glDrawArrays(mode, 0, count);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    streamBufferUnbind(&frameStream);
+}
+
+// Start a run of at most maxVertices drawn as mode, in place of glBegin.
+// A run that does not fit in the rest of the frame's segment is dropped.
+void beginPrimitive(GLenum mode, int maxVertices) {
+    primitiveMode = mode;
+    primitiveBatch = streamBufferReserve(&frameStream, maxVertices * sizeof(ColorVertex), &primitiveBatchOffset);
+    primitiveBatchCapacity = primitiveBatch ? maxVertices : 0;
+    primitiveBatchCount = 0;
+}
+
+// The colour of the vertices that follow, kept across runs like glColor4f
+void primitiveColor(float r, float g, float b, float a) {
+    primitiveRGBA[0] = r;
+    primitiveRGBA[1] = g;
+    primitiveRGBA[2] = b;
+    primitiveRGBA[3] = a;
+}
+
+void primitiveVertex(float x, float y, float z) {
+    if (primitiveBatchCount == primitiveBatchCapacity) {
+        return;
+    }
+    ColorVertex* out = &primitiveBatch[primitiveBatchCount++];
+    out->x = x;
+    out->y = y;
+    out->z = z;
+    out->r = primitiveRGBA[0];
+    out->g = primitiveRGBA[1];
+    out->b = primitiveRGBA[2];
+    out->a = primitiveRGBA[3];
+}
+
+// Draw the run with the current line width and blending, in place of glEnd
+void endPrimitive() {
+    streamBufferCommit(&frameStream);
+    if (primitiveBatchCount > 0) {
+        drawStreamed(primitiveMode, primitiveBatchOffset, primitiveBatchCount);
+    }
+    primitiveBatch = NULL;
+    primitiveBatchCapacity = primitiveBatchCount = 0;
+}
+
+void beginSpheres(int maxSpheres) {
+    sphereBatch = streamBufferReserve(&frameStream, maxSpheres * SPHERE_VERTICES * sizeof(ColorVertex),
+                                      &sphereBatchOffset);
+    sphereBatchCapacity = sphereBatch ? maxSpheres * SPHERE_VERTICES : 0;
+    sphereBatchCount = 0;
+}
+
+void drawSphere(float x, float y, float z, float radius, float r, float g, float b, float alpha) {
+    if (sphereBatchCount + SPHERE_VERTICES > sphereBatchCapacity) {
+        return;
+    }
+
+    ColorVertex* out = &sphereBatch[sphereBatchCount];
+    for (int v = 0; v < SPHERE_VERTICES; v++) {
+        float brightness = unitSphere[v][3];
+        out[v].x = x + unitSphere[v][0] * radius;
+        out[v].y = y + unitSphere[v][1] * radius;
+        out[v].z = z + unitSphere[v][2] * radius;
+        out[v].r = r * brightness;
+        out[v].g = g * brightness;
+        out[v].b = b * brightness;
+        out[v].a = alpha;
+    }
+    sphereBatchCount += SPHERE_VERTICES;
+}
+
+void endSpheres() {
+    streamBufferCommit(&frameStream);
+    if (sphereBatchCount > 0) {
+        drawStreamed(GL_TRIANGLES, sphereBatchOffset, sphereBatchCount);
+    }
+    sphereBatch = NULL;
+    sphereBatchCapacity = sphereBatchCount = 0;
 }
 
 void drawVector(Vec3 from, Vec3 to, float r, float g, float b, float alpha) {
     // Draw dashed line
     int segments = 10;
-    glBegin(GL_LINES);
+    beginPrimitive(GL_LINES, segments);
     for (int i = 0; i < segments; i += 2) {
         float t0 = (float)i / segments;
         float t1 = (float)(i + 1) / segments;
 
-        glColor4f(r, g, b, alpha);
-        glVertex3f(from.x + t0 * (to.x - from.x),
-                   from.y + t0 * (to.y - from.y),
-                   from.z + t0 * (to.z - from.z));
-        glVertex3f(from.x + t1 * (to.x - from.x),
-                   from.y + t1 * (to.y - from.y),
-                   from.z + t1 * (to.z - from.z));
+        primitiveColor(r, g, b, alpha);
+        primitiveVertex(from.x + t0 * (to.x - from.x),
+                        from.y + t0 * (to.y - from.y),
+                        from.z + t0 * (to.z - from.z));
+        primitiveVertex(from.x + t1 * (to.x - from.x),
+                        from.y + t1 * (to.y - from.y),
+                        from.z + t1 * (to.z - from.z));
     }
-    glEnd();
+    endPrimitive();
 
     // Draw arrowhead
     float arrowSize = 0.08f;
@@ -221,16 +473,16 @@ void drawVector(Vec3 from, Vec3 to, float r, float g, float b, float alpha) {
         dir.x /= len; dir.y /= len; dir.z /= len;
         Vec3 perp1 = {-dir.y, dir.x, 0};
 
-        glBegin(GL_TRIANGLES);
-        glColor4f(r, g, b, alpha);
-        glVertex3f(to.x, to.y, to.z);
-        glVertex3f(to.x - dir.x * arrowSize + perp1.x * arrowSize * 0.3f,
-                   to.y - dir.y * arrowSize + perp1.y * arrowSize * 0.3f,
-                   to.z - dir.z * arrowSize + perp1.z * arrowSize * 0.3f);
-        glVertex3f(to.x - dir.x * arrowSize - perp1.x * arrowSize * 0.3f,
-                   to.y - dir.y * arrowSize - perp1.y * arrowSize * 0.3f,
-                   to.z - dir.z * arrowSize - perp1.z * arrowSize * 0.3f);
-        glEnd();
+        beginPrimitive(GL_TRIANGLES, 3);
+        primitiveColor(r, g, b, alpha);
+        primitiveVertex(to.x, to.y, to.z);
+        primitiveVertex(to.x - dir.x * arrowSize + perp1.x * arrowSize * 0.3f,
+                        to.y - dir.y * arrowSize + perp1.y * arrowSize * 0.3f,
+                        to.z - dir.z * arrowSize + perp1.z * arrowSize * 0.3f);
+        primitiveVertex(to.x - dir.x * arrowSize - perp1.x * arrowSize * 0.3f,
+                        to.y - dir.y * arrowSize - perp1.y * arrowSize * 0.3f,
+                        to.z - dir.z * arrowSize - perp1.z * arrowSize * 0.3f);
+        endPrimitive();
     }
 }
 
@@ -253,18 +505,18 @@ void drawTrajectoryTube(int tokenIdx, int endLayer) {
             r = 1.0f; g = 0.5f; b = 0.2f;
         }
 
-        glBegin(GL_QUAD_STRIP);
+        beginPrimitive(GL_QUAD_STRIP, (segments + 1) * 2);
         for (int i = 0; i <= segments; i++) {
             float angle = 2.0f * PI * i / segments;
             float nx = cosf(angle);
             float nz = sinf(angle);
 
             float alpha = 0.3f;
-            glColor4f(r, g, b, alpha);
-            glVertex3f(p0.x + nx * radius, p0.y, p0.z + nz * radius);
-            glVertex3f(p1.x + nx * radius, p1.y, p1.z + nz * radius);
+            primitiveColor(r, g, b, alpha);
+            primitiveVertex(p0.x + nx * radius, p0.y, p0.z + nz * radius);
+            primitiveVertex(p1.x + nx * radius, p1.y, p1.z + nz * radius);
         }
-        glEnd();
+        endPrimitive();
     }
 }
 
@@ -314,13 +566,11 @@ void initializeTokenPositions() {
 }
 
 void drawBlock(float x, float y, float z, float w, float h) {
-    // Draw a filled rectangle
-    glBegin(GL_QUADS);
-    glVertex3f(x, y, z);
-    glVertex3f(x + w, y, z);
-    glVertex3f(x + w, y + h, z);
-    glVertex3f(x, y + h, z);
-    glEnd();
+    // Add a filled rectangle to the word's GL_QUADS run
+    primitiveVertex(x, y, z);
+    primitiveVertex(x + w, y, z);
+    primitiveVertex(x + w, y + h, z);
+    primitiveVertex(x, y + h, z);
 }
 
 void drawLetter(char letter, float x, float y, float z, float size) {
@@ -429,10 +679,13 @@ void drawLetter(char letter, float x, float y, float z, float size) {
 void drawWord(const char* word, float x, float y, float z, float size) {
     float spacing = size * 0.7f;  // More spacing for wider letters
     float offset = 0;
+    // One run for the whole word; no letter has more than five blocks
+    beginPrimitive(GL_QUADS, (int)strlen(word) * 5 * 4);
     for (int i = 0; word[i] != '\0'; i++) {
         drawLetter(word[i], x + offset, y, z, size);
         offset += spacing;
     }
+    endPrimitive();
 }
 
 void drawDigit(int digit, float x, float y, float z, float size) {
@@ -456,45 +709,45 @@ void drawDigit(int digit, float x, float y, float z, float size) {
     float h = size;
 
     glLineWidth(3.0f);
-    glBegin(GL_LINES);
+    beginPrimitive(GL_LINES, 14);
 
     // Top horizontal
     if (segments[digit][0]) {
-        glVertex3f(x, y + h, z);
-        glVertex3f(x + w, y + h, z);
+        primitiveVertex(x, y + h, z);
+        primitiveVertex(x + w, y + h, z);
     }
     // Top-left vertical
     if (segments[digit][1]) {
-        glVertex3f(x, y + h, z);
-        glVertex3f(x, y + h/2, z);
+        primitiveVertex(x, y + h, z);
+        primitiveVertex(x, y + h/2, z);
     }
     // Top-right vertical
     if (segments[digit][2]) {
-        glVertex3f(x + w, y + h, z);
-        glVertex3f(x + w, y + h/2, z);
+        primitiveVertex(x + w, y + h, z);
+        primitiveVertex(x + w, y + h/2, z);
     }
     // Middle horizontal
     if (segments[digit][3]) {
-        glVertex3f(x, y + h/2, z);
-        glVertex3f(x + w, y + h/2, z);
+        primitiveVertex(x, y + h/2, z);
+        primitiveVertex(x + w, y + h/2, z);
     }
     // Bottom-left vertical
     if (segments[digit][4]) {
-        glVertex3f(x, y + h/2, z);
-        glVertex3f(x, y, z);
+        primitiveVertex(x, y + h/2, z);
+        primitiveVertex(x, y, z);
     }
     // Bottom-right vertical
     if (segments[digit][5]) {
-        glVertex3f(x + w, y + h/2, z);
-        glVertex3f(x + w, y, z);
+        primitiveVertex(x + w, y + h/2, z);
+        primitiveVertex(x + w, y, z);
     }
     // Bottom horizontal
     if (segments[digit][6]) {
-        glVertex3f(x, y, z);
-        glVertex3f(x + w, y, z);
+        primitiveVertex(x, y, z);
+        primitiveVertex(x + w, y, z);
     }
 
-    glEnd();
+    endPrimitive();
     glLineWidth(2.0f);
 }
 
@@ -534,7 +787,8 @@ void drawText(const char* text, float x, float y, float size, float r, float g,
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glColor4f(r, g, b, a);
+    // Smoothed points would spread each pixel over its neighbours
+    glDisable(GL_POINT_SMOOTH);
 
     for (int i = 0; text[i]; i++) {
         int advance, lsb;
@@ -550,27 +804,29 @@ void drawText(const char* text, float x, float y, float size, float r, float g,
             unsigned char* bitmap = (unsigned char*)malloc(w * h);
             stbtt_MakeCodepointBitmap(&font, bitmap, w, h, w, scale, scale, text[i]);
 
-            // Draw bitmap as textured quads
+            // Draw the bitmap one pixel at a time, one run per glyph sized
+            // to the pixels it covers
             float bx = xpos + x0;
             float by = baseline + y0;
 
-            glBegin(GL_QUADS);
+            int covered = 0;
+            for (int p = 0; p < w * h; p++) {
+                covered += bitmap[p] > 20;
+            }
+            beginPrimitive(GL_POINTS, covered);
             for (int py = 0; py < h; py++) {
                 for (int px = 0; px < w; px++) {
                     unsigned char alpha_val = bitmap[py * w + px];
                     if (alpha_val > 20) {
                         float intensity = alpha_val / 255.0f;
-                        glColor4f(r, g, b, a * intensity);
-                        float qx = bx + px;
-                        float qy = by + py;
-                        glVertex2f(qx, qy);
-                        glVertex2f(qx + 1, qy);
-                        glVertex2f(qx + 1, qy + 1);
-                        glVertex2f(qx, qy + 1);
+                        primitiveColor(r, g, b, a * intensity);
+                        // A 1-pixel point at the centre of the unit quad
+                        // fills the same pixel with a quarter of the vertices
+                        primitiveVertex(bx + px + 0.5f, by + py + 0.5f, 0.0f);
                     }
                 }
             }
-            glEnd();
+            endPrimitive();
 
             free(bitmap);
         }
@@ -580,6 +836,7 @@ void drawText(const char* text, float x, float y, float size, float r, float g,
             xpos += scale * stbtt_GetCodepointKernAdvance(&font, text[i], text[i + 1]);
         }
     }
+    glEnable(GL_POINT_SMOOTH);
 }
 
 void setupTextOverlay(int width, int height) {
@@ -633,27 +890,27 @@ void drawLayerPlane(int layer, float alpha) {
     }
 
     // Draw more visible plane with color
-    glBegin(GL_QUADS);
-    glColor4f(r1, g1, b1, alpha * 0.25f);
-    glVertex3f(-size, y, -size);
-    glVertex3f(size, y, -size);
-    glColor4f(r2, g2, b2, alpha * 0.2f);
-    glVertex3f(size, y, size);
-    glVertex3f(-size, y, size);
-    glEnd();
+    beginPrimitive(GL_QUADS, 4);
+    primitiveColor(r1, g1, b1, alpha * 0.25f);
+    primitiveVertex(-size, y, -size);
+    primitiveVertex(size, y, -size);
+    primitiveColor(r2, g2, b2, alpha * 0.2f);
+    primitiveVertex(size, y, size);
+    primitiveVertex(-size, y, size);
+    endPrimitive();
 
     // Draw grid lines with matching color
     glLineWidth(1.0f);
-    glBegin(GL_LINES);
-    glColor4f(gridR, gridG, gridB, alpha * 0.4f);
+    beginPrimitive(GL_LINES, 9 * 4);
+    primitiveColor(gridR, gridG, gridB, alpha * 0.4f);
     for (int i = -4; i <= 4; i++) {
         float pos = i * 0.5f;
-        glVertex3f(pos, y, -size);
-        glVertex3f(pos, y, size);
-        glVertex3f(-size, y, pos);
-        glVertex3f(size, y, pos);
+        primitiveVertex(pos, y, -size);
+        primitiveVertex(pos, y, size);
+        primitiveVertex(-size, y, pos);
+        primitiveVertex(size, y, pos);
     }
-    glEnd();
+    endPrimitive();
     glLineWidth(2.0f);
 
     // Layer number will be drawn as billboard text later
@@ -716,23 +973,23 @@ void drawAttentionMatrix(int layer, int numTokens, float alpha) {
             float b = weight * 0.2f;
 
             // Draw filled quad for this cell
-            glBegin(GL_QUADS);
-            glColor4f(r, g, b, alpha * weight * 0.8f);
-            glVertex3f(cx, y + 0.3f, cz);
-            glVertex3f(cx + cellSize, y + 0.3f, cz);
-            glVertex3f(cx + cellSize, y + 0.3f, cz - cellSize);
-            glVertex3f(cx, y + 0.3f, cz - cellSize);
-            glEnd();
+            beginPrimitive(GL_QUADS, 4);
+            primitiveColor(r, g, b, alpha * weight * 0.8f);
+            primitiveVertex(cx, y + 0.3f, cz);
+            primitiveVertex(cx + cellSize, y + 0.3f, cz);
+            primitiveVertex(cx + cellSize, y + 0.3f, cz - cellSize);
+            primitiveVertex(cx, y + 0.3f, cz - cellSize);
+            endPrimitive();
 
             // Draw cell border
             glLineWidth(1.0f);
-            glBegin(GL_LINE_LOOP);
-            glColor4f(1.0f, 1.0f, 1.0f, alpha * 0.3f);
-            glVertex3f(cx, y + 0.3f, cz);
-            glVertex3f(cx + cellSize, y + 0.3f, cz);
-            glVertex3f(cx + cellSize, y + 0.3f, cz - cellSize);
-            glVertex3f(cx, y + 0.3f, cz - cellSize);
-            glEnd();
+            beginPrimitive(GL_LINE_LOOP, 4);
+            primitiveColor(1.0f, 1.0f, 1.0f, alpha * 0.3f);
+            primitiveVertex(cx, y + 0.3f, cz);
+            primitiveVertex(cx + cellSize, y + 0.3f, cz);
+            primitiveVertex(cx + cellSize, y + 0.3f, cz - cellSize);
+            primitiveVertex(cx, y + 0.3f, cz - cellSize);
+            endPrimitive();
             glLineWidth(2.0f);
         }
     }
@@ -742,30 +999,28 @@ void drawQKVVectors(int tokenIdx, int layer, float phase) {
     Vec3 pos = tokenPositions[tokenIdx][layer];
     float vecLen = 0.3f;
 
-    // Q vector (blue ray pointing forward)
+    // Q, K and V in one run of lines
     glLineWidth(3.0f);
-    glBegin(GL_LINES);
-    glColor4f(0.3f, 0.5f, 1.0f, 0.7f * phase);
-    glVertex3f(pos.x, pos.y, pos.z);
-    glColor4f(0.5f, 0.7f, 1.0f, 0.9f * phase);
-    glVertex3f(pos.x + vecLen, pos.y + vecLen * 0.3f, pos.z);
-    glEnd();
+    beginPrimitive(GL_LINES, 6);
+
+    // Q vector (blue ray pointing forward)
+    primitiveColor(0.3f, 0.5f, 1.0f, 0.7f * phase);
+    primitiveVertex(pos.x, pos.y, pos.z);
+    primitiveColor(0.5f, 0.7f, 1.0f, 0.9f * phase);
+    primitiveVertex(pos.x + vecLen, pos.y + vecLen * 0.3f, pos.z);
 
     // K vector (green ray pointing left)
-    glBegin(GL_LINES);
-    glColor4f(0.3f, 1.0f, 0.5f, 0.7f * phase);
-    glVertex3f(pos.x, pos.y, pos.z);
-    glColor4f(0.5f, 1.0f, 0.7f, 0.9f * phase);
-    glVertex3f(pos.x - vecLen * 0.5f, pos.y + vecLen * 0.3f, pos.z + vecLen * 0.5f);
-    glEnd();
+    primitiveColor(0.3f, 1.0f, 0.5f, 0.7f * phase);
+    primitiveVertex(pos.x, pos.y, pos.z);
+    primitiveColor(0.5f, 1.0f, 0.7f, 0.9f * phase);
+    primitiveVertex(pos.x - vecLen * 0.5f, pos.y + vecLen * 0.3f, pos.z + vecLen * 0.5f);
 
     // V vector (orange ray pointing up-right)
-    glBegin(GL_LINES);
-    glColor4f(1.0f, 0.6f, 0.2f, 0.7f * phase);
-    glVertex3f(pos.x, pos.y, pos.z);
-    glColor4f(1.0f, 0.8f, 0.4f, 0.9f * phase);
-    glVertex3f(pos.x + vecLen * 0.3f, pos.y + vecLen * 0.5f, pos.z - vecLen * 0.3f);
-    glEnd();
+    primitiveColor(1.0f, 0.6f, 0.2f, 0.7f * phase);
+    primitiveVertex(pos.x, pos.y, pos.z);
+    primitiveColor(1.0f, 0.8f, 0.4f, 0.9f * phase);
+    primitiveVertex(pos.x + vecLen * 0.3f, pos.y + vecLen * 0.5f, pos.z - vecLen * 0.3f);
+    endPrimitive();
 
     glLineWidth(2.0f);
 }
@@ -783,12 +1038,12 @@ void drawAttentionConnections(int queryIdx, int layer, int numTokens, float alph
         // Line width proportional to attention weight
         glLineWidth(1.0f + weight * 6.0f);
 
-        glBegin(GL_LINES);
-        glColor4f(0.4f, 0.8f, 1.0f, alpha * weight * 0.6f);
-        glVertex3f(query.x, query.y, query.z);
-        glColor4f(0.6f, 1.0f, 1.0f, alpha * weight * 0.3f);
-        glVertex3f(key.x, key.y, key.z);
-        glEnd();
+        beginPrimitive(GL_LINES, 2);
+        primitiveColor(0.4f, 0.8f, 1.0f, alpha * weight * 0.6f);
+        primitiveVertex(query.x, query.y, query.z);
+        primitiveColor(0.6f, 1.0f, 1.0f, alpha * weight * 0.3f);
+        primitiveVertex(key.x, key.y, key.z);
+        endPrimitive();
     }
 
     glLineWidth(2.0f);
@@ -999,26 +1254,90 @@ void drawVocabProjectionPanel(int width, int height, int numTokens, float phase,
     restoreFromTextOverlay();
 }
 
-int main() {
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
-        return -1;
+int main(int argc, char* argv[]) {
+    double idleFps = IDLE_DEFAULT_FPS;
+    double idleAfter = IDLE_DEFAULT_AFTER;
+    double idleStats = 0.0;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* headlessBackend = NULL;
+    int headlessMode = 0;
+    snapshotInit(&snapshot);
+    for (int i = 1; i < argc; i++) {
+        if (snapshotOption(&snapshot, argv[i])) {
+            continue;
+        } else if (strncmp(argv[i], "--idle-fps=", 11) == 0) {
+            idleFps = atof(argv[i] + 11);
+        } else if (strncmp(argv[i], "--idle-after=", 13) == 0) {
+            idleAfter = atof(argv[i] + 13);
+        } else if (strcmp(argv[i], "--idle-stats") == 0) {
+            idleStats = IDLE_DEFAULT_REPORT;
+        } else if (strncmp(argv[i], "--idle-stats=", 13) == 0) {
+            idleStats = atof(argv[i] + 13);
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            recordPath = argv[i] + 9;
+        } else if (strncmp(argv[i], "--replay=", 9) == 0) {
+            replayPath = argv[i] + 9;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = 1;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessMode = 1;
+            headlessBackend = argv[i] + 11;
+        }
     }
 
-    GLFWwindow* window = glfwCreateWindow(1200, 900, "Transformer Residual Stream", NULL, NULL);
-    if (!window) {
-        printf("Failed to create window\n");
-        glfwTerminate();
+    // Without a window only the end of the log or the snapshot can end the
+    // run
+    if (headlessMode && !replayPath && !snapshot.path) {
+        printf("--headless needs --replay or --snapshot\n");
         return -1;
     }
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetMouseButtonCallback(window, mouse_button_callback);
-    glfwSetCursorPosCallback(window, cursor_position_callback);
-    glfwSetKeyCallback(window, key_callback);
-    glfwSwapInterval(1);
+    // Headless runs never start GLFW and leave window NULL
+    GLFWwindow* window = NULL;
+    int width = framebufferWidth, height = framebufferHeight;
+    if (headlessMode) {
+        if (!headlessCreate(&headlessContext, headlessBackend, width, height, 0, 0, 0)) {
+            printf("Failed to create a headless context\n");
+            return -1;
+        }
+    } else {
+        if (!glfwInit()) {
+            printf("Failed to initialize GLFW\n");
+            return -1;
+        }
+
+        if (snapshot.path) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        }
+        window = glfwCreateWindow(width, height, "Transformer Residual Stream", NULL, NULL);
+        if (!window) {
+            printf("Failed to create window\n");
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetCursorPosCallback(window, cursor_position_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSwapInterval(snapshot.path ? 0 : 1);
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+    if (replayPath) {
+        inputLogReplay(&inputLog, replayPath);
+    } else if (recordPath) {
+        inputLogRecord(&inputLog, recordPath, currentTime);
+    }
+    if (headlessMode && inputLog.mode != INPUT_LOG_REPLAYING && !snapshot.path) {
+        headlessDestroy(&headlessContext);
+        return -1;
+    }
+    if (window && !snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+        idleGovernorInit(&idleGovernor, window, idleAfter, idleFps, idleStats);
+    }
 
     // Initialize OpenGL
     glEnable(GL_BLEND);
@@ -1030,11 +1349,22 @@ int main() {
     glLineWidth(2.0f);
     glEnable(GL_POINT_SMOOTH);
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
     framebuffer_size_callback(window, width, height);
 
     initializeTokenPositions();
+    buildUnitSphere();
+    // Start where the log does, so a replay steps exactly like the recording
+    double startTime = inputLog.mode != INPUT_LOG_OFF ? inputLog.startTime : currentTime();
+    simClockInit(&simClock, SIM_TIMESTEP, SIM_MAX_STEPS, startTime);
+    if (!streamBufferInit(&frameStream, FRAME_STREAM_BYTES)) {
+        printf("Failed to allocate the frame vertex buffer\n");
+        if (window) {
+            glfwTerminate();
+        } else {
+            headlessDestroy(&headlessContext);
+        }
+        return -1;
+    }
 
     // Try to load a system font
     const char* fontPaths[] = {
@@ -1055,8 +1385,19 @@ int main() {
         printf("Warning: Could not load system font, text will not be rendered\n");
     }
 
-    while (!glfwWindowShouldClose(window)) {
-        float time = glfwGetTime();
+    while (!window || !glfwWindowShouldClose(window)) {
+        if (!snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+            idleGovernorWait(&idleGovernor, window, isPaused ? IDLE_SLOW : IDLE_ANIMATING);
+        }
+
+        // Log this frame's clock, or replay the input due before it and
+        // take the recorded clock
+        double frameTime = currentTime();
+        if (!inputLogFrame(&inputLog, window, &replayHandlers, &frameTime)) {
+            break;
+        }
+        float time = frameTime;
+        double frameStart = wallClock();
 
         // Beautiful gradient background (ocean to sunset)
         float colorPhase = sinf(time * 0.1f) * 0.5f + 0.5f;
@@ -1065,42 +1406,23 @@ int main() {
         float bgB = 0.3f + colorPhase * 0.1f;
         glClearColor(bgR, bgG, bgB, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        streamBufferBeginFrame(&frameStream);
 
-        // Animation: progress through layers
-        // Pause at start to show the words
-        if (time < 5.0f) {
-            animationPhase = 0.0f;  // Hold at layer 0 for first 5 seconds
-        } else if (!isPaused) {
-            animationPhase += animationSpeed;  // User-adjustable speed!
+        // Run the simulation steps that are due, then draw between the last two
+        simClockBegin(&simClock, frameTime);
+        while (simClockStep(&simClock)) {
+            simulationStep(simClock.time);
         }
+        float alpha = simClockAlpha(&simClock);
+        animationPhase = simPrevious.animationPhase + (simCurrent.animationPhase - simPrevious.animationPhase) * alpha;
+        cameraY = simPrevious.cameraY + (simCurrent.cameraY - simPrevious.cameraY) * alpha;
 
-        // Simple autoregressive: cycle through forward passes
-        // Each forward pass goes through all 6 layers, then moves to next pass
-        float LAYER_TIME = 3.0f;  // 3 seconds per layer (was 1 second)
-        float PASS_TIME = NUM_LAYERS * LAYER_TIME;  // Time per forward pass = 18 seconds
-        float TOTAL_TIME = NUM_TOKENS * PASS_TIME;  // Total animation cycle = 90 seconds
-
-        float cyclePhase = fmodf(animationPhase, TOTAL_TIME);
-
-        // Determine current forward pass (1-5)
-        currentForwardPass = ((int)(cyclePhase / PASS_TIME)) + 1;
-        if (currentForwardPass > NUM_TOKENS) currentForwardPass = NUM_TOKENS;
-
-        // Within current pass, which layer (0-5)
-        float passLocalTime = fmodf(cyclePhase, PASS_TIME);
-        currentLayer = (int)(passLocalTime / LAYER_TIME);
-        if (currentLayer >= NUM_LAYERS) currentLayer = NUM_LAYERS - 1;
-
-        // Blend between layers
-        float layerBlend = fmodf(passLocalTime, LAYER_TIME) / LAYER_TIME;
+        float layerBlend;
+        animationPosition(animationPhase, &currentForwardPass, &currentLayer, &layerBlend);
 
         // Camera setup - moves up as layers progress
         glLoadIdentity();
 
-        // Camera follows the action - starts at bottom (words) and moves up through layers
-        float targetY = -2.5f + (currentLayer + layerBlend) * 0.4f;  // Follow the layers up
-        cameraY += (targetY - cameraY) * 0.05f;  // Smooth following
-
         // Position camera to see current layer
         glTranslatef(cameraPanX, cameraY, -10.0f / zoom);  // Pull back more, apply pan
         glRotatef(30.0f, 1, 0, 0);  // Tilt down more to see action
@@ -1151,12 +1473,12 @@ int main() {
 
                 // Draw BOLD linear transformation vector with gradient
                 glLineWidth(6.0f);
-                glBegin(GL_LINES);
-                glColor4f(tokens[i].r, tokens[i].g, tokens[i].b, vectorAlpha * 0.3f);
-                glVertex3f(from.x, from.y, from.z);
-                glColor4f(tokens[i].r * 1.3f, tokens[i].g * 1.3f, tokens[i].b * 1.3f, vectorAlpha);
-                glVertex3f(to.x, to.y, to.z);
-                glEnd();
+                beginPrimitive(GL_LINES, 2);
+                primitiveColor(tokens[i].r, tokens[i].g, tokens[i].b, vectorAlpha * 0.3f);
+                primitiveVertex(from.x, from.y, from.z);
+                primitiveColor(tokens[i].r * 1.3f, tokens[i].g * 1.3f, tokens[i].b * 1.3f, vectorAlpha);
+                primitiveVertex(to.x, to.y, to.z);
+                endPrimitive();
 
                 // Draw arrowhead at destination
                 Vec3 dir = {to.x - from.x, to.y - from.y, to.z - from.z};
@@ -1165,33 +1487,33 @@ int main() {
                     dir.x /= len; dir.y /= len; dir.z /= len;
                     float arrowSize = 0.1f;
 
-                    glBegin(GL_TRIANGLES);
-                    glColor4f(tokens[i].r * 1.3f, tokens[i].g * 1.3f, tokens[i].b * 1.3f, vectorAlpha);
-                    glVertex3f(to.x, to.y, to.z);
-                    glVertex3f(to.x - dir.x * arrowSize - dir.y * arrowSize * 0.5f,
-                              to.y - dir.y * arrowSize + dir.x * arrowSize * 0.5f, to.z);
-                    glVertex3f(to.x - dir.x * arrowSize + dir.y * arrowSize * 0.5f,
-                              to.y - dir.y * arrowSize - dir.x * arrowSize * 0.5f, to.z);
-                    glEnd();
+                    beginPrimitive(GL_TRIANGLES, 3);
+                    primitiveColor(tokens[i].r * 1.3f, tokens[i].g * 1.3f, tokens[i].b * 1.3f, vectorAlpha);
+                    primitiveVertex(to.x, to.y, to.z);
+                    primitiveVertex(to.x - dir.x * arrowSize - dir.y * arrowSize * 0.5f,
+                                   to.y - dir.y * arrowSize + dir.x * arrowSize * 0.5f, to.z);
+                    primitiveVertex(to.x - dir.x * arrowSize + dir.y * arrowSize * 0.5f,
+                                   to.y - dir.y * arrowSize - dir.x * arrowSize * 0.5f, to.z);
+                    endPrimitive();
                 }
             }
 
             // Also show cross-token attention links (thinner)
             float linkAlpha = layerBlend * 0.2f;
             glLineWidth(2.0f);
+            beginPrimitive(GL_LINES, currentForwardPass * currentForwardPass);
             for (int i = 0; i < currentForwardPass; i++) {
                 Vec3 from = tokenPositions[i][currentLayer];
                 for (int j = i + 1; j < currentForwardPass; j++) {
                     Vec3 to = tokenPositions[j][currentLayer];
                     float pulse = sinf(time * 3.0f + i + j) * 0.3f + 0.7f;
 
-                    glBegin(GL_LINES);
-                    glColor4f(0.4f, 0.6f, 1.0f, linkAlpha * pulse);
-                    glVertex3f(from.x, from.y, from.z);
-                    glVertex3f(to.x, to.y, to.z);
-                    glEnd();
+                    primitiveColor(0.4f, 0.6f, 1.0f, linkAlpha * pulse);
+                    primitiveVertex(from.x, from.y, from.z);
+                    primitiveVertex(to.x, to.y, to.z);
                 }
             }
+            endPrimitive();
 
             glLineWidth(2.0f);
         }
@@ -1211,11 +1533,10 @@ int main() {
                     float trailAngle = (2.0f * PI * trail / numTrails) + time * 1.5f + i;
                     float trailRadius = 0.15f;
 
-                    glLineWidth(3.0f);
-                    glBegin(GL_LINE_STRIP);
-
                     // Draw curved path from old position to new position
                     int steps = 15;
+                    glLineWidth(3.0f);
+                    beginPrimitive(GL_LINE_STRIP, steps + 1);
                     for (int step = 0; step <= steps; step++) {
                         float t = (float)step / steps;
                         float smoothT = t * t * (3.0f - 2.0f * t); // Smooth step
@@ -1235,18 +1556,18 @@ int main() {
                         // Color gradient with pulsing
                         float intensity = 1.0f - t * 0.5f;
                         float pulse = sinf(time * 4.0f + trail + step * 0.2f) * 0.3f + 0.7f;
-                        glColor4f(1.0f * intensity, 0.6f * intensity, 0.2f * intensity,
-                                 transformAlpha * pulse * (1.0f - t * 0.5f));
-                        glVertex3f(x, y, z);
+                        primitiveColor(1.0f * intensity, 0.6f * intensity, 0.2f * intensity,
+                                      transformAlpha * pulse * (1.0f - t * 0.5f));
+                        primitiveVertex(x, y, z);
                     }
-                    glEnd();
+                    endPrimitive();
                 }
 
                 // Draw spiraling "energy" around the token at new position
                 Vec3 pos = tokenPositions[i][currentLayer];
-                glLineWidth(2.0f);
-                glBegin(GL_LINE_STRIP);
                 int spiralSteps = 20;
+                glLineWidth(2.0f);
+                beginPrimitive(GL_LINE_STRIP, spiralSteps);
                 for (int s = 0; s < spiralSteps; s++) {
                     float t = (float)s / spiralSteps;
                     float spiralAngle = t * PI * 4.0f + time * 3.0f + i;
@@ -1257,10 +1578,10 @@ int main() {
                     float z = pos.z + sinf(spiralAngle) * spiralRadius;
 
                     float intensity = 1.0f - t;
-                    glColor4f(1.0f * intensity, 0.5f * intensity, 0.2f * intensity, transformAlpha * intensity);
-                    glVertex3f(x, y, z);
+                    primitiveColor(1.0f * intensity, 0.5f * intensity, 0.2f * intensity, transformAlpha * intensity);
+                    primitiveVertex(x, y, z);
                 }
-                glEnd();
+                endPrimitive();
             }
 
             glLineWidth(2.0f);
@@ -1271,8 +1592,7 @@ int main() {
 
         if (fontBuffer) {
             // Switch to 2D to draw text billboards
-            int width, height;
-            glfwGetFramebufferSize(window, &width, &height);
+            int width = framebufferWidth, height = framebufferHeight;
 
             // Draw ALL words at bottom (showing full sequence)
             for (int i = 0; i < NUM_TOKENS; i++) {
@@ -1350,7 +1670,7 @@ int main() {
                 Vec3 wordPos = tokenPositions[i][0];
                 wordPos.y = wordY;
 
-                glColor4f(tokens[i].r * 1.5f, tokens[i].g * 1.5f, tokens[i].b * 1.5f, 1.0f);
+                primitiveColor(tokens[i].r * 1.5f, tokens[i].g * 1.5f, tokens[i].b * 1.5f, 1.0f);
                 float wordSize = 0.6f;
 
                 int letterCount = 0;
@@ -1368,21 +1688,21 @@ int main() {
             Vec3 embeddingPos = tokenPositions[i][0];
 
             glLineWidth(3.0f);
-            glBegin(GL_LINES);
-            glColor4f(tokens[i].r * 0.8f, tokens[i].g * 0.8f, tokens[i].b * 0.8f, 0.7f);
-            glVertex3f(wordPos.x, wordPos.y + 0.3f, wordPos.z);  // Top of word area
-            glColor4f(tokens[i].r, tokens[i].g, tokens[i].b, 0.9f);
-            glVertex3f(embeddingPos.x, embeddingPos.y - 0.1f, embeddingPos.z);  // Just below layer 0 orb
-            glEnd();
+            beginPrimitive(GL_LINES, 2);
+            primitiveColor(tokens[i].r * 0.8f, tokens[i].g * 0.8f, tokens[i].b * 0.8f, 0.7f);
+            primitiveVertex(wordPos.x, wordPos.y + 0.3f, wordPos.z);  // Top of word area
+            primitiveColor(tokens[i].r, tokens[i].g, tokens[i].b, 0.9f);
+            primitiveVertex(embeddingPos.x, embeddingPos.y - 0.1f, embeddingPos.z);  // Just below layer 0 orb
+            endPrimitive();
 
             // Draw arrowhead at embedding position
             float arrowSize = 0.08f;
-            glBegin(GL_TRIANGLES);
-            glColor4f(tokens[i].r, tokens[i].g, tokens[i].b, 0.9f);
-            glVertex3f(embeddingPos.x, embeddingPos.y - 0.1f, embeddingPos.z);
-            glVertex3f(embeddingPos.x - arrowSize, embeddingPos.y - 0.1f - arrowSize * 1.5f, embeddingPos.z);
-            glVertex3f(embeddingPos.x + arrowSize, embeddingPos.y - 0.1f - arrowSize * 1.5f, embeddingPos.z);
-            glEnd();
+            beginPrimitive(GL_TRIANGLES, 3);
+            primitiveColor(tokens[i].r, tokens[i].g, tokens[i].b, 0.9f);
+            primitiveVertex(embeddingPos.x, embeddingPos.y - 0.1f, embeddingPos.z);
+            primitiveVertex(embeddingPos.x - arrowSize, embeddingPos.y - 0.1f - arrowSize * 1.5f, embeddingPos.z);
+            primitiveVertex(embeddingPos.x + arrowSize, embeddingPos.y - 0.1f - arrowSize * 1.5f, embeddingPos.z);
+            endPrimitive();
         }
         glLineWidth(2.0f);
 
@@ -1394,8 +1714,7 @@ int main() {
 
         // Draw layer numbers as billboards
         if (fontBuffer) {
-            int width, height;
-            glfwGetFramebufferSize(window, &width, &height);
+            int width = framebufferWidth, height = framebufferHeight;
 
             for (int layer = 0; layer <= currentLayer; layer++) {
                 float y = tokenPositions[0][layer].y;
@@ -1446,6 +1765,8 @@ int main() {
 
         // Draw subtle trajectories (history trails) up to current layer
         glDepthMask(GL_FALSE);
+        glLineWidth(1.0f);
+        beginPrimitive(GL_LINES, NUM_TOKENS * currentLayer * 2);
         for (int i = 0; i < NUM_TOKENS; i++) {
             if (currentLayer > 0) {
                 // Draw a faint trail showing where the token has been
@@ -1456,15 +1777,13 @@ int main() {
                     // Fade older trails
                     float trailAlpha = 0.1f * (1.0f - (float)(currentLayer - layer) / currentLayer);
 
-                    glLineWidth(1.0f);
-                    glBegin(GL_LINES);
-                    glColor4f(tokens[i].r, tokens[i].g, tokens[i].b, trailAlpha);
-                    glVertex3f(from.x, from.y, from.z);
-                    glVertex3f(to.x, to.y, to.z);
-                    glEnd();
+                    primitiveColor(tokens[i].r, tokens[i].g, tokens[i].b, trailAlpha);
+                    primitiveVertex(from.x, from.y, from.z);
+                    primitiveVertex(to.x, to.y, to.z);
                 }
             }
         }
+        endPrimitive();
         glDepthMask(GL_TRUE);
         glLineWidth(2.0f);
 
@@ -1472,6 +1791,7 @@ int main() {
         glDepthMask(GL_FALSE);
 
         // Draw token orbs - only tokens in current forward pass
+        beginSpheres(currentForwardPass * 2);
         for (int i = 0; i < currentForwardPass; i++) {
             // Draw at current layer position
             Vec3 pos = tokenPositions[i][currentLayer];
@@ -1502,14 +1822,14 @@ int main() {
             drawSphere(pos.x, pos.y, pos.z, baseSize,
                       tokens[i].r * coreIntensity, tokens[i].g * coreIntensity, tokens[i].b * coreIntensity, 0.95f);
         }
+        endSpheres();
 
         // Re-enable depth writes
         glDepthMask(GL_TRUE);
 
         // Draw HUD text overlay with proper font
         if (fontBuffer) {
-            int width, height;
-            glfwGetFramebufferSize(window, &width, &height);
+            int width = framebufferWidth, height = framebufferHeight;
             setupTextOverlay(width, height);
 
             // Title
@@ -1690,11 +2010,38 @@ int main() {
 
             restoreFromTextOverlay();
         }
+        streamBufferEndFrame(&frameStream);
+        snapshotCapture(&snapshot, framebufferWidth, framebufferHeight);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (window) {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        } else {
+            headlessFinishFrame(&headlessContext);
+        }
+        if (!snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+            idleGovernorFrameDone(&idleGovernor, stdout);
+        }
+        if (snapshotFrameDone(&snapshot, (wallClock() - frameStart) * 1000.0)) {
+            break;
+        }
     }
 
-    glfwTerminate();
+    if (idleStats > 0.0 && !snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+        idleGovernorReport(&idleGovernor, stdout);
+    }
+    if (inputLog.mode == INPUT_LOG_RECORDING) {
+        printf("Recorded %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    } else if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        printf("Replayed %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    }
+    inputLogClose(&inputLog);
+    streamBufferDestroy(&frameStream);
+    snapshotDestroy(&snapshot);
+    if (window) {
+        glfwTerminate();
+    } else {
+        headlessDestroy(&headlessContext);
+    }
     return 0;
 }
@@ -0,0 +1,347 @@
+#include "wave_events.h"
+
+#include <math.h>
+#include <string.h>
+
+#define RIPPLE_LIFETIME 5.0f
+#define RIPPLE_SPEED 3.0f
+#define RIPPLE_WIDTH 0.3f
+#define VORTEX_RADIUS 1.0f
+#define FREEZE_RADIUS 0.5f
+#define FREEZE_LIFETIME 3.0f
+
+#define HANDLE_SLOT_BITS 16
+#define HANDLE_SLOT_MASK ((1 << HANDLE_SLOT_BITS) - 1)
+
+void waveEventsInit(WaveEventPool* pool) {
+    memset(pool, 0, sizeof(*pool));
+    for (int i = 0; i < WAVE_EVENT_CAPACITY; i++) {
+        pool->freeSlots[i] = WAVE_EVENT_CAPACITY - 1 - i;
+    }
+    pool->freeCount = WAVE_EVENT_CAPACITY;
+    pool->cellW = pool->cellH = 1.0f;
+}
+
+static void removeLive(WaveEventPool* pool, int index) {
+    int slot = pool->live[index];
+    WaveEvent* ev = &pool->events[slot];
+    if (ev->type == WAVE_EVENT_FREEZE) {
+        pool->liveFreezes--;
+    }
+    ev->generation++;
+    memmove(&pool->live[index], &pool->live[index + 1], (pool->liveCount - index - 1) * sizeof(int));
+    pool->liveCount--;
+    pool->freeSlots[pool->freeCount++] = slot;
+}
+
+int waveEventSpawn(WaveEventPool* pool, WaveEventType type, float x, float y, float time, int held) {
+    if (pool->freeCount == 0) {
+        int oldest = -1;
+        for (int i = 0; i < pool->liveCount; i++) {
+            if (!pool->events[pool->live[i]].held) {
+                oldest = i;
+                break;
+            }
+        }
+        if (oldest < 0) {
+            return -1;
+        }
+        removeLive(pool, oldest);
+    }
+
+    int slot = pool->freeSlots[--pool->freeCount];
+    WaveEvent* ev = &pool->events[slot];
+    ev->x = x;
+    ev->y = y;
+    ev->startTime = time;
+    ev->type = type;
+    ev->held = held;
+    pool->live[pool->liveCount++] = slot;
+    if (type == WAVE_EVENT_FREEZE) {
+        pool->liveFreezes++;
+    }
+
+    return slot | ((ev->generation & 0x7fff) << HANDLE_SLOT_BITS);
+}
+
+static WaveEvent* lookup(WaveEventPool* pool, int handle) {
+    if (handle < 0) {
+        return NULL;
+    }
+    int slot = handle & HANDLE_SLOT_MASK;
+    if (slot >= WAVE_EVENT_CAPACITY) {
+        return NULL;
+    }
+    WaveEvent* ev = &pool->events[slot];
+    return (ev->generation & 0x7fff) == (handle >> HANDLE_SLOT_BITS) ? ev : NULL;
+}
+
+void waveEventMove(WaveEventPool* pool, int handle, float x, float y) {
+    WaveEvent* ev = lookup(pool, handle);
+    if (ev) {
+        ev->x = x;
+        ev->y = y;
+    }
+}
+
+void waveEventRelease(WaveEventPool* pool, int handle) {
+    WaveEvent* ev = lookup(pool, handle);
+    if (ev) {
+        ev->held = 0;
+    }
+}
+
+static int isExpired(const WaveEvent* ev, float time) {
+    float elapsed = time - ev->startTime;
+    switch (ev->type) {
+        case WAVE_EVENT_RIPPLE:
+            return elapsed >= RIPPLE_LIFETIME;
+        case WAVE_EVENT_VORTEX:
+            return !ev->held;
+        case WAVE_EVENT_FREEZE:
+            return !ev->held && elapsed >= FREEZE_LIFETIME;
+    }
+    return 1;
+}
+
+void waveEventsUpdate(WaveEventPool* pool, float time) {
+    int kept = 0;
+    for (int i = 0; i < pool->liveCount; i++) {
+        int slot = pool->live[i];
+        WaveEvent* ev = &pool->events[slot];
+        if (isExpired(ev, time)) {
+            if (ev->type == WAVE_EVENT_FREEZE) {
+                pool->liveFreezes--;
+            }
+            ev->generation++;
+            pool->freeSlots[pool->freeCount++] = slot;
+        } else {
+            pool->live[kept++] = slot;
+        }
+    }
+    pool->liveCount = kept;
+}
+
+// Annulus [inner, outer] around the event outside of which it has no effect.
+// Ripple rings slow down inside freeze zones, so while any freeze is live the
+// inner edge assumes the slowest possible ring.
+static int influence(const WaveEventPool* pool, const WaveEvent* ev, float time, float* inner, float* outer) {
+    float elapsed = time - ev->startTime;
+    switch (ev->type) {
+        case WAVE_EVENT_RIPPLE: {
+            if (elapsed < 0.0f || elapsed >= RIPPLE_LIFETIME) {
+                return 0;
+            }
+            float radius = elapsed * RIPPLE_SPEED;
+            float slowest = pool->liveFreezes > 0 ? radius * 0.1f : radius;
+            *outer = radius + RIPPLE_WIDTH;
+            *inner = slowest - 1.0f - RIPPLE_WIDTH;
+            return 1;
+        }
+        case WAVE_EVENT_VORTEX:
+            *outer = VORTEX_RADIUS;
+            *inner = 0.0f;
+            return ev->held;
+        case WAVE_EVENT_FREEZE:
+            *outer = FREEZE_RADIUS;
+            *inner = 0.0f;
+            return ev->held || elapsed < FREEZE_LIFETIME;
+    }
+    return 0;
+}
+
+// Append the slot to every grid cell that overlaps the event's annulus and
+// still has room
+static void binEvent(WaveEventPool* pool, int slot, float time) {
+    const WaveEvent* ev = &pool->events[slot];
+    float inner, outer;
+    if (!influence(pool, ev, time, &inner, &outer)) {
+        return;
+    }
+
+    for (int row = 0; row < WAVE_GRID_ROWS; row++) {
+        float y0 = pool->gridMinY + row * pool->cellH;
+        float y1 = y0 + pool->cellH;
+        float dyMin = (ev->y >= y0 && ev->y <= y1) ? 0.0f : fminf(fabsf(ev->y - y0), fabsf(ev->y - y1));
+        float dyMax = fmaxf(fabsf(ev->y - y0), fabsf(ev->y - y1));
+        if (dyMin >= outer) {
+            continue;
+        }
+
+        // Columns reached by the outer circle...
+        float halfWidth = sqrtf(outer * outer - dyMin * dyMin);
+        int c0 = (int)floorf((ev->x - halfWidth - pool->gridMinX) / pool->cellW);
+        int c1 = (int)floorf((ev->x + halfWidth - pool->gridMinX) / pool->cellW);
+        if (c0 < 0) c0 = 0;
+        if (c1 >= WAVE_GRID_COLS) c1 = WAVE_GRID_COLS - 1;
+
+        // ...minus the ones lying entirely inside the hole
+        int h0 = c1 + 1, h1 = c1;
+        if (inner > dyMax) {
+            float holeWidth = sqrtf(inner * inner - dyMax * dyMax);
+            h0 = (int)ceilf((ev->x - holeWidth - pool->gridMinX) / pool->cellW);
+            h1 = (int)floorf((ev->x + holeWidth - pool->gridMinX) / pool->cellW) - 1;
+        }
+
+        for (int col = c0; col <= c1; col++) {
+            if (col >= h0 && col <= h1) {
+                col = h1;
+                continue;
+            }
+            int cell = row * WAVE_GRID_COLS + col;
+            if (pool->cellCount[cell] < WAVE_GRID_CELL_CAPACITY) {
+                pool->cellRefs[cell * WAVE_GRID_CELL_CAPACITY + pool->cellCount[cell]++] = slot;
+                if (pool->cellCount[cell] == WAVE_GRID_CELL_CAPACITY) {
+                    pool->fullCells++;
+                }
+            }
+        }
+    }
+}
+
+void waveEventsBuildGrid(WaveEventPool* pool, float time, float minX, float minY, float maxX, float maxY) {
+    pool->gridMinX = minX;
+    pool->gridMinY = minY;
+    pool->cellW = fmaxf((maxX - minX) / WAVE_GRID_COLS, 1e-4f);
+    pool->cellH = fmaxf((maxY - minY) / WAVE_GRID_ROWS, 1e-4f);
+    memset(pool->cellCount, 0, sizeof(pool->cellCount));
+    pool->fullCells = 0;
+
+    // Newest first, so when a cell overflows it keeps the youngest and
+    // therefore strongest events. Once every cell is full the older events
+    // cannot land anywhere and are not visited at all.
+    for (int i = pool->liveCount - 1; i >= 0 && pool->fullCells < WAVE_GRID_COLS * WAVE_GRID_ROWS; i--) {
+        binEvent(pool, pool->live[i], time);
+    }
+}
+
+// Same effects as the original single-click code, summed over every event in
+// the cell: freeze zones first (the strongest one sets the freeze factor),
+// then ripples, then vortices in spawn order.
+static void applyCell(const WaveEventPool* pool, const int* refs, int n, float time,
+                      float x, float worldX, float worldY, float* mulOut, float* addOut) {
+    float freezeStrength = 0.0f;
+    float add = 0.0f;
+
+    for (int k = 0; k < n; k++) {
+        const WaveEvent* ev = &pool->events[refs[k]];
+        if (ev->type != WAVE_EVENT_FREEZE) {
+            continue;
+        }
+        float dx = worldX - ev->x;
+        float dy = worldY - ev->y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        float elapsed = time - ev->startTime;
+        if ((ev->held || elapsed < FREEZE_LIFETIME) && dist < FREEZE_RADIUS) {
+            float strength = 1.0f - dist / FREEZE_RADIUS;
+            if (!ev->held) {
+                strength *= 1.0f - elapsed / FREEZE_LIFETIME;
+            }
+            // Crystalline patterns
+            add += sinf(x * 30.0f) * cosf(dy * 30.0f) * strength * 0.05f;
+            freezeStrength = fmaxf(freezeStrength, strength);
+        }
+    }
+    float freezeFactor = 1.0f - freezeStrength * 0.9f;
+    float mul = 1.0f;
+
+    for (int k = n - 1; k >= 0; k--) {
+        const WaveEvent* ev = &pool->events[refs[k]];
+        float dx = worldX - ev->x;
+        float dy = worldY - ev->y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        float elapsed = time - ev->startTime;
+
+        if (ev->type == WAVE_EVENT_RIPPLE && elapsed >= 0.0f && elapsed < RIPPLE_LIFETIME) {
+            // Multiple ripple rings, slowed by freeze
+            float rippleRadius = elapsed * RIPPLE_SPEED * freezeFactor;
+            for (int r = 0; r < 3; r++) {
+                float ringDist = fabsf(dist - (rippleRadius - r * 0.5f));
+                if (ringDist < RIPPLE_WIDTH) {
+                    float rippleStrength = (1.0f - ringDist / RIPPLE_WIDTH) * (1.0f - elapsed / RIPPLE_LIFETIME);
+                    add += sinf(dist * 10.0f - time * 5.0f * freezeFactor) * rippleStrength * 0.3f * freezeFactor;
+                }
+            }
+        } else if (ev->type == WAVE_EVENT_VORTEX && ev->held && dist < VORTEX_RADIUS) {
+            float vortexStrength = (1.0f - dist) * 0.5f * freezeFactor;
+            float angle = atan2f(dy, dx);
+
+            // Swirl, pull toward the centre and turbulence add to the height...
+            add += sinf(angle * 5.0f + time * 10.0f * freezeFactor - dist * 20.0f) * vortexStrength;
+            add -= dist * vortexStrength * 0.3f;
+            add += sinf(x * 50.0f + time * 20.0f * freezeFactor) * cosf(dy * 50.0f) * vortexStrength * 0.2f;
+
+            // ...and the pulse scales everything accumulated so far
+            float pulse = 1.0f + sinf(time * 15.0f * freezeFactor) * vortexStrength * 0.3f;
+            mul *= pulse;
+            add *= pulse;
+        }
+    }
+
+    *mulOut = mul;
+    *addOut = add;
+}
+
+// Each term is amplitude * frequency^2 of the sharpest component in
+// applyCell, with world-space frequencies scaled into grid units
+float waveEventsCurvature(const WaveEventPool* pool, float worldScale) {
+    int ripples = 0, vortices = 0;
+    for (int i = 0; i < pool->liveCount && !(ripples && vortices); i++) {
+        const WaveEvent* ev = &pool->events[pool->live[i]];
+        ripples |= ev->type == WAVE_EVENT_RIPPLE;
+        vortices |= ev->type == WAVE_EVENT_VORTEX && ev->held;
+    }
+
+    float curvature = 0.0f;
+    if (ripples) {
+        float k = 10.0f * worldScale;
+        curvature = fmaxf(curvature, 0.3f * k * k);
+    }
+    if (vortices) {
+        float k = 20.0f * worldScale;
+        curvature = fmaxf(curvature, fmaxf(0.5f * k * k, 0.1f * 50.0f * 50.0f));
+    }
+    if (pool->liveFreezes > 0) {
+        curvature = fmaxf(curvature, 0.05f * 30.0f * 30.0f);
+    }
+    return curvature;
+}
+
+int waveEventsEvaluateRow(const WaveEventPool* pool, float time, const float* xs, int count,
+                          float worldScale, float worldY, float* mul, float* add) {
+    if (pool->liveCount == 0) {
+        return 0;
+    }
+
+    int row = (int)floorf((worldY - pool->gridMinY) / pool->cellH);
+    if (row < 0) row = 0;
+    if (row >= WAVE_GRID_ROWS) row = WAVE_GRID_ROWS - 1;
+
+    // Skip the row entirely when none of its cells hold an event
+    const int* rowCount = &pool->cellCount[row * WAVE_GRID_COLS];
+    int rowEvents = 0;
+    for (int col = 0; col < WAVE_GRID_COLS; col++) {
+        rowEvents += rowCount[col];
+    }
+    if (rowEvents == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        float worldX = xs[i] * worldScale;
+        int col = (int)floorf((worldX - pool->gridMinX) / pool->cellW);
+        if (col < 0) col = 0;
+        if (col >= WAVE_GRID_COLS) col = WAVE_GRID_COLS - 1;
+
+        int cell = row * WAVE_GRID_COLS + col;
+        int n = pool->cellCount[cell];
+        if (n == 0) {
+            mul[i] = 1.0f;
+            add[i] = 0.0f;
+            continue;
+        }
+        applyCell(pool, &pool->cellRefs[cell * WAVE_GRID_CELL_CAPACITY], n, time, xs[i], worldX, worldY, &mul[i], &add[i]);
+    }
+
+    return 1;
+}
@@ -0,0 +1,74 @@
+#ifndef WAVE_EVENTS_H
+#define WAVE_EVENTS_H
+
+// Pool of live interaction events (ripples, vortices, freeze zones) plus a
+// uniform grid over the wave area, so each wave vertex only visits the events
+// whose radius of influence covers it. All storage is fixed-size: spawning
+// recycles expired slots and never allocates.
+
+#define WAVE_EVENT_CAPACITY 4096
+#define WAVE_GRID_COLS 64
+#define WAVE_GRID_ROWS 16
+// Newest events win when more than this many cover one cell
+#define WAVE_GRID_CELL_CAPACITY 64
+
+typedef enum {
+    WAVE_EVENT_RIPPLE,  // expanding rings, 5 seconds
+    WAVE_EVENT_VORTEX,  // whirlpool, lives while held
+    WAVE_EVENT_FREEZE   // slows nearby waves, held plus 3 seconds after the press
+} WaveEventType;
+
+typedef struct {
+    float x, y;
+    float startTime;
+    int type;
+    int held;
+    int generation;
+} WaveEvent;
+
+typedef struct {
+    WaveEvent events[WAVE_EVENT_CAPACITY];
+    int freeSlots[WAVE_EVENT_CAPACITY];
+    int freeCount;
+    int live[WAVE_EVENT_CAPACITY];  // slot indices, oldest first
+    int liveCount;
+    int liveFreezes;
+
+    float gridMinX, gridMinY;
+    float cellW, cellH;
+    int cellCount[WAVE_GRID_COLS * WAVE_GRID_ROWS];
+    int fullCells;
+    // Fixed WAVE_GRID_CELL_CAPACITY slots per cell, newest event first
+    int cellRefs[WAVE_GRID_COLS * WAVE_GRID_ROWS * WAVE_GRID_CELL_CAPACITY];
+} WaveEventPool;
+
+void waveEventsInit(WaveEventPool* pool);
+
+// Returns a handle for waveEventMove/waveEventRelease. When the pool is full
+// the oldest event that is not held is recycled; returns -1 only if every
+// slot is held.
+int waveEventSpawn(WaveEventPool* pool, WaveEventType type, float x, float y, float time, int held);
+
+// Handles of recycled events are ignored, so callers may keep stale ones
+void waveEventMove(WaveEventPool* pool, int handle, float x, float y);
+void waveEventRelease(WaveEventPool* pool, int handle);
+
+// Return expired events to the free list
+void waveEventsUpdate(WaveEventPool* pool, float time);
+
+// Bin the live events into the grid spanning [minX, maxX] x [minY, maxY].
+// Every point later passed to waveEventsEvaluateRow must lie in that box.
+void waveEventsBuildGrid(WaveEventPool* pool, float time, float minX, float minY, float maxX, float maxY);
+
+// Upper bound on |d2(add)/dx2| of the live events along a wave row, in
+// world height per grid unit squared, for level-of-detail selection
+float waveEventsCurvature(const WaveEventPool* pool, float worldScale);
+
+// Interaction terms for one wave row at height worldY: the final height of
+// vertex i is base * mul[i] + add[i]. xs are the strip's grid coordinates
+// and worldScale maps them to world x. Returns 0 (and leaves mul/add
+// untouched) when no event reaches the row.
+int waveEventsEvaluateRow(const WaveEventPool* pool, float time, const float* xs, int count,
+                          float worldScale, float worldY, float* mul, float* add);
+
+#endif
@@ -0,0 +1,261 @@
+#include "wave_field.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "worker_pool.h"
+
+// Courant number 0.6 (the 2D limit is 1/sqrt(2)) and roughly a quarter of
+// the energy lost per second
+#define FIELD_COURANT2 0.36f
+#define FIELD_DAMPING 0.9992f
+
+// All kernels evaluate the same expression in the same order, so they agree
+// bit for bit:
+//   prev = damping * ((2 - 4k) * cur - prev + k * ((W + E) + (N + S)))
+static void fieldRowScalar(float* prev, const float* cur, const float* up, const float* down, int count,
+                           float courant2, float damping) {
+    float centre = 2.0f - 4.0f * courant2;
+    for (int i = 0; i < count; i++) {
+        float sum = (cur[i - 1] + cur[i + 1]) + (up[i] + down[i]);
+        prev[i] = damping * ((centre * cur[i] - prev[i]) + courant2 * sum);
+    }
+}
+
+#if defined(__SSE2__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#define FIELD_HAVE_SSE2 1
+#include <emmintrin.h>
+
+static void fieldRowSSE2(float* prev, const float* cur, const float* up, const float* down, int count,
+                         float courant2, float damping) {
+    __m128 k = _mm_set1_ps(courant2);
+    __m128 centre = _mm_set1_ps(2.0f - 4.0f * courant2);
+    __m128 damp = _mm_set1_ps(damping);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(cur + i - 1), _mm_loadu_ps(cur + i + 1)),
+                                _mm_add_ps(_mm_loadu_ps(up + i), _mm_loadu_ps(down + i)));
+        __m128 v = _mm_sub_ps(_mm_mul_ps(centre, _mm_loadu_ps(cur + i)), _mm_loadu_ps(prev + i));
+        _mm_storeu_ps(prev + i, _mm_mul_ps(damp, _mm_add_ps(v, _mm_mul_ps(k, sum))));
+    }
+    fieldRowScalar(prev + i, cur + i, up + i, down + i, count - i, courant2, damping);
+}
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FIELD_HAVE_AVX2 1
+#include <immintrin.h>
+
+__attribute__((target("avx2"))) static void fieldRowAVX2(float* prev, const float* cur, const float* up,
+                                                         const float* down, int count, float courant2,
+                                                         float damping) {
+    __m256 k = _mm256_set1_ps(courant2);
+    __m256 centre = _mm256_set1_ps(2.0f - 4.0f * courant2);
+    __m256 damp = _mm256_set1_ps(damping);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(cur + i - 1), _mm256_loadu_ps(cur + i + 1)),
+                                   _mm256_add_ps(_mm256_loadu_ps(up + i), _mm256_loadu_ps(down + i)));
+        __m256 v = _mm256_sub_ps(_mm256_mul_ps(centre, _mm256_loadu_ps(cur + i)), _mm256_loadu_ps(prev + i));
+        _mm256_storeu_ps(prev + i, _mm256_mul_ps(damp, _mm256_add_ps(v, _mm256_mul_ps(k, sum))));
+    }
+    // The tail stays in this function: calling the non-VEX scalar kernel with
+    // the upper halves dirty would stall on the AVX/SSE transition
+    for (; i < count; i++) {
+        float s = (cur[i - 1] + cur[i + 1]) + (up[i] + down[i]);
+        prev[i] = damping * (((2.0f - 4.0f * courant2) * cur[i] - prev[i]) + courant2 * s);
+    }
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define FIELD_HAVE_NEON 1
+#include <arm_neon.h>
+
+static void fieldRowNEON(float* prev, const float* cur, const float* up, const float* down, int count,
+                         float courant2, float damping) {
+    float32x4_t k = vdupq_n_f32(courant2);
+    float32x4_t centre = vdupq_n_f32(2.0f - 4.0f * courant2);
+    float32x4_t damp = vdupq_n_f32(damping);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t sum = vaddq_f32(vaddq_f32(vld1q_f32(cur + i - 1), vld1q_f32(cur + i + 1)),
+                                    vaddq_f32(vld1q_f32(up + i), vld1q_f32(down + i)));
+        float32x4_t v = vsubq_f32(vmulq_f32(centre, vld1q_f32(cur + i)), vld1q_f32(prev + i));
+        vst1q_f32(prev + i, vmulq_f32(damp, vaddq_f32(v, vmulq_f32(k, sum))));
+    }
+    fieldRowScalar(prev + i, cur + i, up + i, down + i, count - i, courant2, damping);
+}
+#endif
+
+static void selectRowKernel(WaveField* f) {
+#ifdef FIELD_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        f->kernelName = "avx2";
+        f->row = fieldRowAVX2;
+        return;
+    }
+#endif
+#ifdef FIELD_HAVE_NEON
+    f->kernelName = "neon";
+    f->row = fieldRowNEON;
+#elif defined(FIELD_HAVE_SSE2)
+    f->kernelName = "sse2";
+    f->row = fieldRowSSE2;
+#else
+    f->kernelName = "scalar";
+    f->row = fieldRowScalar;
+#endif
+}
+
+int waveFieldInit(WaveField* f, int width, int height, float worldWidth) {
+    memset(f, 0, sizeof(*f));
+    if (width < 3 || height < 3) {
+        return 0;
+    }
+
+    size_t cells = (size_t)width * height;
+    float* storage = calloc(cells * 3, sizeof(float));
+    if (!storage) {
+        return 0;
+    }
+
+    f->width = width;
+    f->height = height;
+    f->cellSize = worldWidth / (width - 1);
+    f->minX = -0.5f * worldWidth;
+    f->minY = -0.5f * f->cellSize * (height - 1);
+    f->courant2 = FIELD_COURANT2;
+    f->damping = FIELD_DAMPING;
+    f->prev = storage;
+    f->cur = storage + cells;
+    f->last = storage + cells * 2;
+    selectRowKernel(f);
+    return 1;
+}
+
+void waveFieldDestroy(WaveField* f) {
+    // prev and cur share one allocation with last and swap every substep
+    free(f->prev < f->cur ? f->prev : f->cur);
+    memset(f, 0, sizeof(*f));
+}
+
+// Interior cells (border excluded) within radius of a world position
+static int discBounds(const WaveField* f, float x, float y, float radius, int* x0, int* y0, int* x1, int* y1) {
+    *x0 = (int)floorf((x - radius - f->minX) / f->cellSize);
+    *x1 = (int)ceilf((x + radius - f->minX) / f->cellSize);
+    *y0 = (int)floorf((y - radius - f->minY) / f->cellSize);
+    *y1 = (int)ceilf((y + radius - f->minY) / f->cellSize);
+    if (*x0 < 1) *x0 = 1;
+    if (*y0 < 1) *y0 = 1;
+    if (*x1 > f->width - 2) *x1 = f->width - 2;
+    if (*y1 > f->height - 2) *y1 = f->height - 2;
+    return *x0 <= *x1 && *y0 <= *y1;
+}
+
+void waveFieldImpulse(WaveField* f, float x, float y, float radius, float amount) {
+    int x0, y0, x1, y1;
+    // The Gaussian is negligible past three widths
+    if (!discBounds(f, x, y, radius * 3.0f, &x0, &y0, &x1, &y1)) {
+        return;
+    }
+    float invR2 = 1.0f / (radius * radius);
+    for (int cy = y0; cy <= y1; cy++) {
+        float dy = f->minY + cy * f->cellSize - y;
+        for (int cx = x0; cx <= x1; cx++) {
+            float dx = f->minX + cx * f->cellSize - x;
+            float bump = amount * expf(-(dx * dx + dy * dy) * invR2);
+            // Both time levels move, so the bump starts at rest and spreads
+            // out as a ring
+            f->cur[cy * f->width + cx] += bump;
+            f->prev[cy * f->width + cx] += bump;
+        }
+    }
+}
+
+void waveFieldDamp(WaveField* f, float x, float y, float radius, float strength) {
+    int x0, y0, x1, y1;
+    if (!discBounds(f, x, y, radius, &x0, &y0, &x1, &y1)) {
+        return;
+    }
+    for (int cy = y0; cy <= y1; cy++) {
+        float dy = f->minY + cy * f->cellSize - y;
+        for (int cx = x0; cx <= x1; cx++) {
+            float dx = f->minX + cx * f->cellSize - x;
+            float dist = sqrtf(dx * dx + dy * dy) / radius;
+            if (dist < 1.0f) {
+                float keep = 1.0f - strength * (1.0f - dist * dist);
+                f->cur[cy * f->width + cx] *= keep;
+                f->prev[cy * f->width + cx] *= keep;
+            }
+        }
+    }
+}
+
+static void fieldBandJob(void* ctx, int band) {
+    WaveField* f = ctx;
+    int y0 = 1 + band * WAVE_FIELD_BAND_ROWS;
+    int y1 = y0 + WAVE_FIELD_BAND_ROWS < f->height - 1 ? y0 + WAVE_FIELD_BAND_ROWS : f->height - 1;
+#ifdef FIELD_HAVE_SSE2
+    // Damped wavefronts trail off into denormals, which x86 handles in
+    // microcode at a fraction of the speed; flush them (FTZ | DAZ) while
+    // this band runs
+    unsigned int csr = _mm_getcsr();
+    _mm_setcsr(csr | 0x8040);
+#endif
+    for (int y = y0; y < y1; y++) {
+        const float* cur = &f->cur[y * f->width + 1];
+        f->row(&f->prev[y * f->width + 1], cur, cur - f->width, cur + f->width, f->width - 2, f->courant2,
+               f->damping);
+    }
+#ifdef FIELD_HAVE_SSE2
+    _mm_setcsr(csr);
+#endif
+}
+
+void waveFieldStep(WaveField* f) {
+    int bands = (f->height - 2 + WAVE_FIELD_BAND_ROWS - 1) / WAVE_FIELD_BAND_ROWS;
+    memcpy(f->last, f->cur, (size_t)f->width * f->height * sizeof(float));
+    for (int step = 0; step < WAVE_FIELD_SUBSTEPS; step++) {
+        // Every band reads only cur and writes only its own rows of prev,
+        // which then becomes the new cur
+        workerPoolRun(fieldBandJob, f, bands);
+        float* swap = f->prev;
+        f->prev = f->cur;
+        f->cur = swap;
+    }
+}
+
+void waveFieldSampleRow(const WaveField* f, const float* xs, int count, float worldScale, float y, float alpha,
+                        float* out) {
+    float gy = (y - f->minY) / f->cellSize;
+    int iy = (int)floorf(gy);
+    if (iy < 0 || iy >= f->height - 1) {
+        memset(out, 0, count * sizeof(float));
+        return;
+    }
+    float fy = gy - iy;
+    const float* row0 = &f->cur[iy * f->width];
+    const float* row1 = row0 + f->width;
+    const float* last0 = &f->last[iy * f->width];
+    const float* last1 = last0 + f->width;
+
+    for (int i = 0; i < count; i++) {
+        float gx = (xs[i] * worldScale - f->minX) / f->cellSize;
+        int ix = (int)floorf(gx);
+        if (ix < 0 || ix >= f->width - 1) {
+            out[i] = 0.0f;
+            continue;
+        }
+        float fx = gx - ix;
+        float top = row0[ix] + (row0[ix + 1] - row0[ix]) * fx;
+        float bottom = row1[ix] + (row1[ix + 1] - row1[ix]) * fx;
+        float now = top + (bottom - top) * fy;
+        top = last0[ix] + (last0[ix + 1] - last0[ix]) * fx;
+        bottom = last1[ix] + (last1[ix + 1] - last1[ix]) * fx;
+        float before = top + (bottom - top) * fy;
+        out[i] = before + (now - before) * alpha;
+    }
+}
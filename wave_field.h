@@ -0,0 +1,60 @@
+#ifndef WAVE_FIELD_H
+#define WAVE_FIELD_H
+
+// Discrete 2D wave equation on a heightfield, for the --physics mode of
+// waves.c. Each call to waveFieldStep advances one 1/60 s frame as
+// WAVE_FIELD_SUBSTEPS leapfrog updates of the 5-point stencil
+//
+//   next = damping * (2 * cur - prev + courant2 * (N + S + E + W - 4 * cur))
+//
+// next overwrites prev in place, so the field is just two row-major float
+// planes. A substep is split into bands of WAVE_FIELD_BAND_ROWS rows that
+// run as worker pool jobs; within a band the kernel streams along the rows
+// with the three cur rows it touches resident in L1. The border cells are
+// held at zero.
+
+#define WAVE_FIELD_SUBSTEPS 6
+#define WAVE_FIELD_BAND_ROWS 32
+#define WAVE_FIELD_DEFAULT_WIDTH 1024
+#define WAVE_FIELD_DEFAULT_HEIGHT 512
+
+typedef void (*WaveFieldRowFn)(float* prev, const float* cur, const float* up, const float* down, int count,
+                               float courant2, float damping);
+
+typedef struct {
+    int width, height;
+    float minX, minY;  // world position of cell (0, 0)
+    float cellSize;  // world units between neighbouring cells
+    float courant2;  // (c * dt / cellSize)^2 per substep, at most 0.5 for stability
+    float damping;  // per substep
+
+    // Displacement at the previous and current substep
+    float* prev;
+    float* cur;
+    // cur as it was before the latest waveFieldStep, for interpolated sampling
+    float* last;
+
+    const char* kernelName;
+    WaveFieldRowFn row;
+} WaveField;
+
+// Allocate a width x height field spanning worldWidth units, centred on the
+// origin. Returns 0 if the size is unusable or memory runs out.
+int waveFieldInit(WaveField* f, int width, int height, float worldWidth);
+void waveFieldDestroy(WaveField* f);
+
+// Push a Gaussian bump of the given peak height into the surface
+void waveFieldImpulse(WaveField* f, float x, float y, float radius, float amount);
+
+// Bleed energy out of a disc: strength 0 leaves it alone, 1 stills it
+void waveFieldDamp(WaveField* f, float x, float y, float radius, float strength);
+
+// Advance one frame, splitting each substep's bands across the worker pool
+void waveFieldStep(WaveField* f);
+
+// Bilinear displacement under world (xs[i] * worldScale, y), 0 off the field,
+// alpha of the way from the state before the latest step to the latest one
+void waveFieldSampleRow(const WaveField* f, const float* xs, int count, float worldScale, float y, float alpha,
+                        float* out);
+
+#endif
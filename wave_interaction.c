@@ -0,0 +1,166 @@
+#ifdef _WIN32
+#include <GL/gl.h>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <stddef.h>
+#include <string.h>
+
+#include "wave_interaction.h"
+
+#define RIPPLE_LIFETIME 5.0f
+#define FREEZE_LIFETIME 3.0f
+#define CRYSTAL_LIFETIME 4.0f
+
+void waveInteractionsInit(WaveInteractions* w) {
+    memset(w, 0, sizeof(*w));
+    w->rippleId = w->vortexId = w->freezeId = w->crystalId = -1;
+
+    glGenBuffers(1, &w->buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, w->buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(w->block), &w->block, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, WAVE_INTERACTION_BINDING, w->buffer);
+}
+
+void waveInteractionsDestroy(WaveInteractions* w) {
+    if (w->buffer) {
+        glDeleteBuffers(1, &w->buffer);
+    }
+    w->buffer = 0;
+}
+
+void waveInteractionsAttach(unsigned int program) {
+    GLuint index = glGetUniformBlockIndex(program, "Interactions");
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, index, WAVE_INTERACTION_BINDING);
+    }
+}
+
+static void removeEvent(WaveInteractions* w, int index) {
+    int tail = w->block.count - index - 1;
+    memmove(&w->block.events[index], &w->block.events[index + 1], tail * sizeof(WaveInteractionEvent));
+    memmove(&w->held[index], &w->held[index + 1], tail * sizeof(int));
+    memmove(&w->ids[index], &w->ids[index + 1], tail * sizeof(int));
+    w->block.count--;
+}
+
+static int findEvent(const WaveInteractions* w, int id) {
+    for (int i = 0; id >= 0 && i < w->block.count; i++) {
+        if (w->ids[i] == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// When the list is full the oldest event that is not held makes room
+static int spawn(WaveInteractions* w, WaveInteractionType type, float x, float y, float time) {
+    if (w->block.count == WAVE_INTERACTION_CAPACITY) {
+        int oldest = 0;
+        while (oldest < w->block.count && w->held[oldest]) {
+            oldest++;
+        }
+        if (oldest == w->block.count) {
+            return -1;
+        }
+        removeEvent(w, oldest);
+    }
+
+    int i = w->block.count++;
+    WaveInteractionEvent* ev = &w->block.events[i];
+    memset(ev, 0, sizeof(*ev));
+    ev->x = x;
+    ev->y = y;
+    ev->startTime = time;
+    ev->strength = 1.0f;
+    ev->type = type;
+    w->held[i] = 1;
+    w->ids[i] = w->nextId;
+    w->nextId = (w->nextId + 1) & 0x7fffffff;
+    return w->ids[i];
+}
+
+static void release(WaveInteractions* w, int* id) {
+    int i = findEvent(w, *id);
+    if (i >= 0) {
+        w->held[i] = 0;
+    }
+    *id = -1;
+}
+
+static void move(WaveInteractions* w, int id, float x, float y) {
+    int i = findEvent(w, id);
+    if (i >= 0) {
+        w->block.events[i].x = x;
+        w->block.events[i].y = y;
+    }
+}
+
+void waveInteractionsButton(WaveInteractions* w, int button, int pressed, float x, float y, float time) {
+    if (button == 0) {
+        release(w, &w->rippleId);
+        release(w, &w->vortexId);
+        if (pressed) {
+            w->rippleId = spawn(w, WAVE_INTERACTION_RIPPLE, x, y, time);
+            w->vortexId = spawn(w, WAVE_INTERACTION_VORTEX, x, y, time);
+        }
+    } else if (button == 1) {
+        release(w, &w->freezeId);
+        release(w, &w->crystalId);
+        if (pressed) {
+            w->freezeId = spawn(w, WAVE_INTERACTION_FREEZE, x, y, time);
+            w->crystalId = spawn(w, WAVE_INTERACTION_CRYSTAL, x, y, time);
+        }
+    }
+}
+
+void waveInteractionsDrag(WaveInteractions* w, float x, float y) {
+    move(w, w->rippleId, x, y);
+    move(w, w->vortexId, x, y);
+    move(w, w->freezeId, x, y);
+    move(w, w->crystalId, x, y);
+}
+
+// Ripples run their course whether held or not; the rest stay at full
+// strength while held and, apart from vortices, fade out from the press
+static float strength(const WaveInteractionEvent* ev, int held, float time) {
+    float elapsed = time - ev->startTime;
+    switch (ev->type) {
+        case WAVE_INTERACTION_RIPPLE:
+            return 1.0f - elapsed / RIPPLE_LIFETIME;
+        case WAVE_INTERACTION_VORTEX:
+            return held ? 1.0f : 0.0f;
+        case WAVE_INTERACTION_FREEZE:
+            return held ? 1.0f : 1.0f - elapsed / FREEZE_LIFETIME;
+        case WAVE_INTERACTION_CRYSTAL:
+            return held ? 1.0f : 1.0f - elapsed / CRYSTAL_LIFETIME;
+    }
+    return 0.0f;
+}
+
+void waveInteractionsUpdate(WaveInteractions* w, float time) {
+    int kept = 0;
+    for (int i = 0; i < w->block.count; i++) {
+        float s = strength(&w->block.events[i], w->held[i], time);
+        if (s <= 0.0f) {
+            continue;
+        }
+        w->block.events[kept] = w->block.events[i];
+        w->block.events[kept].strength = s > 1.0f ? 1.0f : s;
+        w->held[kept] = w->held[i];
+        w->ids[kept] = w->ids[i];
+        kept++;
+    }
+    w->block.count = kept;
+
+    // Only the live part of the array goes over
+    glBindBuffer(GL_UNIFORM_BUFFER, w->buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, offsetof(WaveInteractionBlock, events) + kept * sizeof(WaveInteractionEvent),
+                    &w->block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
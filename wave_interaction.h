@@ -0,0 +1,73 @@
+#ifndef WAVE_INTERACTION_H
+#define WAVE_INTERACTION_H
+
+// Mouse interaction for the full-screen wave shader: the ripples, vortices,
+// freeze zones and ice crystals of waves.c, evaluated per pixel in the
+// fragment shader instead of per vertex on the CPU. The CPU side only keeps
+// the list of live events, holding each one's position, start time, type
+// and current strength, and copies it into a uniform buffer once a frame.
+//
+// The left button drops a ripple and holds a vortex, and the right button
+// holds a freeze zone with a crystal at its centre. Both follow the pointer
+// while the button is held. Positions are in the shader's view coordinates
+// (wavePos), the same space the wave is evaluated in.
+
+// 32 bytes per event keeps the block inside the 16 KB every GL 3.3
+// implementation must support for uniform blocks
+#define WAVE_INTERACTION_CAPACITY 256
+#define WAVE_INTERACTION_BINDING 0
+
+typedef enum {
+    WAVE_INTERACTION_RIPPLE,   // expanding rings, 5 seconds
+    WAVE_INTERACTION_VORTEX,   // whirlpool, lives while held
+    WAVE_INTERACTION_FREEZE,   // slows nearby waves, held plus 3 seconds after the press
+    WAVE_INTERACTION_CRYSTAL   // spinning ice crystal, held plus 4 seconds after the press
+} WaveInteractionType;
+
+// One element of the shader's std140 Interactions block
+typedef struct {
+    float x, y;
+    float startTime;
+    float strength;  // 1 fading to 0 as the event expires
+    int type;
+    int padding[3];
+} WaveInteractionEvent;
+
+// The whole block: the count, padded to 16 bytes, then the events oldest
+// first
+typedef struct {
+    int count;
+    int padding[3];
+    WaveInteractionEvent events[WAVE_INTERACTION_CAPACITY];
+} WaveInteractionBlock;
+
+typedef struct {
+    WaveInteractionBlock block;
+    int held[WAVE_INTERACTION_CAPACITY];
+    int ids[WAVE_INTERACTION_CAPACITY];
+    int nextId;
+
+    // Events following each button, or -1
+    int rippleId, vortexId, freezeId, crystalId;
+
+    unsigned int buffer;
+} WaveInteractions;
+
+void waveInteractionsInit(WaveInteractions* w);
+void waveInteractionsDestroy(WaveInteractions* w);
+
+// Point a program's Interactions block at the buffer. Needed once per
+// program, after linking or loading it.
+void waveInteractionsAttach(unsigned int program);
+
+// button 0 is the left button, 1 the right. Press spawns the button's
+// events at (x, y), release lets them run out.
+void waveInteractionsButton(WaveInteractions* w, int button, int pressed, float x, float y, float time);
+// Move the events of any held button
+void waveInteractionsDrag(WaveInteractions* w, float x, float y);
+
+// Retire expired events, work out each one's strength at time and upload
+// the block
+void waveInteractionsUpdate(WaveInteractions* w, float time);
+
+#endif
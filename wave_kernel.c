@@ -0,0 +1,194 @@
+#include "wave_kernel.h"
+#include "wave_simd.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#define WK_PI 3.14159265358979323846
+
+// Everything that is constant across one layer, hoisted out of the vertex loop
+typedef struct {
+    float layerOffset;
+    float amp3, amp5, amp7;
+    float k3, k5, k7;
+    float ph3, ph5, ph7;
+
+    float phColor, phShimmer;
+} WaveLayerConsts;
+
+// Reduce a time-only phase in double precision so the float sine arguments
+// stay small no matter how long the program has been running.
+static float wrapPhase(double phase) {
+    return (float)fmod(phase, 2.0 * WK_PI);
+}
+
+static void waveLayerSetup(const WaveParams* p, WaveLayerConsts* c) {
+    float time = p->time;
+    float layerSpeed = 1.0f + p->layer * 0.3f;
+    float layerAmplitude = 0.1f + p->layer * 0.02f;
+
+    c->layerOffset = p->layer * 0.3f - 0.6f;
+    c->amp3 = layerAmplitude;
+    c->amp5 = layerAmplitude * 0.5f;
+    c->amp7 = layerAmplitude * 0.3f;
+    c->k3 = 3.0f * p->zoom;
+    c->k5 = 5.0f * p->zoom;
+    c->k7 = 7.0f * p->zoom;
+    c->ph3 = wrapPhase((double)time * layerSpeed);
+    c->ph5 = wrapPhase(-(double)time * layerSpeed * 0.7);
+    c->ph7 = wrapPhase((double)time * layerSpeed * 1.3);
+
+    c->phColor = wrapPhase((double)time * 0.5);
+    c->phShimmer = wrapPhase((double)time * 3.0);
+}
+
+void waveLayerScalar(const WaveParams* p, const float* xs, int count,
+                     float* ys, float* rs, float* gs, float* bs) {
+    WaveLayerConsts c;
+    waveLayerSetup(p, &c);
+
+    for (int i = 0; i < count; i++) {
+        float x = xs[i];
+
+        // Multiple sine waves for complex motion
+        float wave = sinf(x * c.k3 + c.ph3) * c.amp3;
+        wave += sinf(x * c.k5 + c.ph5) * c.amp5;
+        wave += sinf(x * c.k7 + c.ph7) * c.amp7;
+
+        // Ripples, vortices and freeze zones
+        if (p->interactMul) {
+            wave = wave * p->interactMul[i] + p->interactAdd[i];
+        }
+
+        float y = c.layerOffset + wave;
+        float gradient = (y + 1.0f) * 0.5f;
+
+        // Nearest palette entry, clamped to the table
+        float index = gradient * (PALETTE_LUT_SIZE - 1) + 0.5f;
+        if (index < 0.0f) index = 0.0f;
+        if (index > PALETTE_LUT_SIZE - 1) index = PALETTE_LUT_SIZE - 1;
+        int entry = (int)index;
+
+        float waveColorShift = sinf(x * 2.0f + c.phColor) * 0.3f + 0.7f;
+        float shimmer = sinf(x * 20.0f + c.phShimmer) * 0.05f;
+
+        ys[i] = y;
+        rs[i] = p->palette->r[entry] * waveColorShift + shimmer;
+        gs[i] = p->palette->g[entry] * waveColorShift + shimmer;
+        bs[i] = p->palette->b[entry] * waveColorShift + shimmer * 1.2f;
+    }
+}
+
+#ifdef WK_HAVE_SSE2
+static inline __m128 wkGatherSSE2(const float* table, __m128i index) {
+    int i[4];
+    _mm_storeu_si128((__m128i*)i, index);
+    return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+#define VF __m128
+#define VI __m128i
+#define VW 4
+#define V_SET1(a) _mm_set1_ps(a)
+#define V_LOAD(p) _mm_loadu_ps(p)
+#define V_STORE(p, v) _mm_storeu_ps(p, v)
+#define V_ADD(a, b) _mm_add_ps(a, b)
+#define V_MUL(a, b) _mm_mul_ps(a, b)
+#define V_MIN(a, b) _mm_min_ps(a, b)
+#define V_MAX(a, b) _mm_max_ps(a, b)
+#define V_TOINT(a) _mm_cvttps_epi32(a)
+#define V_GATHER(t, i) wkGatherSSE2(t, i)
+#define V_SIN(a) wkSinSSE2(a)
+#define WK_NAME waveLayerSSE2
+#define WK_TARGET
+#include "wave_kernel_body.h"
+#endif
+
+#ifdef WK_HAVE_AVX2
+#define VF __m256
+#define VI __m256i
+#define VW 8
+#define V_SET1(a) _mm256_set1_ps(a)
+#define V_LOAD(p) _mm256_loadu_ps(p)
+#define V_STORE(p, v) _mm256_storeu_ps(p, v)
+#define V_ADD(a, b) _mm256_add_ps(a, b)
+#define V_MUL(a, b) _mm256_mul_ps(a, b)
+#define V_MIN(a, b) _mm256_min_ps(a, b)
+#define V_MAX(a, b) _mm256_max_ps(a, b)
+#define V_TOINT(a) _mm256_cvttps_epi32(a)
+#define V_GATHER(t, i) _mm256_i32gather_ps(t, i, 4)
+#define V_SIN(a) wkSinAVX2(a)
+#define WK_NAME waveLayerAVX2
+#define WK_TARGET __attribute__((target("avx2")))
+#include "wave_kernel_body.h"
+#endif
+
+#ifdef WK_HAVE_NEON
+static inline float32x4_t wkGatherNEON(const float* table, int32x4_t index) {
+    int32_t i[4];
+    vst1q_s32(i, index);
+    float v[4] = {table[i[0]], table[i[1]], table[i[2]], table[i[3]]};
+    return vld1q_f32(v);
+}
+
+#define VF float32x4_t
+#define VI int32x4_t
+#define VW 4
+#define V_SET1(a) vdupq_n_f32(a)
+#define V_LOAD(p) vld1q_f32(p)
+#define V_STORE(p, v) vst1q_f32(p, v)
+#define V_ADD(a, b) vaddq_f32(a, b)
+#define V_MUL(a, b) vmulq_f32(a, b)
+#define V_MIN(a, b) vminq_f32(a, b)
+#define V_MAX(a, b) vmaxq_f32(a, b)
+#define V_TOINT(a) vcvtq_s32_f32(a)
+#define V_GATHER(t, i) wkGatherNEON(t, i)
+#define V_SIN(a) wkSinNEON(a)
+#define WK_NAME waveLayerNEON
+#define WK_TARGET
+#include "wave_kernel_body.h"
+#endif
+
+void waveTint(float time, float tint[3]) {
+    float colorShift = sinf(time * 0.3f) * 0.5f + 0.5f;
+    tint[0] = 0.7f + colorShift * 0.3f;
+    tint[1] = 0.8f + colorShift * 0.2f;
+    tint[2] = 0.9f + colorShift * 0.1f;
+}
+
+static int kernelSupported(const char* name) {
+#ifdef WK_HAVE_AVX2
+    if (strcmp(name, "avx2") == 0) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void)name;
+    return 1;
+}
+
+// Widest first, so "auto" picks the first supported entry
+static const WaveKernel waveKernels[] = {
+#ifdef WK_HAVE_AVX2
+    {"avx2", waveLayerAVX2},
+#endif
+#ifdef WK_HAVE_NEON
+    {"neon", waveLayerNEON},
+#endif
+#ifdef WK_HAVE_SSE2
+    {"sse2", waveLayerSSE2},
+#endif
+    {"scalar", waveLayerScalar},
+};
+
+const WaveKernel* waveKernelSelect(const char* name) {
+    int autoSelect = (name == NULL || strcmp(name, "auto") == 0);
+    for (size_t i = 0; i < sizeof(waveKernels) / sizeof(waveKernels[0]); i++) {
+        const WaveKernel* k = &waveKernels[i];
+        if ((autoSelect || strcmp(name, k->name) == 0) && kernelSupported(k->name)) {
+            return k;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef WAVE_KERNEL_H
+#define WAVE_KERNEL_H
+
+// Batch evaluation of one waves.c wave layer in structure-of-arrays form.
+// Given the strip's x-grid (in [-1, 1]) a kernel writes the crest height and
+// the shaded colour of every column, so the caller only has to pack and submit.
+
+#include "palette.h"
+
+typedef struct {
+    float time;
+    float zoom;
+    float aspect;
+    int layer;
+
+    // Optional per-vertex interaction terms (see wave_events.h): the crest
+    // height becomes base * interactMul[i] + interactAdd[i]. NULL when no
+    // ripple, vortex or freeze zone reaches this layer.
+    const float* interactMul;
+    const float* interactAdd;
+
+    // Gradient colours, already multiplied by this frame's waveTint()
+    const PaletteLut* palette;
+} WaveParams;
+
+typedef void (*WaveLayerFn)(const WaveParams* p, const float* xs, int count,
+                            float* ys, float* rs, float* gs, float* bs);
+
+typedef struct {
+    const char* name;
+    WaveLayerFn evaluate;
+} WaveKernel;
+
+// Plain libm implementation that mirrors the original per-vertex loop; the
+// SIMD kernels are checked against it.
+void waveLayerScalar(const WaveParams* p, const float* xs, int count,
+                     float* ys, float* rs, float* gs, float* bs);
+
+// The slow colour drift of the whole scene at a given time, applied once
+// per frame to the palette (CPU) or as a uniform (GPU)
+void waveTint(float time, float tint[3]);
+
+// Look up a kernel by name ("scalar", "sse2", "avx2", "neon"). NULL or "auto"
+// picks the widest one this CPU supports. Returns NULL if the requested kernel
+// is unknown or not available on this machine.
+const WaveKernel* waveKernelSelect(const char* name);
+
+#endif
@@ -0,0 +1,77 @@
+// SIMD body of the wave layer kernel.
+//
+// wave_kernel.c includes this once per instruction set after defining the
+// V_* vector macros, VF/VI/VW, WK_NAME and WK_TARGET. It follows
+// waveLayerScalar() step for step, gathering the palette entries lane by
+// lane where the ISA has no gather, and leaves the ragged tail of the strip
+// to the scalar reference. All macros
+// are undefined at the end so the next ISA can redefine them.
+
+WK_TARGET static void WK_NAME(const WaveParams* p, const float* xs, int count,
+                              float* ys, float* rs, float* gs, float* bs) {
+    WaveLayerConsts c;
+    waveLayerSetup(p, &c);
+
+    const VF zero = V_SET1(0.0f);
+    const VF one = V_SET1(1.0f);
+    int i = 0;
+
+    for (; i + VW <= count; i += VW) {
+        VF x = V_LOAD(xs + i);
+
+        // Multiple sine waves for complex motion
+        VF wave = V_MUL(V_SIN(V_ADD(V_MUL(x, V_SET1(c.k3)), V_SET1(c.ph3))), V_SET1(c.amp3));
+        wave = V_ADD(wave, V_MUL(V_SIN(V_ADD(V_MUL(x, V_SET1(c.k5)), V_SET1(c.ph5))), V_SET1(c.amp5)));
+        wave = V_ADD(wave, V_MUL(V_SIN(V_ADD(V_MUL(x, V_SET1(c.k7)), V_SET1(c.ph7))), V_SET1(c.amp7)));
+
+        // Ripples, vortices and freeze zones
+        if (p->interactMul) {
+            wave = V_ADD(V_MUL(wave, V_LOAD(p->interactMul + i)), V_LOAD(p->interactAdd + i));
+        }
+
+        VF y = V_ADD(V_SET1(c.layerOffset), wave);
+        VF gradient = V_MUL(V_ADD(y, one), V_SET1(0.5f));
+
+        // Nearest palette entry, clamped to the table
+        VF index = V_ADD(V_MUL(gradient, V_SET1(PALETTE_LUT_SIZE - 1)), V_SET1(0.5f));
+        VI entry = V_TOINT(V_MIN(V_MAX(index, zero), V_SET1(PALETTE_LUT_SIZE - 1)));
+
+        VF waveColorShift = V_ADD(V_MUL(V_SIN(V_ADD(V_MUL(x, V_SET1(2.0f)), V_SET1(c.phColor))), V_SET1(0.3f)), V_SET1(0.7f));
+        VF shimmer = V_MUL(V_SIN(V_ADD(V_MUL(x, V_SET1(20.0f)), V_SET1(c.phShimmer))), V_SET1(0.05f));
+        const float* lut[3] = {p->palette->r, p->palette->g, p->palette->b};
+        const float shimmerScale[3] = {1.0f, 1.0f, 1.2f};
+        float* out[3] = {rs + i, gs + i, bs + i};
+
+        for (int ch = 0; ch < 3; ch++) {
+            VF color = V_MUL(V_GATHER(lut[ch], entry), waveColorShift);
+            color = V_ADD(color, V_MUL(shimmer, V_SET1(shimmerScale[ch])));
+            V_STORE(out[ch], color);
+        }
+        V_STORE(ys + i, y);
+    }
+
+    if (i < count) {
+        WaveParams tail = *p;
+        if (tail.interactMul) {
+            tail.interactMul += i;
+            tail.interactAdd += i;
+        }
+        waveLayerScalar(&tail, xs + i, count - i, ys + i, rs + i, gs + i, bs + i);
+    }
+}
+
+#undef VF
+#undef VI
+#undef VW
+#undef V_SET1
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_MUL
+#undef V_MIN
+#undef V_MAX
+#undef V_TOINT
+#undef V_GATHER
+#undef V_SIN
+#undef WK_NAME
+#undef WK_TARGET
@@ -0,0 +1,55 @@
+#include "wave_presets.h"
+
+// Four octaves over a blue-to-lavender ramp, drifting toward peach, with the
+// band around the middle lit up. The middle stops follow the original
+// mix(mix(deep, sky, g), lavender, g * g) curve.
+static const WaveOctave peacefulOctaves[] = {
+    {3.0f, 0.0f, 1.0f, 0.0f, 0.15f},
+    {5.0f, 0.0f, -0.8f, 0.0f, 0.08f},
+    {7.0f, 0.0f, 1.2f, 0.0f, 0.04f},
+    {2.0f, 4.0f, 0.5f, 0.0f, 0.05f},
+};
+static const WaveStop peacefulStops[] = {
+    {0.1f, 0.3f, 0.6f, 0.0f},        // deep blue
+    {0.251f, 0.451f, 0.7f, 0.25f},
+    {0.461f, 0.616f, 0.82f, 0.5f},
+    {0.691f, 0.749f, 0.93f, 0.75f},
+    {0.9f, 0.8f, 1.0f, 1.0f},        // lavender
+};
+const WaveShaderConfig wavePresetPeaceful = {
+    .octaves = peacefulOctaves,
+    .octaveCount = 4,
+    .stops = peacefulStops,
+    .stopCount = 5,
+    .drift = 1,
+    .driftColor = {1.0f, 0.85f, 0.7f},  // peach
+    .driftAmount = 0.15f,
+    .driftSpread = 0.5f,
+    .band = 1,
+    .interaction = 1,
+};
+
+// Four octaves pulling the surface down over a deep-water-to-foam ramp,
+// with shimmer. Halving the amplitudes and flipping their sign gives the
+// original uv.y - wave * 0.5, and cos(a) is sin(a + pi/2).
+static const WaveOctave peacefulWavesOctaves[] = {
+    {6.0f, 0.0f, 2.0f, 0.0f, -0.05f},
+    {4.0f, 0.0f, -1.5f, 0.0f, -0.075f},
+    {8.0f, 3.0f, 1.0f, 0.0f, -0.025f},
+    {2.0f, 0.0f, 0.8f, 1.5707963f, -0.1f},
+};
+static const WaveStop peacefulWavesStops[] = {
+    {0.0f, 0.1f, 0.3f, 0.0f},     // deep water
+    {0.0f, 0.3f, 0.5f, 0.25f},    // mid water
+    {0.2f, 0.5f, 0.7f, 0.5f},     // shallow water
+    {0.9f, 0.95f, 1.0f, 0.75f},   // foam, and nothing but foam above it
+    {0.9f, 0.95f, 1.0f, 1.0f},
+};
+const WaveShaderConfig wavePresetPeacefulWaves = {
+    .octaves = peacefulWavesOctaves,
+    .octaveCount = 4,
+    .stops = peacefulWavesStops,
+    .stopCount = 5,
+    .shimmer = 1,
+    .interaction = 1,
+};
@@ -0,0 +1,15 @@
+#ifndef WAVE_PRESETS_H
+#define WAVE_PRESETS_H
+
+// The wave shader configurations of the full-screen programs, shared with
+// the CPU renderer (wave_raster.h) so both draw the same picture from the
+// same tables.
+
+#include "wave_shader.h"
+
+// main.c (make peaceful)
+extern const WaveShaderConfig wavePresetPeaceful;
+// main_waves.c (make peaceful_waves)
+extern const WaveShaderConfig wavePresetPeacefulWaves;
+
+#endif
@@ -0,0 +1,593 @@
+#include "wave_raster.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "wave_simd.h"
+#include "worker_pool.h"
+
+#define WR_PI 3.14159265358979323846
+
+// Everything that is constant across one frame, hoisted out of the pixels
+typedef struct {
+    int octaves;
+    float freqX[WAVE_SHADER_MAX_OCTAVES];
+    float freqY[WAVE_SHADER_MAX_OCTAVES];
+    float timePhase[WAVE_SHADER_MAX_OCTAVES];  // speed * time + phase
+    float amplitude[WAVE_SHADER_MAX_OCTAVES];
+
+    // Segment k runs from stop k to stop k + 1
+    int stops;
+    float stopPosition[WAVE_SHADER_MAX_STOPS];
+    float stopScale[WAVE_SHADER_MAX_STOPS];  // 1 / segment length
+    float stopColor[3][WAVE_SHADER_MAX_STOPS];
+    float stopDelta[3][WAVE_SHADER_MAX_STOPS];
+
+    int drift;
+    float driftPhase, driftSpread, driftAmount, driftColor[3];
+    int band;
+    int shimmer;
+    float shimmerPhase, shimmerRowPhase;
+
+    float time;
+} RasterConsts;
+
+// A run of pixels along one row of a tile
+typedef struct {
+    float x0, dx;  // view x of the first pixel, and the step
+    float y;
+    int count;
+
+    // Per row: freqY * y + timePhase for each octave, and the row's shimmer
+    // factor
+    float rowPhase[WAVE_SHADER_MAX_OCTAVES];
+    float shimmerRow;
+
+    // Interaction terms per pixel: the wave height becomes
+    // wave * interactMul[i] + interactAdd[i]. NULL when no event reaches
+    // the tile.
+    const float* interactMul;
+    const float* interactAdd;
+    // Ice crystals per pixel: each channel becomes
+    // color * crystalKeep[i] + crystalAdd[ch][i]. NULL when there are none.
+    const float* crystalKeep;
+    const float* crystalAdd[3];
+
+    unsigned char* out;  // RGBA
+} RasterSpan;
+
+struct WaveRasterKernel {
+    const char* name;
+    void (*span)(const RasterConsts* c, const RasterSpan* s);
+};
+
+// Reduce a time-only phase in double precision so the float sine arguments
+// stay small no matter how long the program has been running.
+static float wrapPhase(double phase) {
+    return (float)fmod(phase, 2.0 * WR_PI);
+}
+
+static void rasterSetup(const WaveShaderConfig* config, const WaveRasterFrame* frame, RasterConsts* c) {
+    double time = frame->time;
+    memset(c, 0, sizeof(*c));
+    c->time = frame->time;
+
+    c->octaves = config->octaveCount;
+    for (int o = 0; o < c->octaves; o++) {
+        const WaveOctave* octave = &config->octaves[o];
+        c->freqX[o] = octave->freqX;
+        c->freqY[o] = octave->freqY;
+        c->timePhase[o] = wrapPhase(octave->speed * time + octave->phase);
+        c->amplitude[o] = octave->amplitude;
+    }
+
+    c->stops = config->stopCount;
+    for (int k = 0; k < c->stops; k++) {
+        const WaveStop* stop = &config->stops[k];
+        const WaveStop* next = &config->stops[k + 1 < c->stops ? k + 1 : k];
+        float length = next->position - stop->position;
+        c->stopPosition[k] = stop->position;
+        c->stopScale[k] = length > 0.0f ? 1.0f / length : 0.0f;
+        c->stopColor[0][k] = stop->r;
+        c->stopColor[1][k] = stop->g;
+        c->stopColor[2][k] = stop->b;
+        c->stopDelta[0][k] = next->r - stop->r;
+        c->stopDelta[1][k] = next->g - stop->g;
+        c->stopDelta[2][k] = next->b - stop->b;
+    }
+
+    c->drift = config->drift;
+    c->driftPhase = wrapPhase(time * 0.3);
+    c->driftSpread = config->driftSpread;
+    c->driftAmount = config->driftAmount;
+    memcpy(c->driftColor, config->driftColor, sizeof(c->driftColor));
+    c->band = config->band;
+    c->shimmer = config->shimmer;
+    c->shimmerPhase = wrapPhase(time * 5.0);
+    c->shimmerRowPhase = wrapPhase(time * 3.0);
+}
+
+// Plain libm implementation of the fragment program's main(), mirroring
+// the GLSL line for line; the SIMD kernels are checked against it.
+static void rasterSpanScalar(const RasterConsts* c, const RasterSpan* s) {
+    for (int i = 0; i < s->count; i++) {
+        float x = s->x0 + s->dx * i;
+
+        float wave = 0.0f;
+        for (int o = 0; o < c->octaves; o++) {
+            wave += sinf(x * c->freqX[o] + s->rowPhase[o]) * c->amplitude[o];
+        }
+        if (s->interactMul) {
+            wave = wave * s->interactMul[i] + s->interactAdd[i];
+        }
+        float waveY = s->y + wave;
+
+        float g = (waveY + 1.0f) * 0.5f;
+        int k = 0;
+        for (int j = 1; j < c->stops - 1; j++) {
+            if (g > c->stopPosition[j]) {
+                k = j;
+            }
+        }
+        float t = (g - c->stopPosition[k]) * c->stopScale[k];
+        float color[3];
+        for (int ch = 0; ch < 3; ch++) {
+            color[ch] = c->stopColor[ch][k] + c->stopDelta[ch][k] * t;
+        }
+
+        if (c->drift) {
+            float drift = sinf(x * c->driftSpread + c->driftPhase) * c->driftAmount + c->driftAmount;
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] += (c->driftColor[ch] - color[ch]) * drift;
+            }
+        }
+        if (c->band) {
+            float u = fabsf(waveY) + 0.5f;
+            if (u > 1.0f) u = 1.0f;
+            float intensity = 1.0f - u * u * (3.0f - 2.0f * u);
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] *= 0.8f + intensity * 0.4f;
+            }
+        }
+        if (c->shimmer) {
+            float shimmer = sinf(x * 20.0f + c->shimmerPhase) * s->shimmerRow;
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] += shimmer;
+            }
+        }
+        if (s->crystalKeep) {
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] = color[ch] * s->crystalKeep[i] + s->crystalAdd[ch][i];
+            }
+        }
+
+        unsigned char* out = s->out + i * 4;
+        for (int ch = 0; ch < 3; ch++) {
+            float v = color[ch];
+            if (!(v > 0.0f)) v = 0.0f;
+            if (v > 1.0f) v = 1.0f;
+            out[ch] = (unsigned char)(int)(v * 255.0f + 0.5f);
+        }
+        out[3] = 255;
+    }
+}
+
+// Lane offsets for the kernels, wide enough for the widest
+static const float rasterLanes[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+#ifdef WK_HAVE_SSE2
+#define VF __m128
+#define VI __m128i
+#define VM __m128
+#define VW 4
+#define V_SET1(a) _mm_set1_ps(a)
+#define V_LOAD(p) _mm_loadu_ps(p)
+#define V_STOREI(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define V_ADD(a, b) _mm_add_ps(a, b)
+#define V_SUB(a, b) _mm_sub_ps(a, b)
+#define V_MUL(a, b) _mm_mul_ps(a, b)
+#define V_MIN(a, b) _mm_min_ps(a, b)
+#define V_MAX(a, b) _mm_max_ps(a, b)
+#define V_ABS(a) _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+#define V_GT(a, b) _mm_cmpgt_ps(a, b)
+#define V_SELECT(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define V_TOINT(a) _mm_cvttps_epi32(a)
+#define V_SIN(a) wkSinSSE2(a)
+#define WR_NAME rasterSpanSSE2
+#define WR_TARGET
+#include "wave_raster_body.h"
+#endif
+
+#ifdef WK_HAVE_AVX2
+#define VF __m256
+#define VI __m256i
+#define VM __m256
+#define VW 8
+#define V_SET1(a) _mm256_set1_ps(a)
+#define V_LOAD(p) _mm256_loadu_ps(p)
+#define V_STOREI(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define V_ADD(a, b) _mm256_add_ps(a, b)
+#define V_SUB(a, b) _mm256_sub_ps(a, b)
+#define V_MUL(a, b) _mm256_mul_ps(a, b)
+#define V_MIN(a, b) _mm256_min_ps(a, b)
+#define V_MAX(a, b) _mm256_max_ps(a, b)
+#define V_ABS(a) _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a)
+#define V_GT(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define V_SELECT(m, a, b) _mm256_blendv_ps(b, a, m)
+#define V_TOINT(a) _mm256_cvttps_epi32(a)
+#define V_SIN(a) wkSinAVX2(a)
+#define WR_NAME rasterSpanAVX2
+#define WR_TARGET __attribute__((target("avx2")))
+#include "wave_raster_body.h"
+#endif
+
+#ifdef WK_HAVE_AVX512
+#define VF __m512
+#define VI __m512i
+#define VM __mmask16
+#define VW 16
+#define V_SET1(a) _mm512_set1_ps(a)
+#define V_LOAD(p) _mm512_loadu_ps(p)
+#define V_STOREI(p, v) _mm512_storeu_si512((void*)(p), v)
+#define V_ADD(a, b) _mm512_add_ps(a, b)
+#define V_SUB(a, b) _mm512_sub_ps(a, b)
+#define V_MUL(a, b) _mm512_mul_ps(a, b)
+#define V_MIN(a, b) _mm512_min_ps(a, b)
+#define V_MAX(a, b) _mm512_max_ps(a, b)
+#define V_ABS(a) _mm512_abs_ps(a)
+#define V_GT(a, b) _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)
+#define V_SELECT(m, a, b) _mm512_mask_blend_ps(m, b, a)
+#define V_TOINT(a) _mm512_cvttps_epi32(a)
+#define V_SIN(a) wkSinAVX512(a)
+#define WR_NAME rasterSpanAVX512
+#define WR_TARGET __attribute__((target("avx512f")))
+#include "wave_raster_body.h"
+#endif
+
+#ifdef WK_HAVE_NEON
+#define VF float32x4_t
+#define VI int32x4_t
+#define VM uint32x4_t
+#define VW 4
+#define V_SET1(a) vdupq_n_f32(a)
+#define V_LOAD(p) vld1q_f32(p)
+#define V_STOREI(p, v) vst1q_s32(p, v)
+#define V_ADD(a, b) vaddq_f32(a, b)
+#define V_SUB(a, b) vsubq_f32(a, b)
+#define V_MUL(a, b) vmulq_f32(a, b)
+#define V_MIN(a, b) vminq_f32(a, b)
+#define V_MAX(a, b) vmaxq_f32(a, b)
+#define V_ABS(a) vabsq_f32(a)
+#define V_GT(a, b) vcgtq_f32(a, b)
+#define V_SELECT(m, a, b) vbslq_f32(m, a, b)
+#define V_TOINT(a) vcvtq_s32_f32(a)
+#define V_SIN(a) wkSinNEON(a)
+#define WR_NAME rasterSpanNEON
+#define WR_TARGET
+#include "wave_raster_body.h"
+#endif
+
+// The interaction events that can reach one tile, oldest first
+typedef struct {
+    const WaveInteractionEvent* events[WAVE_INTERACTION_CAPACITY];
+    int count;
+    int waves;     // any ripple, vortex or freeze zone
+    int crystals;  // any ice crystal
+} RasterEvents;
+
+// Pick out the events whose reach overlaps the tile [x0, x1] x [y0, y1]
+// (view units). Distances are measured with x stretched by the aspect, as
+// the shader does, and every bound is the widest the effect can have.
+static void cullEvents(const WaveInteractionBlock* block, float time, float aspect, float x0, float x1, float y0,
+                       float y1, RasterEvents* out) {
+    out->count = out->waves = out->crystals = 0;
+    int count = block->count < WAVE_INTERACTION_CAPACITY ? block->count : WAVE_INTERACTION_CAPACITY;
+    for (int i = 0; i < count; i++) {
+        const WaveInteractionEvent* ev = &block->events[i];
+        float nx = fmaxf(fmaxf(x0 - ev->x, ev->x - x1), 0.0f) * aspect;
+        float ny = fmaxf(fmaxf(y0 - ev->y, ev->y - y1), 0.0f);
+        float fx = fmaxf(fabsf(x0 - ev->x), fabsf(x1 - ev->x)) * aspect;
+        float fy = fmaxf(fabsf(y0 - ev->y), fabsf(y1 - ev->y));
+        float nearest = sqrtf(nx * nx + ny * ny);
+        float farthest = sqrtf(fx * fx + fy * fy);
+
+        int reaches = 0;
+        switch (ev->type) {
+            case WAVE_INTERACTION_RIPPLE: {
+                // The rings sit from 0.3 to 3 times elapsed out, less up
+                // to 1, and reach 0.3 either side
+                float elapsed = time - ev->startTime;
+                reaches = nearest < elapsed * 3.0f + 0.3f && farthest > elapsed * 0.3f - 1.3f;
+                break;
+            }
+            case WAVE_INTERACTION_VORTEX:
+                reaches = nearest < 1.0f;
+                break;
+            case WAVE_INTERACTION_FREEZE:
+                reaches = nearest < 0.5f;
+                break;
+            case WAVE_INTERACTION_CRYSTAL:
+                reaches = nearest < 0.4f * ev->strength;
+                break;
+        }
+        if (!reaches) {
+            continue;
+        }
+        out->events[out->count++] = ev;
+        if (ev->type == WAVE_INTERACTION_CRYSTAL) {
+            out->crystals = 1;
+        } else {
+            out->waves = 1;
+        }
+    }
+}
+
+// The shader's interact(), as the factor and offset it applies to the wave
+// height at (px, py)
+static void interactTerms(const RasterEvents* e, float time, float aspect, float px, float py, float* mulOut,
+                          float* addOut) {
+    float freezeStrength = 0.0f;
+    float add = 0.0f;
+    for (int i = 0; i < e->count; i++) {
+        const WaveInteractionEvent* ev = e->events[i];
+        if (ev->type != WAVE_INTERACTION_FREEZE) {
+            continue;
+        }
+        float dx = (px - ev->x) * aspect, dy = py - ev->y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        if (dist < 0.5f) {
+            float strength = (1.0f - dist / 0.5f) * ev->strength;
+            // Crystalline patterns
+            add += sinf(px * 30.0f) * cosf(dy * 30.0f) * strength * 0.05f;
+            freezeStrength = fmaxf(freezeStrength, strength);
+        }
+    }
+    float freezeFactor = 1.0f - freezeStrength * 0.9f;
+    float mul = 1.0f;
+
+    for (int i = 0; i < e->count; i++) {
+        const WaveInteractionEvent* ev = e->events[i];
+        float dx = (px - ev->x) * aspect, dy = py - ev->y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        float elapsed = time - ev->startTime;
+
+        if (ev->type == WAVE_INTERACTION_RIPPLE) {
+            // Multiple ripple rings, slowed by freeze
+            float radius = elapsed * 3.0f * freezeFactor;
+            for (int r = 0; r < 3; r++) {
+                float ringDist = fabsf(dist - (radius - r * 0.5f));
+                if (ringDist < 0.3f) {
+                    float ringStrength = (1.0f - ringDist / 0.3f) * ev->strength;
+                    add += sinf(dist * 10.0f - time * 5.0f * freezeFactor) * ringStrength * 0.3f * freezeFactor;
+                }
+            }
+        } else if (ev->type == WAVE_INTERACTION_VORTEX && dist < 1.0f) {
+            float vortexStrength = (1.0f - dist) * 0.5f * freezeFactor;
+            float angle = atan2f(dy, dx);
+
+            add += sinf(angle * 5.0f + time * 10.0f * freezeFactor - dist * 20.0f) * vortexStrength;
+            add -= dist * vortexStrength * 0.3f;
+            add += sinf(px * 50.0f + time * 20.0f * freezeFactor) * cosf(dy * 50.0f) * vortexStrength * 0.2f;
+
+            float pulse = 1.0f + sinf(time * 15.0f * freezeFactor) * vortexStrength * 0.3f;
+            mul *= pulse;
+            add *= pulse;
+        }
+    }
+    *mulOut = mul;
+    *addOut = add;
+}
+
+// The shader's iceCrystals(), folded into one blend per pixel: every
+// crystal mixes toward its ice colour in turn, so the result is the
+// incoming colour times keep plus add
+static void crystalTerms(const RasterEvents* e, float time, float aspect, float px, float py, float* keepOut,
+                         float addOut[3]) {
+    float keep = 1.0f;
+    float add[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < e->count; i++) {
+        const WaveInteractionEvent* ev = e->events[i];
+        if (ev->type != WAVE_INTERACTION_CRYSTAL) {
+            continue;
+        }
+        float growth = ev->strength;
+        float dx = (px - ev->x) * aspect / growth, dy = (py - ev->y) / growth;
+        if (dx * dx + dy * dy > 0.16f) {
+            continue;
+        }
+
+        // Undo the spin and fold every branch onto the one along +x
+        const float sector = 1.0471976f;
+        float angle = atan2f(dy, dx) - time * 0.5f;
+        angle -= sector * floorf(angle / sector + 0.5f);
+        float length = sqrtf(dx * dx + dy * dy);
+        float qx = cosf(angle) * length, qy = fabsf(sinf(angle)) * length;
+
+        float alpha = 0.0f;
+        float ice[3] = {0.7f, 0.9f, 1.0f};
+        float along = fminf(fmaxf(qx, 0.0f), 0.36f);
+        float seg = along / 0.04f;
+        float size = 0.02f - seg * 0.001f;
+        float edge = sqrtf((qx - along) * (qx - along) + qy * qy) / size;
+        if (edge < 1.0f) {
+            alpha = (0.8f + (0.3f - 0.8f) * edge) * (1.0f - seg / 10.0f);
+            ice[0] = 0.7f + (0.5f - 0.7f) * edge;
+            ice[1] = 0.9f + (0.8f - 0.9f) * edge;
+            ice[2] = 1.0f;
+        }
+
+        for (int s = 4; s <= 8; s += 2) {
+            float sx = qx - s * 0.04f, sy = qy;
+            float branch = fminf(fmaxf(sx * 0.8660254f + sy * 0.5f, 0.0f), 0.08f);
+            float bx = sx - 0.8660254f * branch, by = sy - 0.5f * branch;
+            float subAlpha = (1.0f - s / 10.0f) * (1.0f - branch / 0.1f) * 0.6f;
+            if (sqrtf(bx * bx + by * by) < 0.008f && subAlpha > alpha) {
+                alpha = subAlpha;
+                ice[0] = 0.8f;
+                ice[1] = 0.95f;
+                ice[2] = 1.0f;
+            }
+        }
+
+        float w = alpha * growth;
+        keep *= 1.0f - w;
+        for (int ch = 0; ch < 3; ch++) {
+            add[ch] = add[ch] * (1.0f - w) + ice[ch] * w;
+        }
+    }
+    *keepOut = keep;
+    memcpy(addOut, add, sizeof(add));
+}
+
+typedef struct {
+    const WaveRasterKernel* kernel;
+    const RasterConsts* consts;
+    const WaveRasterFrame* frame;
+    int interaction;
+    unsigned char* rgba;
+    int width, height;
+    int tilesX;
+} RasterJob;
+
+static void rasterTile(void* ctx, int job) {
+    const RasterJob* r = ctx;
+    const RasterConsts* c = r->consts;
+    const WaveRasterFrame* frame = r->frame;
+    int tileX = (job % r->tilesX) * WAVE_RASTER_TILE_SIZE;
+    int tileY = (job / r->tilesX) * WAVE_RASTER_TILE_SIZE;
+    int w = r->width - tileX < WAVE_RASTER_TILE_SIZE ? r->width - tileX : WAVE_RASTER_TILE_SIZE;
+    int h = r->height - tileY < WAVE_RASTER_TILE_SIZE ? r->height - tileY : WAVE_RASTER_TILE_SIZE;
+
+    // Pixel centres in view units; the top row of the image is the top of
+    // the view
+    float dx = 2.0f / r->width * frame->zoom;
+    float dy = 2.0f / r->height * frame->zoom;
+    float x0 = ((tileX + 0.5f) * 2.0f / r->width - 1.0f) * frame->zoom;
+    float yTop = (1.0f - (tileY + 0.5f) * 2.0f / r->height) * frame->zoom;
+
+    RasterEvents events;
+    events.count = events.waves = events.crystals = 0;
+    if (r->interaction) {
+        cullEvents(frame->interactions, c->time, frame->aspect, x0, x0 + dx * (w - 1), yTop - dy * (h - 1), yTop,
+                   &events);
+    }
+    float interactMul[WAVE_RASTER_TILE_SIZE], interactAdd[WAVE_RASTER_TILE_SIZE];
+    float crystalKeep[WAVE_RASTER_TILE_SIZE], crystalAdd[3][WAVE_RASTER_TILE_SIZE];
+
+    RasterSpan span;
+    memset(&span, 0, sizeof(span));
+    span.x0 = x0;
+    span.dx = dx;
+    span.count = w;
+    if (events.waves) {
+        span.interactMul = interactMul;
+        span.interactAdd = interactAdd;
+    }
+    if (events.crystals) {
+        span.crystalKeep = crystalKeep;
+        for (int ch = 0; ch < 3; ch++) {
+            span.crystalAdd[ch] = crystalAdd[ch];
+        }
+    }
+
+    for (int row = 0; row < h; row++) {
+        float y = yTop - dy * row;
+        span.y = y;
+        for (int o = 0; o < c->octaves; o++) {
+            span.rowPhase[o] = c->freqY[o] * y + c->timePhase[o];
+        }
+        span.shimmerRow = sinf(y * 20.0f - c->shimmerRowPhase) * 0.05f;
+
+        for (int i = 0; events.count > 0 && i < w; i++) {
+            float x = x0 + dx * i;
+            if (events.waves) {
+                interactTerms(&events, c->time, frame->aspect, x, y, &interactMul[i], &interactAdd[i]);
+            }
+            if (events.crystals) {
+                float add[3];
+                crystalTerms(&events, c->time, frame->aspect, x, y, &crystalKeep[i], add);
+                for (int ch = 0; ch < 3; ch++) {
+                    crystalAdd[ch][i] = add[ch];
+                }
+            }
+        }
+
+        span.out = r->rgba + ((size_t)(tileY + row) * r->width + tileX) * 4;
+        r->kernel->span(c, &span);
+    }
+}
+
+int waveRasterRender(const WaveRasterKernel* kernel, const WaveShaderConfig* config, const WaveRasterFrame* frame,
+                     unsigned char* rgba, int width, int height) {
+    if (config->octaveCount < 0 || config->octaveCount > WAVE_SHADER_MAX_OCTAVES || config->stopCount < 2 ||
+        config->stopCount > WAVE_SHADER_MAX_STOPS || config->displaceVertices || width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    RasterConsts consts;
+    rasterSetup(config, frame, &consts);
+
+    RasterJob job;
+    job.kernel = kernel;
+    job.consts = &consts;
+    job.frame = frame;
+    job.interaction = config->interaction && frame->interactions && frame->interactions->count > 0;
+    job.rgba = rgba;
+    job.width = width;
+    job.height = height;
+    job.tilesX = (width + WAVE_RASTER_TILE_SIZE - 1) / WAVE_RASTER_TILE_SIZE;
+    int tilesY = (height + WAVE_RASTER_TILE_SIZE - 1) / WAVE_RASTER_TILE_SIZE;
+
+    workerPoolRun(rasterTile, &job, job.tilesX * tilesY);
+    return 1;
+}
+
+static int kernelSupported(const char* name) {
+#ifdef WK_HAVE_AVX2
+    if (strcmp(name, "avx2") == 0) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+#ifdef WK_HAVE_AVX512
+    if (strcmp(name, "avx512") == 0) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+    }
+#endif
+    (void)name;
+    return 1;
+}
+
+// Widest first, so "auto" picks the first supported entry
+static const WaveRasterKernel rasterKernels[] = {
+#ifdef WK_HAVE_AVX512
+    {"avx512", rasterSpanAVX512},
+#endif
+#ifdef WK_HAVE_AVX2
+    {"avx2", rasterSpanAVX2},
+#endif
+#ifdef WK_HAVE_NEON
+    {"neon", rasterSpanNEON},
+#endif
+#ifdef WK_HAVE_SSE2
+    {"sse2", rasterSpanSSE2},
+#endif
+    {"scalar", rasterSpanScalar},
+};
+
+const WaveRasterKernel* waveRasterSelect(const char* name) {
+    int autoSelect = (name == NULL || strcmp(name, "auto") == 0);
+    for (size_t i = 0; i < sizeof(rasterKernels) / sizeof(rasterKernels[0]); i++) {
+        const WaveRasterKernel* k = &rasterKernels[i];
+        if ((autoSelect || strcmp(name, k->name) == 0) && kernelSupported(k->name)) {
+            return k;
+        }
+    }
+    return NULL;
+}
+
+const char* waveRasterKernelName(const WaveRasterKernel* kernel) {
+    return kernel->name;
+}
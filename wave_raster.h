@@ -0,0 +1,46 @@
+#ifndef WAVE_RASTER_H
+#define WAVE_RASTER_H
+
+// CPU renderer for the full-screen wave shader (wave_shader.h), with no
+// OpenGL at all: the fragment program of main.c and main_waves.c, evaluated
+// into an RGBA buffer. It serves machines without a GL stack and is a
+// reference to diff and benchmark the GPU output against.
+//
+// The image is cut into square tiles that run as jobs on the worker pool
+// (worker_pool.h), so start the pool first to use more than one core. Each
+// tile is shaded row by row with the widest SIMD kernel the processor has,
+// 16 pixels at a time with AVX-512 and 8 with AVX2. The interaction events
+// are culled per tile, and only the pixels of tiles some event reaches work
+// out their terms, one pixel at a time.
+
+#include "wave_interaction.h"
+#include "wave_shader.h"
+
+// 64x64 RGBA pixels make 16 KB, so a tile stays in L1 while it is shaded
+#define WAVE_RASTER_TILE_SIZE 64
+
+typedef struct {
+    float time;
+    float zoom;    // the shader's zoom uniform
+    float aspect;  // width / height, as the interaction terms see it
+
+    // The live events, as waveInteractionsUpdate() leaves them; NULL for
+    // none. Ignored unless the configuration has interaction.
+    const WaveInteractionBlock* interactions;
+} WaveRasterFrame;
+
+typedef struct WaveRasterKernel WaveRasterKernel;
+
+// Look up a kernel by name ("scalar", "sse2", "avx2", "avx512", "neon").
+// NULL or "auto" picks the widest one this CPU supports. Returns NULL if
+// the requested kernel is unknown or not available on this machine.
+const WaveRasterKernel* waveRasterSelect(const char* name);
+const char* waveRasterKernelName(const WaveRasterKernel* kernel);
+
+// Shade one frame into rgba: width * height pixels of 4 bytes, top row
+// first, alpha 255. Returns 0 for configurations the CPU cannot draw: out
+// of range tables, or displaceVertices, which needs the rasteriser.
+int waveRasterRender(const WaveRasterKernel* kernel, const WaveShaderConfig* config, const WaveRasterFrame* frame,
+                     unsigned char* rgba, int width, int height);
+
+#endif
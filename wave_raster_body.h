@@ -0,0 +1,126 @@
+// SIMD body of the wave raster span shader.
+//
+// wave_raster.c includes this once per instruction set after defining the
+// V_* vector macros, VF/VI/VM/VW, WR_NAME and WR_TARGET. It follows
+// rasterSpanScalar() step for step, VW pixels of the row at a time, and
+// leaves the ragged end of the span to the scalar reference. All macros are
+// undefined at the end so the next ISA can redefine them.
+
+WR_TARGET static void WR_NAME(const RasterConsts* c, const RasterSpan* s) {
+    const VF zero = V_SET1(0.0f);
+    const VF one = V_SET1(1.0f);
+    const VF lanes = V_LOAD(rasterLanes);
+    int i = 0;
+
+    for (; i + VW <= s->count; i += VW) {
+        VF x = V_ADD(V_SET1(s->x0 + s->dx * i), V_MUL(lanes, V_SET1(s->dx)));
+
+        VF wave = zero;
+        for (int o = 0; o < c->octaves; o++) {
+            VF phase = V_ADD(V_MUL(x, V_SET1(c->freqX[o])), V_SET1(s->rowPhase[o]));
+            wave = V_ADD(wave, V_MUL(V_SIN(phase), V_SET1(c->amplitude[o])));
+        }
+        if (s->interactMul) {
+            wave = V_ADD(V_MUL(wave, V_LOAD(s->interactMul + i)), V_LOAD(s->interactAdd + i));
+        }
+        VF waveY = V_ADD(V_SET1(s->y), wave);
+
+        // Palette: the first segment, then each later one past its start
+        VF g = V_MUL(V_ADD(waveY, one), V_SET1(0.5f));
+        VF t = V_MUL(V_SUB(g, V_SET1(c->stopPosition[0])), V_SET1(c->stopScale[0]));
+        VF color[3];
+        for (int ch = 0; ch < 3; ch++) {
+            color[ch] = V_ADD(V_SET1(c->stopColor[ch][0]), V_MUL(V_SET1(c->stopDelta[ch][0]), t));
+        }
+        for (int k = 1; k < c->stops - 1; k++) {
+            VM past = V_GT(g, V_SET1(c->stopPosition[k]));
+            t = V_MUL(V_SUB(g, V_SET1(c->stopPosition[k])), V_SET1(c->stopScale[k]));
+            for (int ch = 0; ch < 3; ch++) {
+                VF segment = V_ADD(V_SET1(c->stopColor[ch][k]), V_MUL(V_SET1(c->stopDelta[ch][k]), t));
+                color[ch] = V_SELECT(past, segment, color[ch]);
+            }
+        }
+
+        if (c->drift) {
+            VF phase = V_ADD(V_MUL(x, V_SET1(c->driftSpread)), V_SET1(c->driftPhase));
+            VF drift = V_ADD(V_MUL(V_SIN(phase), V_SET1(c->driftAmount)), V_SET1(c->driftAmount));
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] = V_ADD(color[ch], V_MUL(V_SUB(V_SET1(c->driftColor[ch]), color[ch]), drift));
+            }
+        }
+        if (c->band) {
+            // 1 - smoothstep(-0.5, 0.5, |waveY|)
+            VF u = V_MIN(V_ADD(V_ABS(waveY), V_SET1(0.5f)), one);
+            VF intensity = V_SUB(one, V_MUL(V_MUL(u, u), V_SUB(V_SET1(3.0f), V_ADD(u, u))));
+            VF scale = V_ADD(V_SET1(0.8f), V_MUL(intensity, V_SET1(0.4f)));
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] = V_MUL(color[ch], scale);
+            }
+        }
+        if (c->shimmer) {
+            VF phase = V_ADD(V_MUL(x, V_SET1(20.0f)), V_SET1(c->shimmerPhase));
+            VF shimmer = V_MUL(V_SIN(phase), V_SET1(s->shimmerRow));
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] = V_ADD(color[ch], shimmer);
+            }
+        }
+        if (s->crystalKeep) {
+            VF keep = V_LOAD(s->crystalKeep + i);
+            for (int ch = 0; ch < 3; ch++) {
+                color[ch] = V_ADD(V_MUL(color[ch], keep), V_LOAD(s->crystalAdd[ch] + i));
+            }
+        }
+
+        // Clamp and round to bytes the way the framebuffer does
+        int bytes[3][VW];
+        for (int ch = 0; ch < 3; ch++) {
+            VF v = V_MIN(V_MAX(color[ch], zero), one);
+            V_STOREI(bytes[ch], V_TOINT(V_ADD(V_MUL(v, V_SET1(255.0f)), V_SET1(0.5f))));
+        }
+        unsigned char* out = s->out + i * 4;
+        for (int lane = 0; lane < VW; lane++) {
+            out[lane * 4 + 0] = (unsigned char)bytes[0][lane];
+            out[lane * 4 + 1] = (unsigned char)bytes[1][lane];
+            out[lane * 4 + 2] = (unsigned char)bytes[2][lane];
+            out[lane * 4 + 3] = 255;
+        }
+    }
+
+    if (i < s->count) {
+        RasterSpan tail = *s;
+        tail.x0 = s->x0 + s->dx * i;
+        tail.count = s->count - i;
+        if (tail.interactMul) {
+            tail.interactMul += i;
+            tail.interactAdd += i;
+        }
+        if (tail.crystalKeep) {
+            tail.crystalKeep += i;
+            for (int ch = 0; ch < 3; ch++) {
+                tail.crystalAdd[ch] += i;
+            }
+        }
+        tail.out += i * 4;
+        rasterSpanScalar(c, &tail);
+    }
+}
+
+#undef VF
+#undef VI
+#undef VM
+#undef VW
+#undef V_SET1
+#undef V_LOAD
+#undef V_STOREI
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_MIN
+#undef V_MAX
+#undef V_ABS
+#undef V_GT
+#undef V_SELECT
+#undef V_TOINT
+#undef V_SIN
+#undef WR_NAME
+#undef WR_TARGET
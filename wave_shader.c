@@ -0,0 +1,319 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "wave_interaction.h"
+#include "wave_shader.h"
+
+// The shared body. Everything a configuration decides arrives through the
+// preamble: the stage, the table sizes and contents, and the effect
+// switches. Loops run to compile-time constants over constant arrays, so
+// the compiler unrolls and folds them into straight-line code.
+static const char* const waveShaderBody =
+    "uniform float time;\n"
+    "uniform float zoom;\n"
+    "\n"
+    "#if WAVE_OCTAVES > 0\n"
+    "const vec3 octaveWaves[WAVE_OCTAVES] = WAVE_OCTAVE_WAVES;    // freqX, freqY, speed\n"
+    "const vec2 octaveShapes[WAVE_OCTAVES] = WAVE_OCTAVE_SHAPES;  // phase, amplitude\n"
+    "#endif\n"
+    "\n"
+    "float waveHeight(vec2 p) {\n"
+    "    float height = 0.0;\n"
+    "#if WAVE_OCTAVES > 0\n"
+    "    for (int i = 0; i < WAVE_OCTAVES; i++) {\n"
+    "        vec3 w = octaveWaves[i];\n"
+    "        height += octaveShapes[i].y * sin(w.x * p.x + w.y * p.y + w.z * time + octaveShapes[i].x);\n"
+    "    }\n"
+    "#endif\n"
+    "    return height;\n"
+    "}\n"
+    "\n"
+    "#ifdef WAVE_VERTEX_STAGE\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "out vec2 wavePos;\n"
+    "\n"
+    "void main() {\n"
+    "    vec2 pos = aPos.xy;\n"
+    "#if WAVE_DISPLACE\n"
+    "    pos.y += waveHeight(pos);\n"
+    "#endif\n"
+    "    gl_Position = vec4(pos, aPos.z, 1.0);\n"
+    "    wavePos = pos * zoom;\n"
+    "}\n"
+    "#else\n"
+    "in vec2 wavePos;\n"
+    "out vec4 FragColor;\n"
+    "\n"
+    "const vec4 paletteStops[WAVE_STOPS] = WAVE_PALETTE;  // rgb, position\n"
+    "\n"
+    "#if WAVE_INTERACTION\n"
+    "struct Interaction {\n"
+    "    vec2 position;\n"
+    "    float startTime;\n"
+    "    float strength;\n"
+    "    int type;\n"
+    "};\n"
+    "layout (std140) uniform Interactions {\n"
+    "    int interactionCount;\n"
+    "    Interaction interactions[WAVE_INTERACTION_CAPACITY];\n"
+    "};\n"
+    "uniform float aspect;\n"
+    "\n"
+    "// Offset from an event, with x stretched to the screen's proportions so\n"
+    "// rings come out round\n"
+    "vec2 interactionOffset(vec2 p, Interaction ev) {\n"
+    "    return vec2((p.x - ev.position.x) * aspect, p.y - ev.position.y);\n"
+    "}\n"
+    "\n"
+    "// The waves.c interaction terms, per pixel: freeze zones first, the\n"
+    "// strongest setting the freeze factor, then ripples and vortices oldest\n"
+    "// first\n"
+    "float interact(vec2 p, float wave) {\n"
+    "    float freezeStrength = 0.0;\n"
+    "    float add = 0.0;\n"
+    "    for (int i = 0; i < interactionCount; i++) {\n"
+    "        if (interactions[i].type != WAVE_INTERACTION_FREEZE) {\n"
+    "            continue;\n"
+    "        }\n"
+    "        vec2 d = interactionOffset(p, interactions[i]);\n"
+    "        float dist = length(d);\n"
+    "        if (dist < 0.5) {\n"
+    "            float strength = (1.0 - dist / 0.5) * interactions[i].strength;\n"
+    "            // Crystalline patterns\n"
+    "            add += sin(p.x * 30.0) * cos(d.y * 30.0) * strength * 0.05;\n"
+    "            freezeStrength = max(freezeStrength, strength);\n"
+    "        }\n"
+    "    }\n"
+    "    float freezeFactor = 1.0 - freezeStrength * 0.9;\n"
+    "    float mul = 1.0;\n"
+    "\n"
+    "    for (int i = 0; i < interactionCount; i++) {\n"
+    "        Interaction ev = interactions[i];\n"
+    "        vec2 d = interactionOffset(p, ev);\n"
+    "        float dist = length(d);\n"
+    "        float elapsed = time - ev.startTime;\n"
+    "\n"
+    "        if (ev.type == WAVE_INTERACTION_RIPPLE) {\n"
+    "            // Multiple ripple rings, slowed by freeze\n"
+    "            float radius = elapsed * 3.0 * freezeFactor;\n"
+    "            for (int r = 0; r < 3; r++) {\n"
+    "                float ringDist = abs(dist - (radius - float(r) * 0.5));\n"
+    "                if (ringDist < 0.3) {\n"
+    "                    float ringStrength = (1.0 - ringDist / 0.3) * ev.strength;\n"
+    "                    add += sin(dist * 10.0 - time * 5.0 * freezeFactor) * ringStrength * 0.3 * freezeFactor;\n"
+    "                }\n"
+    "            }\n"
+    "        } else if (ev.type == WAVE_INTERACTION_VORTEX && dist < 1.0) {\n"
+    "            float vortexStrength = (1.0 - dist) * 0.5 * freezeFactor;\n"
+    "            float angle = atan(d.y, d.x);\n"
+    "\n"
+    "            // Swirl, pull toward the centre and turbulence add to the height...\n"
+    "            add += sin(angle * 5.0 + time * 10.0 * freezeFactor - dist * 20.0) * vortexStrength;\n"
+    "            add -= dist * vortexStrength * 0.3;\n"
+    "            add += sin(p.x * 50.0 + time * 20.0 * freezeFactor) * cos(d.y * 50.0) * vortexStrength * 0.2;\n"
+    "\n"
+    "            // ...and the pulse scales everything accumulated so far\n"
+    "            float pulse = 1.0 + sin(time * 15.0 * freezeFactor) * vortexStrength * 0.3;\n"
+    "            mul *= pulse;\n"
+    "            add *= pulse;\n"
+    "        }\n"
+    "    }\n"
+    "    return wave * mul + add;\n"
+    "}\n"
+    "\n"
+    "// The six-branched ice crystal, spinning, shrinking and fading with its\n"
+    "// strength. Each branch is a line of blobs that shrink and fade outward,\n"
+    "// with side branches at 30 degrees from the 4th, 6th and 8th.\n"
+    "vec3 iceCrystals(vec2 p, vec3 color) {\n"
+    "    for (int i = 0; i < interactionCount; i++) {\n"
+    "        Interaction ev = interactions[i];\n"
+    "        if (ev.type != WAVE_INTERACTION_CRYSTAL) {\n"
+    "            continue;\n"
+    "        }\n"
+    "        float growth = ev.strength;\n"
+    "        vec2 d = interactionOffset(p, ev) / growth;\n"
+    "        if (dot(d, d) > 0.16) {\n"
+    "            continue;\n"
+    "        }\n"
+    "\n"
+    "        // Undo the spin and fold every branch onto the one along +x\n"
+    "        float sector = 1.0471976;\n"
+    "        float angle = atan(d.y, d.x) - time * 0.5;\n"
+    "        angle -= sector * floor(angle / sector + 0.5);\n"
+    "        vec2 q = vec2(cos(angle), abs(sin(angle))) * length(d);\n"
+    "\n"
+    "        float alpha = 0.0;\n"
+    "        vec3 ice = vec3(0.7, 0.9, 1.0);\n"
+    "        float seg = clamp(q.x, 0.0, 0.36) / 0.04;\n"
+    "        float size = 0.02 - seg * 0.001;\n"
+    "        float edge = length(vec2(q.x - clamp(q.x, 0.0, 0.36), q.y)) / size;\n"
+    "        if (edge < 1.0) {\n"
+    "            alpha = mix(0.8, 0.3, edge) * (1.0 - seg / 10.0);\n"
+    "            ice = mix(vec3(0.7, 0.9, 1.0), vec3(0.5, 0.8, 1.0), edge);\n"
+    "        }\n"
+    "\n"
+    "        for (int s = 4; s <= 8; s += 2) {\n"
+    "            vec2 start = vec2(float(s) * 0.04, 0.0);\n"
+    "            float along = clamp(dot(q - start, vec2(0.8660254, 0.5)), 0.0, 0.08);\n"
+    "            float dist = length(q - start - vec2(0.8660254, 0.5) * along);\n"
+    "            float subAlpha = (1.0 - float(s) / 10.0) * (1.0 - along / 0.1) * 0.6;\n"
+    "            if (dist < 0.008 && subAlpha > alpha) {\n"
+    "                alpha = subAlpha;\n"
+    "                ice = vec3(0.8, 0.95, 1.0);\n"
+    "            }\n"
+    "        }\n"
+    "        color = mix(color, ice, alpha * growth);\n"
+    "    }\n"
+    "    return color;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "// Piecewise linear, carrying on along the end segments past the ends\n"
+    "vec3 paletteColor(float g) {\n"
+    "    vec3 color = mix(paletteStops[0].rgb, paletteStops[1].rgb,\n"
+    "                     (g - paletteStops[0].a) / (paletteStops[1].a - paletteStops[0].a));\n"
+    "    for (int i = 1; i < WAVE_STOPS - 1; i++) {\n"
+    "        if (g > paletteStops[i].a) {\n"
+    "            color = mix(paletteStops[i].rgb, paletteStops[i + 1].rgb,\n"
+    "                        (g - paletteStops[i].a) / (paletteStops[i + 1].a - paletteStops[i].a));\n"
+    "        }\n"
+    "    }\n"
+    "    return color;\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "    vec2 pos = wavePos;\n"
+    "    float waveY = pos.y;\n"
+    "#if !WAVE_DISPLACE\n"
+    "    float wave = waveHeight(pos);\n"
+    "#if WAVE_INTERACTION\n"
+    "    wave = interact(pos, wave);\n"
+    "#endif\n"
+    "    waveY += wave;\n"
+    "#endif\n"
+    "    vec3 color = paletteColor((waveY + 1.0) * 0.5);\n"
+    "\n"
+    "#if WAVE_DRIFT\n"
+    "    float drift = sin(time * 0.3 + pos.x * WAVE_DRIFT_SPREAD) * WAVE_DRIFT_AMOUNT + WAVE_DRIFT_AMOUNT;\n"
+    "    color = mix(color, WAVE_DRIFT_COLOR, drift);\n"
+    "#endif\n"
+    "#if WAVE_BAND\n"
+    "    float intensity = 1.0 - smoothstep(-0.5, 0.5, abs(waveY));\n"
+    "    color = mix(color * 0.8, color * 1.2, intensity);\n"
+    "#endif\n"
+    "#if WAVE_SHIMMER\n"
+    "    color += sin(pos.x * 20.0 + time * 5.0) * sin(pos.y * 20.0 - time * 3.0) * 0.05;\n"
+    "#endif\n"
+    "#if WAVE_INTERACTION\n"
+    "    color = iceCrystals(pos, color);\n"
+    "#endif\n"
+    "\n"
+    "    FragColor = vec4(color, 1.0);\n"
+    "}\n"
+    "#endif\n";
+
+typedef struct {
+    char* out;
+    size_t size, used;
+    int overflow;
+} SourceBuilder;
+
+static void append(SourceBuilder* b, const char* format, ...) {
+    if (b->overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(b->out + b->used, b->size - b->used, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= b->size - b->used) {
+        b->overflow = 1;
+        return;
+    }
+    b->used += n;
+}
+
+// GLSL wants a decimal point to read a literal as a float
+static void appendFloat(SourceBuilder* b, float value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.7g", value);
+    append(b, strpbrk(text, ".eEn") ? "%s" : "%s.0", text);
+}
+
+static void appendVector(SourceBuilder* b, int count, const float* values) {
+    append(b, "vec%d(", count);
+    for (int i = 0; i < count; i++) {
+        appendFloat(b, values[i]);
+        append(b, i + 1 < count ? ", " : ")");
+    }
+}
+
+int waveShaderSource(const WaveShaderConfig* config, WaveShaderStage stage, char* out, size_t size) {
+    if (config->octaveCount < 0 || config->octaveCount > WAVE_SHADER_MAX_OCTAVES || config->stopCount < 2 ||
+        config->stopCount > WAVE_SHADER_MAX_STOPS || (config->interaction && config->displaceVertices) || size == 0) {
+        return 0;
+    }
+    SourceBuilder b = {out, size, 0, 0};
+
+    append(&b, "#version 330 core\n");
+    if (stage == WAVE_SHADER_VERTEX) {
+        append(&b, "#define WAVE_VERTEX_STAGE 1\n");
+    }
+    append(&b, "#define WAVE_DISPLACE %d\n", config->displaceVertices != 0);
+
+    append(&b, "#define WAVE_OCTAVES %d\n", config->octaveCount);
+    if (config->octaveCount > 0) {
+        append(&b, "#define WAVE_OCTAVE_WAVES vec3[](");
+        for (int i = 0; i < config->octaveCount; i++) {
+            const WaveOctave* o = &config->octaves[i];
+            float wave[3] = {o->freqX, o->freqY, o->speed};
+            appendVector(&b, 3, wave);
+            append(&b, i + 1 < config->octaveCount ? ", " : ")\n");
+        }
+        append(&b, "#define WAVE_OCTAVE_SHAPES vec2[](");
+        for (int i = 0; i < config->octaveCount; i++) {
+            const WaveOctave* o = &config->octaves[i];
+            float shape[2] = {o->phase, o->amplitude};
+            appendVector(&b, 2, shape);
+            append(&b, i + 1 < config->octaveCount ? ", " : ")\n");
+        }
+    }
+
+    // Only the fragment stage colours anything
+    if (stage == WAVE_SHADER_FRAGMENT) {
+        append(&b, "#define WAVE_STOPS %d\n", config->stopCount);
+        append(&b, "#define WAVE_PALETTE vec4[](");
+        for (int i = 0; i < config->stopCount; i++) {
+            const WaveStop* s = &config->stops[i];
+            float stop[4] = {s->r, s->g, s->b, s->position};
+            appendVector(&b, 4, stop);
+            append(&b, i + 1 < config->stopCount ? ", " : ")\n");
+        }
+
+        append(&b, "#define WAVE_DRIFT %d\n", config->drift != 0);
+        if (config->drift) {
+            append(&b, "#define WAVE_DRIFT_COLOR ");
+            appendVector(&b, 3, config->driftColor);
+            append(&b, "\n#define WAVE_DRIFT_AMOUNT ");
+            appendFloat(&b, config->driftAmount);
+            append(&b, "\n#define WAVE_DRIFT_SPREAD ");
+            appendFloat(&b, config->driftSpread);
+            append(&b, "\n");
+        }
+        append(&b, "#define WAVE_BAND %d\n", config->band != 0);
+        append(&b, "#define WAVE_SHIMMER %d\n", config->shimmer != 0);
+
+        append(&b, "#define WAVE_INTERACTION %d\n", config->interaction != 0);
+        if (config->interaction) {
+            append(&b, "#define WAVE_INTERACTION_CAPACITY %d\n", WAVE_INTERACTION_CAPACITY);
+            append(&b, "#define WAVE_INTERACTION_RIPPLE %d\n", WAVE_INTERACTION_RIPPLE);
+            append(&b, "#define WAVE_INTERACTION_VORTEX %d\n", WAVE_INTERACTION_VORTEX);
+            append(&b, "#define WAVE_INTERACTION_FREEZE %d\n", WAVE_INTERACTION_FREEZE);
+            append(&b, "#define WAVE_INTERACTION_CRYSTAL %d\n", WAVE_INTERACTION_CRYSTAL);
+        }
+    }
+
+    append(&b, "%s", waveShaderBody);
+    return !b.overflow;
+}
@@ -0,0 +1,69 @@
+#ifndef WAVE_SHADER_H
+#define WAVE_SHADER_H
+
+#include <stddef.h>
+
+// The full-screen wave shader shared by main.c, main_waves.c and capture.c.
+// There is one GLSL source for both stages. Each program describes its
+// variant in a WaveShaderConfig, and waveShaderSource turns that into a
+// #define preamble in front of the shared body. The octave and palette
+// tables become constant arrays in loops with constant bounds, and switched
+// off effects are preprocessed away. The driver therefore compiles a
+// specialised program per configuration, and features a program does not
+// use cost it nothing at run time.
+//
+// The surface height at a point p is the sum over the octaves of
+//   amplitude * sin(freqX * p.x + freqY * p.y + speed * time + phase)
+// and is added to p.y, either per fragment or, with displaceVertices, to
+// the geometry in the vertex stage. (y + 1) / 2 then picks the colour from
+// the palette, a piecewise-linear ramp through the stops that carries on
+// along the first and last segments beyond them. Optional effects:
+//
+//   drift    mixes toward driftColor by
+//            (sin(0.3 time + driftSpread p.x) + 1) * driftAmount
+//   band     brightens near y = 0 and darkens away from it
+//   shimmer  adds a fine moving sparkle
+//   interaction  ripples, vortices, freeze zones and ice crystals from the
+//            Interactions uniform block (see wave_interaction.h), which
+//            also needs the aspect uniform
+//
+// Both stages use the uniforms time and zoom (view coordinates are scaled
+// by zoom), and the vertex stage reads positions from attribute 0.
+
+#define WAVE_SHADER_MAX_OCTAVES 8
+#define WAVE_SHADER_MAX_STOPS 8
+#define WAVE_SHADER_SOURCE_SIZE 16384
+
+typedef enum { WAVE_SHADER_VERTEX, WAVE_SHADER_FRAGMENT } WaveShaderStage;
+
+typedef struct {
+    float freqX, freqY, speed, phase, amplitude;
+} WaveOctave;
+
+typedef struct {
+    float r, g, b;
+    float position;  // along the gradient, ascending
+} WaveStop;
+
+typedef struct {
+    const WaveOctave* octaves;
+    int octaveCount;
+    int displaceVertices;
+
+    const WaveStop* stops;
+    int stopCount;  // at least 2
+
+    int drift;
+    float driftColor[3];
+    float driftAmount, driftSpread;
+    int band;
+    int shimmer;
+    // The wave_interaction.h events, per pixel; not with displaceVertices
+    int interaction;
+} WaveShaderConfig;
+
+// Write one stage's complete source into out. Returns 0 if the
+// configuration is out of range or the source does not fit.
+int waveShaderSource(const WaveShaderConfig* config, WaveShaderStage stage, char* out, size_t size);
+
+#endif
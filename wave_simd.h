@@ -0,0 +1,101 @@
+#ifndef WAVE_SIMD_H
+#define WAVE_SIMD_H
+
+// Vectorised sine for the SIMD kernels in wave_kernel.c and wave_raster.c:
+// Cody-Waite reduction by pi in four parts followed by an odd minimax
+// polynomial on [-pi/2, pi/2] (about 3.5 ulp, same coefficients as SLEEF's
+// sinf_u35). Each instruction set the compiler can target gets a wkSin* and
+// a WK_HAVE_* define; AVX2 and AVX-512 are compiled per function, so the
+// caller still has to check the CPU before running them.
+
+#define WK_INV_PI 0.318309886183790671538f
+#define WK_PI_A 3.140625f
+#define WK_PI_B 0.0009670257568359375f
+#define WK_PI_C 6.2771141529083251953e-07f
+#define WK_PI_D 1.2154201256553420762e-10f
+#define WK_SIN_C1 -0.166666597127914428710938f
+#define WK_SIN_C2 0.00833307858556509017944336f
+#define WK_SIN_C3 -0.0001981069071916863322258f
+#define WK_SIN_C4 2.6083159809786593541503e-06f
+
+#if defined(__SSE2__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#define WK_HAVE_SSE2 1
+#include <emmintrin.h>
+
+static inline __m128 wkSinSSE2(__m128 x) {
+    __m128i qi = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(WK_INV_PI)));
+    __m128 q = _mm_cvtepi32_ps(qi);
+    __m128 d = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(WK_PI_A)));
+    d = _mm_sub_ps(d, _mm_mul_ps(q, _mm_set1_ps(WK_PI_B)));
+    d = _mm_sub_ps(d, _mm_mul_ps(q, _mm_set1_ps(WK_PI_C)));
+    d = _mm_sub_ps(d, _mm_mul_ps(q, _mm_set1_ps(WK_PI_D)));
+    __m128 s = _mm_mul_ps(d, d);
+    __m128 u = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(WK_SIN_C4), s), _mm_set1_ps(WK_SIN_C3));
+    u = _mm_add_ps(_mm_mul_ps(u, s), _mm_set1_ps(WK_SIN_C2));
+    u = _mm_add_ps(_mm_mul_ps(u, s), _mm_set1_ps(WK_SIN_C1));
+    u = _mm_add_ps(_mm_mul_ps(s, _mm_mul_ps(u, d)), d);
+    // Odd multiples of pi flip the sign
+    return _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(qi, 31)));
+}
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WK_HAVE_AVX2 1
+#define WK_HAVE_AVX512 1
+#include <immintrin.h>
+
+__attribute__((target("avx2"))) static inline __m256 wkSinAVX2(__m256 x) {
+    __m256i qi = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(WK_INV_PI)));
+    __m256 q = _mm256_cvtepi32_ps(qi);
+    __m256 d = _mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(WK_PI_A)));
+    d = _mm256_sub_ps(d, _mm256_mul_ps(q, _mm256_set1_ps(WK_PI_B)));
+    d = _mm256_sub_ps(d, _mm256_mul_ps(q, _mm256_set1_ps(WK_PI_C)));
+    d = _mm256_sub_ps(d, _mm256_mul_ps(q, _mm256_set1_ps(WK_PI_D)));
+    __m256 s = _mm256_mul_ps(d, d);
+    __m256 u = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(WK_SIN_C4), s), _mm256_set1_ps(WK_SIN_C3));
+    u = _mm256_add_ps(_mm256_mul_ps(u, s), _mm256_set1_ps(WK_SIN_C2));
+    u = _mm256_add_ps(_mm256_mul_ps(u, s), _mm256_set1_ps(WK_SIN_C1));
+    u = _mm256_add_ps(_mm256_mul_ps(s, _mm256_mul_ps(u, d)), d);
+    return _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(qi, 31)));
+}
+
+// AVX-512F alone has no float xor, so the sign flip goes through integers
+__attribute__((target("avx512f"))) static inline __m512 wkSinAVX512(__m512 x) {
+    __m512i qi = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(WK_INV_PI)));
+    __m512 q = _mm512_cvtepi32_ps(qi);
+    __m512 d = _mm512_sub_ps(x, _mm512_mul_ps(q, _mm512_set1_ps(WK_PI_A)));
+    d = _mm512_sub_ps(d, _mm512_mul_ps(q, _mm512_set1_ps(WK_PI_B)));
+    d = _mm512_sub_ps(d, _mm512_mul_ps(q, _mm512_set1_ps(WK_PI_C)));
+    d = _mm512_sub_ps(d, _mm512_mul_ps(q, _mm512_set1_ps(WK_PI_D)));
+    __m512 s = _mm512_mul_ps(d, d);
+    __m512 u = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(WK_SIN_C4), s), _mm512_set1_ps(WK_SIN_C3));
+    u = _mm512_add_ps(_mm512_mul_ps(u, s), _mm512_set1_ps(WK_SIN_C2));
+    u = _mm512_add_ps(_mm512_mul_ps(u, s), _mm512_set1_ps(WK_SIN_C1));
+    u = _mm512_add_ps(_mm512_mul_ps(s, _mm512_mul_ps(u, d)), d);
+    __m512i sign = _mm512_slli_epi32(qi, 31);
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(u), sign));
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define WK_HAVE_NEON 1
+#include <arm_neon.h>
+
+static inline float32x4_t wkSinNEON(float32x4_t x) {
+    int32x4_t qi = vcvtnq_s32_f32(vmulq_n_f32(x, WK_INV_PI));
+    float32x4_t q = vcvtq_f32_s32(qi);
+    float32x4_t d = vmlsq_n_f32(x, q, WK_PI_A);
+    d = vmlsq_n_f32(d, q, WK_PI_B);
+    d = vmlsq_n_f32(d, q, WK_PI_C);
+    d = vmlsq_n_f32(d, q, WK_PI_D);
+    float32x4_t s = vmulq_f32(d, d);
+    float32x4_t u = vmlaq_n_f32(vdupq_n_f32(WK_SIN_C3), s, WK_SIN_C4);
+    u = vmlaq_f32(vdupq_n_f32(WK_SIN_C2), u, s);
+    u = vmlaq_f32(vdupq_n_f32(WK_SIN_C1), u, s);
+    u = vmlaq_f32(d, s, vmulq_f32(u, d));
+    uint32x4_t sign = vshlq_n_u32(vreinterpretq_u32_s32(qi), 31);
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(u), sign));
+}
+#endif
+
+#endif
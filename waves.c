@@ -4,11 +4,66 @@
 #elif defined(__APPLE__)
 #include <OpenGL/gl.h>
 #else
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #endif
 #include <GLFW/glfw3.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "headless.h"
+#include "idle_governor.h"
+#include "input_log.h"
+#include "palette.h"
+#include "render_scale.h"
+#include "sprites.h"
+#include "sim_clock.h"
+#include "snapshot.h"
+#include "stream_buffer.h"
+#include "wave_events.h"
+#include "wave_field.h"
+#include "wave_kernel.h"
+#include "worker_pool.h"
+
+// The retained-mode path needs GL 2.0 entry points (VBOs + GLSL), which the
+// stock Windows opengl32 import library does not export.
+#ifndef _WIN32
+#define WAVES_RETAINED 1
+#endif
+
+#define WAVE_LAYERS 5
+// Strip resolution is picked per frame (see updateWaveLod) within these bounds
+#define WAVE_MIN_SEGMENTS 8
+#define WAVE_MAX_SEGMENTS 2048
+// Largest on-screen gap between a strip chord and the true wave, in pixels
+#define WAVE_LOD_TOLERANCE 0.5f
+#define NUM_ORBS 8
+#define VORTEX_PARTICLES 30
+#define EXPLOSION_PARTICLES 20
+#define MAX_SPRITES (VORTEX_PARTICLES + EXPLOSION_PARTICLES + NUM_ORBS * 2 + 1)
+// Each layer's strip plus one degenerate vertex on either side that stitches
+// all layers into a single triangle strip
+#define LAYER_VERTICES ((WAVE_MAX_SEGMENTS + 1) * 2 + 2)
+#define CRYSTAL_BRANCHES 6
+// 10 hexagonal segment fans plus 3 x 2 sub-branches of 5 square fans, as triangles
+#define CRYSTAL_BRANCH_VERTICES (10 * 6 * 3 + 3 * 2 * 5 * 4 * 3)
+// Frost sparkles ride in the crystal's draw as 3-pixel quads
+#define FROST_PARTICLES 20
+#define FROST_VERTICES (FROST_PARTICLES * 6)
+#define CRYSTAL_VERTICES (CRYSTAL_BRANCHES * CRYSTAL_BRANCH_VERTICES + FROST_VERTICES)
+#define FRAME_VERTICES (WAVE_LAYERS * LAYER_VERTICES + CRYSTAL_VERTICES)
+// --physics field: wide enough for the furthest zoom at 4:3, stepped in
+// fixed frames with a bounded catch-up after a stall
+#define PHYSICS_WORLD_WIDTH 8.0f
+#define PHYSICS_TIMESTEP (1.0 / 60.0)
+#define PHYSICS_MAX_STEPS 4
+// --bench defaults: simulated 60 Hz steps, frames excluded from the stats
+#define BENCH_DEFAULT_FRAMES 600
+#define BENCH_TIMESTEP (1.0 / 60.0)
+#define BENCH_WARMUP_FRAMES 30
 
 float zoom = 1.0f;
 float clickX = 0.0f;
@@ -20,433 +75,1313 @@ float rightClickY = 0.0f;
 float rightClickTime = -10.0f;
 int rightMousePressed = 0;
 float aspectRatio = 4.0f / 3.0f;
+int framebufferWidth = 800;
+int framebufferHeight = 600;
+
+// Current strip resolution and the runtime floor/ceiling (--segments-min/max)
+int waveSegments = 0;
+int segmentsFloor = 32;
+int segmentsCeiling = WAVE_MAX_SEGMENTS;
+
+// Every click spawns events into this pool, so ripples from earlier clicks
+// keep running alongside new ones. The handles track the current press.
+WaveEventPool eventPool;
+int rippleHandle = -1;
+int vortexHandle = -1;
+int freezeHandle = -1;
+
+// Per-layer interaction terms from the event grid, refreshed every frame
+float interactMul[WAVE_LAYERS][WAVE_MAX_SEGMENTS + 1];
+float interactAdd[WAVE_LAYERS][WAVE_MAX_SEGMENTS + 1];
+int layerInteracts[WAVE_LAYERS];
+float gridX[WAVE_MAX_SEGMENTS + 1];
+
+// In --physics mode clicks and drags push impulses into a simulated
+// heightfield and the wave layers ride on its surface instead of on the
+// analytic events above
+int physicsMode = 0;
+WaveField waveField;
+SimClock physicsClock;
+float lastDragX = 0.0f;
+float lastDragY = 0.0f;
+
+// In --bench mode the animation runs on this simulated clock instead of
+// wall time, so every run renders exactly the same frames
+int benchMode = 0;
+double benchClock = 0.0;
+
+// --headless renders with no window system: no GLFW window, and frames go
+// to an offscreen framebuffer
+HeadlessContext headlessContext;
+
+// Wall time, from GLFW or, when it is not running, the headless clock
+double wallClock() {
+    return headlessContext.backend != HEADLESS_NONE ? headlessTime() : glfwGetTime();
+}
 
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+// --snapshot=FILE draws a fixed-time frame for the regression harness
+// (snapshot.h), on its own simulated clock
+Snapshot snapshot;
+
+// --record=FILE logs live input with each frame's clock; --replay=FILE
+// ignores live input and drives the same handlers, and the clock, from a log
+InputLog inputLog;
+// The clock reading the current frame is drawn at
+double frameTime = 0.0;
+
+// Outside --bench, drops to --idle-fps once the window has been left alone
+// and only the slow drift is on screen
+IdleGovernor idleGovernor;
+
+// --frame-budget=MS draws offscreen at whatever fraction of the window keeps
+// frames inside the budget, and stretches the result to fit
+int dynamicResolution = 0;
+RenderScale renderScale;
+
+// SoA wave kernel used by the CPU path (scalar reference or SIMD)
+const WaveKernel* waveKernel = NULL;
+
+// Wave gradient (--palette=FILE). The CPU path rebakes its table every frame
+// with the current tint folded in; the retained path samples the untinted
+// gradient from a 1D texture and applies the tint as a uniform.
+Palette palette;
+PaletteLut paletteLut;
+
+Sprite sprites[MAX_SPRITES];
+
+typedef struct {
+    float x, y;
+    float r, g, b, a;
+} FrameVertex;
+
+// Shared per-frame vertex buffer. Worker jobs write disjoint slices (one per
+// wave layer, then one per crystal branch) straight into the streaming
+// buffer, and the render thread submits it once.
+StreamBuffer frameStream;
+FrameVertex* frameVertices = NULL;
+size_t frameOffset = 0;
+int crystalFirst = 0;
+int crystalCount = 0;
+
+// The crystal at full growth and no spin, relative to the click point.
+// Every position and alpha scales linearly with growth and the whole shape
+// turns with time, so each frame only rotates and scales this template.
+FrameVertex crystalTemplate[CRYSTAL_BRANCHES * CRYSTAL_BRANCH_VERTICES];
+
+typedef struct {
+    float time;
+    int layerJobs;  // 0 when the retained path draws the waves
+    int crystalJobs;
+    float crystalGrowth;
+    float crystalCos, crystalSin;  // spin at this frame's time
+} FrameJobs;
+
+#ifdef WAVES_RETAINED
+// Retained-mode wave pipeline: a static x-grid lives in a VBO and the wave
+// sum and palette are evaluated per vertex on the GPU. Interaction terms
+// from the event grid arrive as a streamed (mul, add) attribute.
+int useRetained = 0;
+GLuint waveProgram = 0;
+GLuint waveGridVBO = 0;
+StreamBuffer interactStream;
+GLint waveGridAttrib = 0;
+GLint waveInteractAttrib = 0;
+GLint waveTimeLoc, waveZoomLoc, waveAspectLoc, waveLayerLoc, waveTintLoc;
+GLuint paletteTexture = 0;
+
+const char* waveVertexShaderSource = "#version 120\n"
+    "attribute vec2 aGrid;\n"
+    "attribute vec2 aInteraction;\n"  // height = wave * x + y
+    "uniform float time;\n"
+    "uniform float zoom;\n"
+    "uniform float aspect;\n"
+    "uniform float layer;\n"
+    "varying float vGradient;\n"
+    "varying float vShade;\n"
+    "varying float vShimmer;\n"
+    "varying float vAlpha;\n"
+    "void main() {\n"
+    "   float x = aGrid.x;\n"
+    "   float layerOffset = layer * 0.3 - 0.6;\n"
+    "   float layerSpeed = 1.0 + layer * 0.3;\n"
+    "   float layerAmplitude = 0.1 + layer * 0.02;\n"
+    "   \n"
+    "   float wave = 0.0;\n"
+    "   wave += sin(x * 3.0 * zoom + time * layerSpeed) * layerAmplitude;\n"
+    "   wave += sin(x * 5.0 * zoom - time * layerSpeed * 0.7) * layerAmplitude * 0.5;\n"
+    "   wave += sin(x * 7.0 * zoom + time * layerSpeed * 1.3) * layerAmplitude * 0.3;\n"
+    "   \n"
+    "   // Ripples, vortices and freeze zones\n"
+    "   wave = wave * aInteraction.x + aInteraction.y;\n"
+    "   \n"
+    "   float y = layerOffset + wave;\n"
+    "   vGradient = (y + 1.0) * 0.5;\n"
+    "   vShade = sin(time * 0.5 + x * 2.0) * 0.3 + 0.7;\n"
+    "   vShimmer = sin(x * 20.0 + time * 3.0) * 0.05;\n"
+    "   vAlpha = 0.8 + layer * 0.04;\n"
+    "   // Bottom edge of the strip stays pinned to the bottom of the view\n"
+    "   float vy = aGrid.y > 0.5 ? -zoom : y;\n"
+    "   gl_Position = gl_ModelViewProjectionMatrix * vec4(x * aspect * zoom, vy, 0.0, 1.0);\n"
+    "}\n";
+
+// The palette texture has PALETTE_LUT_SIZE (256) texels with entry i at
+// gradient i / 255; texel centres sit at (i + 0.5) / 256
+const char* waveFragmentShaderSource = "#version 120\n"
+    "uniform sampler1D palette;\n"
+    "uniform vec3 tint;\n"
+    "varying float vGradient;\n"
+    "varying float vShade;\n"
+    "varying float vShimmer;\n"
+    "varying float vAlpha;\n"
+    "void main() {\n"
+    "   float coord = (clamp(vGradient, 0.0, 1.0) * 255.0 + 0.5) / 256.0;\n"
+    "   vec3 color = texture1D(palette, coord).rgb * tint * vShade;\n"
+    "   gl_FragColor = vec4(color + vec3(vShimmer, vShimmer, vShimmer * 1.2), vAlpha);\n"
+    "}\n";
+#endif
+
+void applyScroll(GLFWwindow* window, double xoffset, double yoffset) {
     zoom += (float)yoffset * 0.1f;
     if (zoom < 0.8f) zoom = 0.8f;
     if (zoom > 3.0f) zoom = 3.0f;
 }
 
-void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-    double xpos, ypos;
-    glfwGetCursorPos(window, &xpos, &ypos);
-
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogScroll(&inputLog, xoffset, yoffset);
+    idleGovernorInput(&idleGovernor);
+    applyScroll(window, xoffset, yoffset);
+}
 
-    // Convert pixel coordinates to OpenGL world coordinates
-    // Account for aspect ratio in projection
-    float aspect = (float)width / (float)height;
-    float worldX = ((xpos / width) * 2.0f - 1.0f) * aspect * zoom;
-    float worldY = -((ypos / height) * 2.0f - 1.0f) * zoom;
+double currentTime() {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return inputLog.time;
+    }
+    if (snapshot.path) {
+        return snapshotClock(&snapshot);
+    }
+    return benchMode ? benchClock : wallClock();
+}
 
+// Start or end a click at a world position. Shared by the mouse callbacks
+// and the --bench script.
+void pressButton(int button, int action, float worldX, float worldY) {
+    float now = currentTime();
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == GLFW_PRESS) {
             clickX = worldX;
             clickY = worldY;
-            clickTime = glfwGetTime();
+            clickTime = now;
             mousePressed = 1;
+            if (physicsMode) {
+                // A drop into the surface
+                waveFieldImpulse(&waveField, worldX, worldY, 0.06f, -0.4f);
+                lastDragX = worldX;
+                lastDragY = worldY;
+            } else {
+                rippleHandle = waveEventSpawn(&eventPool, WAVE_EVENT_RIPPLE, worldX, worldY, now, 1);
+                vortexHandle = waveEventSpawn(&eventPool, WAVE_EVENT_VORTEX, worldX, worldY, now, 1);
+            }
         } else if (action == GLFW_RELEASE) {
             mousePressed = 0;
+            if (!physicsMode) {
+                waveEventRelease(&eventPool, rippleHandle);
+                waveEventRelease(&eventPool, vortexHandle);
+            }
         }
     } else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
         if (action == GLFW_PRESS) {
             rightClickX = worldX;
             rightClickY = worldY;
-            rightClickTime = glfwGetTime();
+            rightClickTime = now;
             rightMousePressed = 1;
+            if (!physicsMode) {
+                freezeHandle = waveEventSpawn(&eventPool, WAVE_EVENT_FREEZE, worldX, worldY, now, 1);
+            }
         } else if (action == GLFW_RELEASE) {
             rightMousePressed = 0;
+            if (!physicsMode) {
+                waveEventRelease(&eventPool, freezeHandle);
+            }
         }
     }
 }
 
-void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-
-    // Update position continuously while dragging
-    float aspect = (float)width / (float)height;
-    float worldX = ((xpos / width) * 2.0f - 1.0f) * aspect * zoom;
-    float worldY = -((ypos / height) * 2.0f - 1.0f) * zoom;
-
+// Update position continuously while dragging
+void dragTo(float worldX, float worldY) {
     if (mousePressed) {
         clickX = worldX;
         clickY = worldY;
         // Don't reset clickTime to keep the effect continuous
+        if (physicsMode) {
+            // The cursor ploughs a wake, deeper the faster it moves
+            float dx = worldX - lastDragX, dy = worldY - lastDragY;
+            float push = sqrtf(dx * dx + dy * dy) * 6.0f;
+            waveFieldImpulse(&waveField, worldX, worldY, 0.04f, push < 0.2f ? -push : -0.2f);
+            lastDragX = worldX;
+            lastDragY = worldY;
+        } else {
+            waveEventMove(&eventPool, rippleHandle, worldX, worldY);
+            waveEventMove(&eventPool, vortexHandle, worldX, worldY);
+        }
     }
 
     if (rightMousePressed) {
         rightClickX = worldX;
         rightClickY = worldY;
         // Don't reset rightClickTime to keep the effect continuous
+        if (!physicsMode) {
+            waveEventMove(&eventPool, freezeHandle, worldX, worldY);
+        }
     }
 }
 
+void applyButton(GLFWwindow* window, int button, int action, int mods, double xpos, double ypos) {
+    int width = framebufferWidth, height = framebufferHeight;
+
+    // Convert pixel coordinates to OpenGL world coordinates
+    // Account for aspect ratio in projection
+    float aspect = (float)width / (float)height;
+    float worldX = ((xpos / width) * 2.0f - 1.0f) * aspect * zoom;
+    float worldY = -((ypos / height) * 2.0f - 1.0f) * zoom;
+
+    pressButton(button, action, worldX, worldY);
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    inputLogButton(&inputLog, button, action, mods, xpos, ypos);
+    idleGovernorInput(&idleGovernor);
+    applyButton(window, button, action, mods, xpos, ypos);
+}
+
+void applyCursor(GLFWwindow* window, double xpos, double ypos) {
+    int width = framebufferWidth, height = framebufferHeight;
+
+    float aspect = (float)width / (float)height;
+    float worldX = ((xpos / width) * 2.0f - 1.0f) * aspect * zoom;
+    float worldY = -((ypos / height) * 2.0f - 1.0f) * zoom;
+
+    dragTo(worldX, worldY);
+}
+
+void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+    if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        return;
+    }
+    inputLogCursor(&inputLog, xpos, ypos);
+    idleGovernorInput(&idleGovernor);
+    applyCursor(window, xpos, ypos);
+}
+
+// Pointer positions in a log only mean the same thing at the same size
+void replayResize(GLFWwindow* window, int width, int height) {
+    static int warned = 0;
+    if (!warned && (width != framebufferWidth || height != framebufferHeight)) {
+        fprintf(stderr, "Input log was recorded at %dx%d, replaying at %dx%d\n", width, height, framebufferWidth,
+                framebufferHeight);
+        warned = 1;
+    }
+}
+
+const InputLogHandlers replayHandlers = {applyCursor, applyButton, applyScroll, NULL, replayResize};
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    inputLogResize(&inputLog, width, height);
+    idleGovernorDamage(&idleGovernor);
     glViewport(0, 0, width, height);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     aspectRatio = (float)width / (float)height;
+    framebufferWidth = width;
+    framebufferHeight = height;
     glOrtho(-aspectRatio * zoom, aspectRatio * zoom, -1.0 * zoom, 1.0 * zoom, -1.0, 1.0);
     glMatrixMode(GL_MODELVIEW);
 }
 
-int main() {
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
-        return -1;
+#ifdef WAVES_RETAINED
+void uploadWaveGrid();
+#endif
+
+// Pick the strip resolution so that a straight chord between two vertices
+// strays at most WAVE_LOD_TOLERANCE pixels from the wave. A sine of
+// amplitude A and frequency k sampled every h units deviates by at most
+// A * k^2 * h^2 / 8, so the spacing follows from the summed curvature of the
+// base octaves plus whatever the live events add.
+void updateWaveLod() {
+    float worldScale = aspectRatio * zoom;
+    float amplitude = 0.1f + (WAVE_LAYERS - 1) * 0.02f;
+    float curvature = amplitude * zoom * zoom * (3.0f * 3.0f + 0.5f * 5.0f * 5.0f + 0.3f * 7.0f * 7.0f);
+    curvature += waveEventsCurvature(&eventPool, worldScale);
+
+    float tolerance = WAVE_LOD_TOLERANCE * 2.0f * zoom / framebufferHeight;
+    float spacing = sqrtf(8.0f * tolerance / curvature);
+    if (physicsMode && spacing > waveField.cellSize / worldScale) {
+        // The field carries detail down to a single cell
+        spacing = waveField.cellSize / worldScale;
+    }
+    int target = ((int)ceilf(2.0f / spacing) + 7) & ~7;
+
+    // Vertices closer than two pixels apart add nothing visible
+    if (target > framebufferWidth / 2) target = framebufferWidth / 2;
+    if (target > segmentsCeiling) target = segmentsCeiling;
+    if (target < segmentsFloor) target = segmentsFloor;
+
+    // Refine right away, but only coarsen once the target has dropped well
+    // below the current count so that slow zooming does not thrash the mesh
+    if (target > waveSegments || target < waveSegments * 3 / 4) {
+        waveSegments = target;
+        for (int i = 0; i <= waveSegments; i++) {
+            gridX[i] = (i / (waveSegments * 0.5f)) - 1.0f;
+        }
+#ifdef WAVES_RETAINED
+        if (useRetained) {
+            uploadWaveGrid();
+        }
+#endif
     }
+}
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Peaceful Waves", NULL, NULL);
-    if (!window) {
-        printf("Failed to create window\n");
-        glfwTerminate();
-        return -1;
+void interactionRowJob(void* ctx, int layer) {
+    float time = *(const float*)ctx;
+    float layerOffset = layer * 0.3f - 0.6f;
+    layerInteracts[layer] = waveEventsEvaluateRow(&eventPool, time, gridX, waveSegments + 1, aspectRatio * zoom,
+                                                  layerOffset, interactMul[layer], interactAdd[layer]);
+}
+
+void fieldRowJob(void* ctx, int layer) {
+    float alpha = *(const float*)ctx;
+    float layerOffset = layer * 0.3f - 0.6f;
+    for (int i = 0; i <= waveSegments; i++) {
+        interactMul[layer][i] = 1.0f;
     }
+    waveFieldSampleRow(&waveField, gridX, waveSegments + 1, aspectRatio * zoom, layerOffset, alpha,
+                       interactAdd[layer]);
+    layerInteracts[layer] = 1;
+}
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetMouseButtonCallback(window, mouse_button_callback);
-    glfwSetCursorPosCallback(window, cursor_position_callback);
-    glfwSwapInterval(1);  // Enable vsync
+// Advance the heightfield in fixed PHYSICS_TIMESTEP steps up to the clock,
+// holding the right button's freeze over it, then sample the surface
+// between the last two steps under every layer as an additive interaction
+// term
+void updatePhysics() {
+    simClockBegin(&physicsClock, frameTime);
+    while (simClockStep(&physicsClock)) {
+        if (rightMousePressed) {
+            waveFieldDamp(&waveField, rightClickX, rightClickY, 0.3f, 0.2f);
+        }
+        waveFieldStep(&waveField);
+    }
 
-    // Initialize OpenGL
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    float alpha = simClockAlpha(&physicsClock);
+    updateWaveLod();
+    workerPoolRun(fieldRowJob, &alpha, WAVE_LAYERS);
+}
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    framebuffer_size_callback(window, width, height);
+// Retire expired events, bin the live ones and evaluate their effect on
+// every wave vertex. Layers no event reaches are flagged and skipped later.
+void updateInteractions(float time) {
+    if (physicsMode) {
+        updatePhysics();
+        return;
+    }
 
-    while (!glfwWindowShouldClose(window)) {
-        float time = glfwGetTime();
+    float worldScale = aspectRatio * zoom;
+    waveEventsUpdate(&eventPool, time);
+    updateWaveLod();
+    waveEventsBuildGrid(&eventPool, time, -worldScale, -0.6f, worldScale, WAVE_LAYERS * 0.3f - 0.9f);
 
-        // Clear with deep ocean color
-        glClearColor(0.05f, 0.15f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+    workerPoolRun(interactionRowJob, &time, WAVE_LAYERS);
+}
 
-        glLoadIdentity();
+// Evaluate one layer with the selected SoA kernel and pack it into its slice
+// of the shared buffer: a leading copy of the first vertex, the strip, and a
+// trailing copy of the last one, so consecutive layers join with zero-area
+// triangles.
+void generateWaveLayer(int layer, float time) {
+    float ys[WAVE_MAX_SEGMENTS + 1], rs[WAVE_MAX_SEGMENTS + 1], gs[WAVE_MAX_SEGMENTS + 1], bs[WAVE_MAX_SEGMENTS + 1];
+    WaveParams params = {time, zoom, aspectRatio, layer, NULL, NULL, &paletteLut};
+    if (layerInteracts[layer]) {
+        params.interactMul = interactMul[layer];
+        params.interactAdd = interactAdd[layer];
+    }
+    waveKernel->evaluate(&params, gridX, waveSegments + 1, ys, rs, gs, bs);
+
+    int stride = (waveSegments + 1) * 2 + 2;
+    FrameVertex* out = &frameVertices[layer * stride + 1];
+    float a = 0.8f + layer * 0.04f;
+    for (int i = 0; i <= waveSegments; i++) {
+        // x needs to be scaled by aspect to match projection
+        float worldX = gridX[i] * aspectRatio * zoom;
+
+        // Top vertex follows the wave, bottom vertex pins the strip
+        FrameVertex top = {worldX, ys[i], rs[i], gs[i], bs[i], a};
+        FrameVertex bottom = {worldX, -1.0f * zoom, rs[i], gs[i], bs[i], a};
+        out[i * 2] = top;
+        out[i * 2 + 1] = bottom;
+    }
 
-        // Draw multiple wave layers
-        for (int layer = 0; layer < 5; layer++) {
-            glBegin(GL_TRIANGLE_STRIP);
-
-            float layerOffset = layer * 0.3f - 0.6f;
-            float layerSpeed = 1.0f + layer * 0.3f;
-            float layerAmplitude = 0.1f + layer * 0.02f;
-
-            // Create wave vertices
-            for (int i = 0; i <= 100; i++) {
-                float x = (i / 50.0f) - 1.0f;
-
-                // Multiple sine waves for complex motion
-                float wave = 0.0f;
-                wave += sin(x * 3.0f * zoom + time * layerSpeed) * layerAmplitude;
-                wave += sin(x * 5.0f * zoom - time * layerSpeed * 0.7f) * layerAmplitude * 0.5f;
-                wave += sin(x * 7.0f * zoom + time * layerSpeed * 1.3f) * layerAmplitude * 0.3f;
-
-                // Add ripple and vortex effects from mouse
-                // vertices are at x * aspectRatio * zoom
-                float dx = x * aspectRatio * zoom - clickX;
-                float dy = layerOffset - clickY;
-                float dist = sqrt(dx * dx + dy * dy);
-
-                // Right mouse freezing effect
-                float rightDx = x * aspectRatio * zoom - rightClickX;
-                float rightDy = layerOffset - rightClickY;
-                float rightDist = sqrt(rightDx * rightDx + rightDy * rightDy);
-
-                float timeSinceRightClick = time - rightClickTime;
-                float freezeFactor = 1.0f;
-
-                if ((rightMousePressed || timeSinceRightClick < 3.0f) && rightDist < 0.5f) {
-                    // Freeze/slow waves near right click
-                    float freezeStrength = (1.0f - rightDist / 0.5f);
-                    if (!rightMousePressed) {
-                        freezeStrength *= (1.0f - timeSinceRightClick / 3.0f);
-                    }
-                    freezeFactor = 1.0f - freezeStrength * 0.9f;
+    int last = (waveSegments + 1) * 2 - 1;
+    out[-1] = out[0];
+    out[last + 1] = out[last];
+}
 
-                    // Add crystalline patterns
-                    float crystalPattern = sin(x * 30.0f) * cos(dy * 30.0f) * freezeStrength * 0.05f;
-                    wave += crystalPattern;
-                }
+static void bindFrameVertices() {
+    const char* base = streamBufferBind(&frameStream, frameOffset);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(FrameVertex), base);
+    glColorPointer(4, GL_FLOAT, sizeof(FrameVertex), base + 2 * sizeof(float));
+}
+
+static void unbindFrameVertices() {
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    streamBufferUnbind(&frameStream);
+}
+
+// Submit all layers generated this frame as one stitched strip
+void drawWavesCPU() {
+    int stride = (waveSegments + 1) * 2 + 2;
 
-                float timeSinceClick = time - clickTime;
-                if (timeSinceClick >= 0.0f && timeSinceClick < 5.0f) {
-                    // Create expanding ripples (affected by freeze)
-                    float rippleSpeed = 3.0f * freezeFactor;
-                    float rippleRadius = timeSinceClick * rippleSpeed;
-                    float rippleWidth = 0.3f;
-
-                    // Multiple ripple rings
-                    for (int r = 0; r < 3; r++) {
-                        float ringOffset = r * 0.5f;
-                        float ringDist = fabs(dist - (rippleRadius - ringOffset));
-                        if (ringDist < rippleWidth) {
-                            float rippleStrength = (1.0f - ringDist / rippleWidth) * (1.0f - timeSinceClick / 5.0f);
-                            wave += sin(dist * 10.0f - time * 5.0f * freezeFactor) * rippleStrength * 0.3f * freezeFactor;
-                        }
+    bindFrameVertices();
+    glDrawArrays(GL_TRIANGLE_STRIP, 1, WAVE_LAYERS * stride - 2);
+    unbindFrameVertices();
+}
+
+static void setVertex(int index, float x, float y, float r, float g, float b, float a) {
+    FrameVertex v = {x, y, r, g, b, a};
+    frameVertices[index] = v;
+}
+
+static void setTemplateVertex(int index, float x, float y, float r, float g, float b, float a) {
+    FrameVertex v = {x, y, r, g, b, a};
+    crystalTemplate[index] = v;
+}
+
+// One crystal branch as independent triangles (the fans of the original
+// immediate-mode code, split up so all branches share one draw call)
+static int buildCrystalBranch(int v, int branch) {
+    float baseAngle = branch * 3.14159f / 3.0f;
+
+    // Main branch
+    for (int seg = 0; seg < 10; seg++) {
+        float segDist = seg * 0.04f;
+        float segX = cos(baseAngle) * segDist;
+        float segY = sin(baseAngle) * segDist;
+
+        // Ice blue gradient
+        float intensity = 1.0f - seg / 10.0f;
+        float size = 0.02f - seg * 0.001f;
+        for (int j = 0; j < 6; j++) {
+            float a0 = j * 2.0f * 3.14159f / 6.0f;
+            float a1 = (j + 1) * 2.0f * 3.14159f / 6.0f;
+            setTemplateVertex(v++, segX, segY, 0.7f, 0.9f, 1.0f, intensity * 0.8f);
+            setTemplateVertex(v++, segX + cos(a0) * size, segY + sin(a0) * size, 0.5f, 0.8f, 1.0f, intensity * 0.3f);
+            setTemplateVertex(v++, segX + cos(a1) * size, segY + sin(a1) * size, 0.5f, 0.8f, 1.0f, intensity * 0.3f);
+        }
+
+        // Sub-branches
+        if (seg > 2 && seg % 2 == 0) {
+            for (int side = -1; side <= 1; side += 2) {
+                float subAngle = baseAngle + side * 3.14159f / 6.0f;
+                for (int subseg = 0; subseg < 5; subseg++) {
+                    float subDist = subseg * 0.02f;
+                    float subX = segX + cos(subAngle) * subDist;
+                    float subY = segY + sin(subAngle) * subDist;
+                    float subAlpha = intensity * (1.0f - subseg / 5.0f) * 0.6f;
+                    float subSize = 0.008f;
+                    for (int j = 0; j < 4; j++) {
+                        float a0 = j * 2.0f * 3.14159f / 4.0f;
+                        float a1 = (j + 1) * 2.0f * 3.14159f / 4.0f;
+                        setTemplateVertex(v++, subX, subY, 0.8f, 0.95f, 1.0f, subAlpha);
+                        setTemplateVertex(v++, subX + cos(a0) * subSize, subY + sin(a0) * subSize, 0.8f, 0.95f, 1.0f,
+                                          subAlpha);
+                        setTemplateVertex(v++, subX + cos(a1) * subSize, subY + sin(a1) * subSize, 0.8f, 0.95f, 1.0f,
+                                          subAlpha);
                     }
                 }
+            }
+        }
+    }
+    return v;
+}
 
-                // Add vortex/whirlpool effect when mouse is held down
-                if (mousePressed && dist < 1.0f) {
-                    float vortexStrength = (1.0f - dist) * 0.5f * freezeFactor;
-                    float angle = atan2(dy, dx);
+void buildCrystalTemplate() {
+    int v = 0;
+    for (int branch = 0; branch < CRYSTAL_BRANCHES; branch++) {
+        v = buildCrystalBranch(v, branch);
+    }
+}
 
-                    // Swirling motion (slowed by freeze)
-                    wave += sin(angle * 5.0f + time * 10.0f * freezeFactor - dist * 20.0f) * vortexStrength;
+// Rotate, scale and fade one branch of the template into the frame buffer
+void generateCrystalBranch(int branch, const FrameJobs* jobs) {
+    const FrameVertex* src = crystalTemplate + branch * CRYSTAL_BRANCH_VERTICES;
+    FrameVertex* dst = frameVertices + crystalFirst + branch * CRYSTAL_BRANCH_VERTICES;
+    float growth = jobs->crystalGrowth;
+    float c = jobs->crystalCos * growth, s = jobs->crystalSin * growth;
+    for (int i = 0; i < CRYSTAL_BRANCH_VERTICES; i++) {
+        FrameVertex v = src[i];
+        float x = v.x, y = v.y;
+        v.x = rightClickX + x * c - y * s;
+        v.y = rightClickY + x * s + y * c;
+        v.a *= growth;
+        dst[i] = v;
+    }
+}
 
-                    // Pulling effect toward center
-                    wave -= dist * vortexStrength * 0.3f;
+// Twinkling frost around a held right click, after the branches
+void generateFrost(float time) {
+    int v = crystalFirst + CRYSTAL_BRANCHES * CRYSTAL_BRANCH_VERTICES;
+    float half = 1.5f * 2.0f * zoom / framebufferHeight;
+    for (int p = 0; p < FROST_PARTICLES; p++) {
+        float angle = p * 3.14159f * 2.0f / FROST_PARTICLES;
+        float dist = sin(time * 3.0f + p * 0.5f) * 0.15f + 0.1f;
+        float px = rightClickX + cos(angle) * dist;
+        float py = rightClickY + sin(angle) * dist;
+        float twinkle = sin(time * 10.0f + p * 2.0f) * 0.5f + 0.5f;
+        float a = twinkle * 0.7f;
+        setVertex(v++, px - half, py - half, 0.9f, 0.95f, 1.0f, a);
+        setVertex(v++, px + half, py - half, 0.9f, 0.95f, 1.0f, a);
+        setVertex(v++, px + half, py + half, 0.9f, 0.95f, 1.0f, a);
+        setVertex(v++, px - half, py - half, 0.9f, 0.95f, 1.0f, a);
+        setVertex(v++, px + half, py + half, 0.9f, 0.95f, 1.0f, a);
+        setVertex(v++, px - half, py + half, 0.9f, 0.95f, 1.0f, a);
+    }
+}
 
-                    // Add chaotic turbulence (reduced when frozen)
-                    wave += sin(x * 50.0f + time * 20.0f * freezeFactor) * cos(dy * 50.0f) * vortexStrength * 0.2f;
+void drawCrystal() {
+    bindFrameVertices();
+    glDrawArrays(GL_TRIANGLES, crystalFirst, crystalCount);
+    unbindFrameVertices();
+}
 
-                    // Pulsing effect
-                    wave *= 1.0f + sin(time * 15.0f * freezeFactor) * vortexStrength * 0.3f;
-                }
+// Jobs 0 .. layerJobs-1 are wave layers, the rest crystal branches
+void frameJob(void* ctx, int job) {
+    const FrameJobs* jobs = ctx;
+    if (job < jobs->layerJobs) {
+        generateWaveLayer(job, jobs->time);
+    } else {
+        generateCrystalBranch(job - jobs->layerJobs, jobs);
+    }
+}
 
-                float y = layerOffset + wave;
-
-                // Calculate position-based gradient
-                float gradient = (y + 1.0f) * 0.5f;
-
-                // Time-based color shifting
-                float colorShift = sin(time * 0.3f) * 0.5f + 0.5f;
-                float waveColorShift = sin(time * 0.5f + x * 2.0f) * 0.3f + 0.7f;
-
-                // Define our color palette
-                // Deep blue
-                float deepR = 0.1f, deepG = 0.3f, deepB = 0.6f;
-                // Sky blue
-                float skyR = 0.53f, skyG = 0.81f, skyB = 0.92f;
-                // Lavender
-                float lavR = 0.9f, lavG = 0.8f, lavB = 1.0f;
-                // Peach
-                float peachR = 1.0f, peachG = 0.85f, peachB = 0.7f;
-
-                // Mix colors based on position and time
-                float r, g, b;
-                if (gradient < 0.33f) {
-                    float t = gradient * 3.0f;
-                    r = deepR * (1.0f - t) + skyR * t;
-                    g = deepG * (1.0f - t) + skyG * t;
-                    b = deepB * (1.0f - t) + skyB * t;
-                } else if (gradient < 0.66f) {
-                    float t = (gradient - 0.33f) * 3.0f;
-                    r = skyR * (1.0f - t) + lavR * t;
-                    g = skyG * (1.0f - t) + lavG * t;
-                    b = skyB * (1.0f - t) + lavB * t;
-                } else {
-                    float t = (gradient - 0.66f) * 3.0f;
-                    r = lavR * (1.0f - t) + peachR * t;
-                    g = lavG * (1.0f - t) + peachG * t;
-                    b = lavB * (1.0f - t) + peachB * t;
-                }
+// Gather every circular sprite for this frame in back-to-front order
+int collectSprites(float time, Sprite* out) {
+    int n = 0;
 
-                // Add time-based color variation
-                r = r * (0.7f + colorShift * 0.3f) * waveColorShift;
-                g = g * (0.8f + colorShift * 0.2f) * waveColorShift;
-                b = b * (0.9f + colorShift * 0.1f) * waveColorShift;
+    // Draw click explosion particles and continuous effects
+    float timeSinceClick = time - clickTime;
+    if (mousePressed) {
+        // Continuous vortex particles while holding
+        for (int p = 0; p < VORTEX_PARTICLES && n < MAX_SPRITES; p++) {
+            float angle = p * 3.14159f * 2.0f / VORTEX_PARTICLES + time * 3.0f;
+            float radius = sin(time * 2.0f + p * 0.5f) * 0.3f + 0.2f;
+            Sprite* s = &out[n++];
+            s->x = clickX + cos(angle) * radius;
+            s->y = clickY + sin(angle) * radius;
+            s->size = 0.02f + sin(time * 10.0f + p) * 0.01f;
+            s->edgeAlpha = 1.0f;
+            // Rainbow colors
+            s->r = sin(p * 0.3f + time * 5.0f) * 0.5f + 0.5f;
+            s->g = cos(p * 0.3f + time * 5.0f) * 0.5f + 0.5f;
+            s->b = sin(p * 0.3f + time * 5.0f + 3.14159f) * 0.5f + 0.5f;
+            s->a = 0.7f;
+        }
+    } else if (timeSinceClick >= 0.0f && timeSinceClick < 3.0f) {
+        // Explosion particles after release
+        for (int p = 0; p < EXPLOSION_PARTICLES && n < MAX_SPRITES; p++) {
+            float angle = p * 3.14159f * 2.0f / EXPLOSION_PARTICLES;
+            float particleSpeed = 0.5f + (p % 3) * 0.2f;
+            float intensity = 1.0f - timeSinceClick / 3.0f;
+            Sprite* s = &out[n++];
+            s->x = clickX + cos(angle) * timeSinceClick * particleSpeed;
+            s->y = clickY + sin(angle) * timeSinceClick * particleSpeed - timeSinceClick * timeSinceClick * 0.1f;
+            s->size = 0.03f * intensity;
+            s->edgeAlpha = 1.0f;
+            s->r = 1.0f;
+            s->g = 0.5f + sin(p + time * 5.0f) * 0.5f;
+            s->b = 0.2f;
+            s->a = intensity;
+        }
+    }
 
-                // Add shimmer based on wave position
-                float shimmer = sin(x * 20.0f + time * 3.0f) * 0.05f;
-                r += shimmer;
-                g += shimmer;
-                b += shimmer * 1.2f;
+    // Draw floating orbs: soft outer glow, then the core
+    for (int i = 0; i < NUM_ORBS && n + 2 <= MAX_SPRITES; i++) {
+        float orbTime = time * 0.3f + i * 1.5f;
+        float orbX = sin(orbTime * 0.7f + i * 2.0f) * 0.8f;
+        float orbY = cos(orbTime * 0.5f + i * 1.3f) * 0.4f + sin(orbTime) * 0.1f;
+        float orbSize = 0.02f + sin(orbTime * 2.0f) * 0.01f;
+
+        Sprite glow = {orbX, orbY, orbSize * 3.0f, 0.0f, 1.0f, 0.9f, 0.7f, 0.1f};
+        Sprite core = {orbX, orbY, orbSize, 1.0f,
+                       1.0f, 0.95f - sin(orbTime * 3.0f) * 0.1f, 0.8f + sin(orbTime * 2.0f) * 0.2f, 0.9f};
+        out[n++] = glow;
+        out[n++] = core;
+    }
 
-                float a = 0.8f + layer * 0.04f;
+    // Debug: small marker at the mouse click position
+    if (mousePressed && n < MAX_SPRITES) {
+        Sprite marker = {clickX, clickY, 0.05f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+        out[n++] = marker;
+    }
 
-                glColor4f(r, g, b, a);
+    return n;
+}
 
-                // Top vertex
-                // x needs to be scaled by aspect to match projection
-                glVertex2f(x * aspectRatio * zoom, y);
+#ifdef WAVES_RETAINED
+unsigned int compileShader(unsigned int type, const char* source) {
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        fprintf(stderr, "Shader compilation failed: %s\n", infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
 
-                // Bottom vertex
-                glVertex2f(x * aspectRatio * zoom, -1.0f * zoom);
-            }
+    return shader;
+}
 
-            glEnd();
-        }
-
-        // Draw click explosion particles and continuous effects
-        float timeSinceClick = time - clickTime;
-        if (mousePressed) {
-            // Continuous vortex particles while holding
-            for (int p = 0; p < 30; p++) {
-                float angle = p * 3.14159f * 2.0f / 30.0f + time * 3.0f;
-                float radius = sin(time * 2.0f + p * 0.5f) * 0.3f + 0.2f;
-                float px = clickX + cos(angle) * radius;
-                float py = clickY + sin(angle) * radius;
-
-                glBegin(GL_TRIANGLE_FAN);
-                // Rainbow colors
-                float r = sin(p * 0.3f + time * 5.0f) * 0.5f + 0.5f;
-                float g = cos(p * 0.3f + time * 5.0f) * 0.5f + 0.5f;
-                float b = sin(p * 0.3f + time * 5.0f + 3.14159f) * 0.5f + 0.5f;
-                glColor4f(r, g, b, 0.7f);
-                glVertex2f(px, py);
-                for (int j = 0; j <= 8; j++) {
-                    float a = j * 2.0f * 3.14159f / 8.0f;
-                    float size = 0.02f + sin(time * 10.0f + p) * 0.01f;
-                    glVertex2f(px + cos(a) * size, py + sin(a) * size);
-                }
-                glEnd();
+// Build the wave shader and the static strip grid. Returns 0 when the
+// context cannot run the retained path, in which case the CPU path is used.
+int initWavesRetained() {
+    const char* glslVersion = (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION);
+    if (!glslVersion) {
+        return 0;
+    }
+
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, waveVertexShaderSource);
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, waveFragmentShaderSource);
+    if (!vertexShader || !fragmentShader) {
+        if (vertexShader) glDeleteShader(vertexShader);
+        if (fragmentShader) glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    waveProgram = glCreateProgram();
+    glAttachShader(waveProgram, vertexShader);
+    glAttachShader(waveProgram, fragmentShader);
+    glBindAttribLocation(waveProgram, 0, "aGrid");
+    glBindAttribLocation(waveProgram, 1, "aInteraction");
+    glLinkProgram(waveProgram);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    int success;
+    glGetProgramiv(waveProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(waveProgram, 512, NULL, infoLog);
+        fprintf(stderr, "Shader link failed: %s\n", infoLog);
+        glDeleteProgram(waveProgram);
+        waveProgram = 0;
+        return 0;
+    }
+
+    waveGridAttrib = glGetAttribLocation(waveProgram, "aGrid");
+    waveInteractAttrib = glGetAttribLocation(waveProgram, "aInteraction");
+    waveTimeLoc = glGetUniformLocation(waveProgram, "time");
+    waveZoomLoc = glGetUniformLocation(waveProgram, "zoom");
+    waveAspectLoc = glGetUniformLocation(waveProgram, "aspect");
+    waveLayerLoc = glGetUniformLocation(waveProgram, "layer");
+    waveTintLoc = glGetUniformLocation(waveProgram, "tint");
+    glUseProgram(waveProgram);
+    glUniform1i(glGetUniformLocation(waveProgram, "palette"), 0);
+    glUseProgram(0);
+
+    // The untinted gradient, interleaved for upload
+    const float white[3] = {1.0f, 1.0f, 1.0f};
+    float texels[PALETTE_LUT_SIZE * 3];
+    paletteBake(&palette, white, &paletteLut);
+    for (int i = 0; i < PALETTE_LUT_SIZE; i++) {
+        texels[i * 3 + 0] = paletteLut.r[i];
+        texels[i * 3 + 1] = paletteLut.g[i];
+        texels[i * 3 + 2] = paletteLut.b[i];
+    }
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_1D, paletteTexture);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, PALETTE_LUT_SIZE, 0, GL_RGB, GL_FLOAT, texels);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    glGenBuffers(1, &waveGridVBO);
+    uploadWaveGrid();
+    // Room for every layer at the finest level of detail, each range
+    // rounded up to the stream's alignment
+    size_t interactBytes = STREAM_BUFFER_ALIGNED((WAVE_MAX_SEGMENTS + 1) * 4 * sizeof(float));
+    if (!streamBufferInit(&interactStream, WAVE_LAYERS * interactBytes)) {
+        glDeleteBuffers(1, &waveGridVBO);
+        glDeleteTextures(1, &paletteTexture);
+        glDeleteProgram(waveProgram);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Rebuilt only when the level of detail changes
+void uploadWaveGrid() {
+    // Two vertices per column: (x, 0) follows the wave, (x, 1) is the bottom edge
+    static float grid[(WAVE_MAX_SEGMENTS + 1) * 4];
+    for (int i = 0; i <= waveSegments; i++) {
+        grid[i * 4 + 0] = gridX[i];
+        grid[i * 4 + 1] = 0.0f;
+        grid[i * 4 + 2] = gridX[i];
+        grid[i * 4 + 3] = 1.0f;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, waveGridVBO);
+    glBufferData(GL_ARRAY_BUFFER, (waveSegments + 1) * 4 * sizeof(float), grid, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void drawWavesRetained(float time) {
+    float tint[3];
+    waveTint(time, tint);
+
+    glUseProgram(waveProgram);
+    glUniform1f(waveTimeLoc, time);
+    glUniform1f(waveZoomLoc, zoom);
+    glUniform1f(waveAspectLoc, aspectRatio);
+    glUniform3f(waveTintLoc, tint[0], tint[1], tint[2]);
+    glBindTexture(GL_TEXTURE_1D, paletteTexture);
+
+    glBindBuffer(GL_ARRAY_BUFFER, waveGridVBO);
+    glEnableVertexAttribArray(waveGridAttrib);
+    glVertexAttribPointer(waveGridAttrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    // Stream the interaction terms of the layers events reach, duplicated for
+    // the top and bottom vertex of each column
+    size_t interactOffset[WAVE_LAYERS];
+    int streamed[WAVE_LAYERS] = {0};
+    streamBufferBeginFrame(&interactStream);
+    for (int layer = 0; layer < WAVE_LAYERS; layer++) {
+        if (!layerInteracts[layer]) {
+            continue;
+        }
+        float* interact = streamBufferReserve(&interactStream, (waveSegments + 1) * 4 * sizeof(float),
+                                              &interactOffset[layer]);
+        if (!interact) {
+            // Out of room: draw this layer without its interaction terms
+            continue;
+        }
+        streamed[layer] = 1;
+        for (int i = 0; i <= waveSegments; i++) {
+            interact[i * 4 + 0] = interact[i * 4 + 2] = interactMul[layer][i];
+            interact[i * 4 + 1] = interact[i * 4 + 3] = interactAdd[layer][i];
+        }
+    }
+    streamBufferCommit(&interactStream);
+
+    for (int layer = 0; layer < WAVE_LAYERS; layer++) {
+        glUniform1f(waveLayerLoc, (float)layer);
+        if (streamed[layer]) {
+            glEnableVertexAttribArray(waveInteractAttrib);
+            glVertexAttribPointer(waveInteractAttrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float),
+                                  streamBufferBind(&interactStream, interactOffset[layer]));
+        } else {
+            glDisableVertexAttribArray(waveInteractAttrib);
+            glVertexAttrib2f(waveInteractAttrib, 1.0f, 0.0f);
+        }
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, (waveSegments + 1) * 2);
+    }
+    streamBufferEndFrame(&interactStream);
+
+    glDisableVertexAttribArray(waveInteractAttrib);
+    glDisableVertexAttribArray(waveGridAttrib);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glUseProgram(0);
+}
+
+void destroyWavesRetained() {
+    glDeleteBuffers(1, &waveGridVBO);
+    streamBufferDestroy(&interactStream);
+    glDeleteTextures(1, &paletteTexture);
+    glDeleteProgram(waveProgram);
+}
+#endif
+
+// Scripted input for --bench, repeating every 600 frames. Positions are in
+// view coordinates ([-1, 1] on both axes) and follow the current zoom.
+// 0-59 calm water, 60-180 a left-button drag in a circle (ripple and
+// vortex), 200-280 a right-button drag (freeze), 300-420 a burst of quick
+// clicks that pile up ripples, 430-570 zooming in and back out.
+void runBenchScript(GLFWwindow* window, int frame) {
+    static unsigned int seed = 12345;
+    int t = frame % 600;
+    float sx = aspectRatio * zoom;
+    float sy = zoom;
+
+    if (t >= 60 && t <= 180) {
+        float angle = (t - 60) * 0.08f;
+        float x = -0.4f + cosf(angle) * 0.3f;
+        float y = sinf(angle) * 0.3f;
+        if (t == 60) {
+            pressButton(GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, x * sx, y * sy);
+        } else if (t == 180) {
+            pressButton(GLFW_MOUSE_BUTTON_LEFT, GLFW_RELEASE, x * sx, y * sy);
+        } else {
+            dragTo(x * sx, y * sy);
+        }
+    } else if (t >= 200 && t <= 280) {
+        float x = 0.2f + (t - 200) * 0.005f;
+        float y = 0.2f - (t - 200) * 0.004f;
+        if (t == 200) {
+            pressButton(GLFW_MOUSE_BUTTON_RIGHT, GLFW_PRESS, x * sx, y * sy);
+        } else if (t == 280) {
+            pressButton(GLFW_MOUSE_BUTTON_RIGHT, GLFW_RELEASE, x * sx, y * sy);
+        } else {
+            dragTo(x * sx, y * sy);
+        }
+    } else if (t >= 300 && t < 420 && t % 3 == 0) {
+        seed = seed * 1103515245u + 12345u;
+        float x = ((seed >> 8) % 1000) / 500.0f - 1.0f;
+        seed = seed * 1103515245u + 12345u;
+        float y = ((seed >> 8) % 1000) / 833.0f - 0.6f;
+        pressButton(GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, x * sx, y * sy);
+        pressButton(GLFW_MOUSE_BUTTON_LEFT, GLFW_RELEASE, x * sx, y * sy);
+    } else if (t >= 430 && t < 570 && t % 5 == 0) {
+        applyScroll(window, 0.0, t < 500 ? 1.0 : -1.0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int forceCPU = 0;
+    const char* kernelName = NULL;
+    int benchFrames = BENCH_DEFAULT_FRAMES;
+    const char* benchJsonPath = NULL;
+    int threads = -1;
+    int fieldWidth = WAVE_FIELD_DEFAULT_WIDTH;
+    int fieldHeight = WAVE_FIELD_DEFAULT_HEIGHT;
+    int fieldSizeParsed = 1;
+    const char* palettePath = NULL;
+    double idleFps = IDLE_DEFAULT_FPS;
+    double idleAfter = IDLE_DEFAULT_AFTER;
+    double idleStats = 0.0;
+    double frameBudget = 0.0;
+    float minScale = RENDER_SCALE_DEFAULT_MIN;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* headlessBackend = NULL;
+    int headlessMode = 0;
+    snapshotInit(&snapshot);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cpu") == 0) {
+            forceCPU = 1;
+        } else if (strncmp(argv[i], "--kernel=", 9) == 0) {
+            kernelName = argv[i] + 9;
+            forceCPU = 1;
+        } else if (strncmp(argv[i], "--segments-min=", 15) == 0) {
+            segmentsFloor = atoi(argv[i] + 15);
+        } else if (strncmp(argv[i], "--segments-max=", 15) == 0) {
+            segmentsCeiling = atoi(argv[i] + 15);
+        } else if (snapshotOption(&snapshot, argv[i])) {
+            continue;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = 1;
+        } else if (strncmp(argv[i], "--bench=", 8) == 0) {
+            benchMode = 1;
+            benchFrames = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--bench-json=", 13) == 0) {
+            benchJsonPath = argv[i] + 13;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--palette=", 10) == 0) {
+            palettePath = argv[i] + 10;
+        } else if (strcmp(argv[i], "--physics") == 0) {
+            physicsMode = 1;
+        } else if (strncmp(argv[i], "--physics=", 10) == 0) {
+            physicsMode = 1;
+            fieldSizeParsed = sscanf(argv[i] + 10, "%dx%d", &fieldWidth, &fieldHeight) == 2;
+        } else if (strncmp(argv[i], "--idle-fps=", 11) == 0) {
+            idleFps = atof(argv[i] + 11);
+        } else if (strncmp(argv[i], "--idle-after=", 13) == 0) {
+            idleAfter = atof(argv[i] + 13);
+        } else if (strcmp(argv[i], "--idle-stats") == 0) {
+            idleStats = IDLE_DEFAULT_REPORT;
+        } else if (strncmp(argv[i], "--idle-stats=", 13) == 0) {
+            idleStats = atof(argv[i] + 13);
+        } else if (strncmp(argv[i], "--frame-budget=", 15) == 0) {
+            frameBudget = atof(argv[i] + 15);
+        } else if (strncmp(argv[i], "--min-scale=", 12) == 0) {
+            minScale = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            recordPath = argv[i] + 9;
+        } else if (strncmp(argv[i], "--replay=", 9) == 0) {
+            replayPath = argv[i] + 9;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = 1;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessMode = 1;
+            headlessBackend = argv[i] + 11;
+        }
+    }
+    if (benchFrames <= 0) {
+        benchFrames = BENCH_DEFAULT_FRAMES;
+    }
+
+    // Notices go to stderr when stdout carries the benchmark JSON, so that a
+    // fallback cannot break it
+    FILE* notes = benchJsonPath && strcmp(benchJsonPath, "-") == 0 ? stderr : stdout;
+    if (!fieldSizeParsed) {
+        fprintf(notes, "Expected --physics=WIDTHxHEIGHT, using %dx%d\n", fieldWidth, fieldHeight);
+    }
+
+    waveKernel = waveKernelSelect(kernelName);
+    if (!waveKernel) {
+        fprintf(notes, "Wave kernel '%s' is not available, using the default\n", kernelName);
+        waveKernel = waveKernelSelect(NULL);
+    }
+
+    if (segmentsFloor < WAVE_MIN_SEGMENTS) segmentsFloor = WAVE_MIN_SEGMENTS;
+    if (segmentsCeiling > WAVE_MAX_SEGMENTS) segmentsCeiling = WAVE_MAX_SEGMENTS;
+    if (segmentsCeiling < segmentsFloor) segmentsCeiling = segmentsFloor;
+
+    // A snapshot runs on its own clock, without the bench script
+    if (snapshot.path) {
+        benchMode = 0;
+    }
+
+    paletteDefault(&palette);
+    if (palettePath && !paletteLoad(&palette, palettePath)) {
+        fprintf(notes, "Using the default palette\n");
+    }
+
+    waveEventsInit(&eventPool);
+    workerPoolInit(threads);
+    if (physicsMode && !waveFieldInit(&waveField, fieldWidth, fieldHeight, PHYSICS_WORLD_WIDTH)) {
+        fprintf(notes, "Cannot simulate a %dx%d wave field, using analytic waves\n", fieldWidth, fieldHeight);
+        physicsMode = 0;
+    }
+
+    // Without a window only the frame count or the log can end the run
+    if (headlessMode && !benchMode && !replayPath && !snapshot.path) {
+        printf("--headless needs --bench, --replay or --snapshot\n");
+        return -1;
+    }
+    if (!headlessMode && !glfwInit()) {
+        printf("Failed to initialize GLFW\n");
+        return -1;
+    }
+
+    if ((benchMode || snapshot.path) && !headlessMode) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    if (replayPath) {
+        inputLogReplay(&inputLog, replayPath);
+    } else if (recordPath) {
+        inputLogRecord(&inputLog, recordPath, currentTime);
+    }
+    // Start where the log does, so a replay steps exactly like the recording
+    double startTime = inputLog.mode != INPUT_LOG_OFF ? inputLog.startTime : currentTime();
+    simClockInit(&physicsClock, PHYSICS_TIMESTEP, PHYSICS_MAX_STEPS, startTime);
+
+    // Headless runs have no window: callbacks and window queries are skipped
+    // wherever window is NULL
+    GLFWwindow* window = NULL;
+    int width = 800, height = 600;
+    if (headlessMode) {
+        if (!headlessCreate(&headlessContext, headlessBackend, width, height, 0, 0, 0)) {
+            printf("Failed to create a headless context\n");
+            return -1;
+        }
+    } else {
+        window = glfwCreateWindow(width, height, "Peaceful Waves", NULL, NULL);
+        if (!window) {
+            printf("Failed to create window\n");
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetCursorPosCallback(window, cursor_position_callback);
+        glfwSwapInterval(benchMode || snapshot.path ? 0 : 1);  // Enable vsync, except when measuring
+        if (!benchMode && !snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+            idleGovernorInit(&idleGovernor, window, idleAfter, idleFps, idleStats);
+        }
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+
+    // Initialize OpenGL
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    framebuffer_size_callback(window, width, height);
+
+#ifdef WAVES_RETAINED
+    if (!forceCPU) {
+        useRetained = initWavesRetained();
+        if (!useRetained) {
+            fprintf(notes, "Retained-mode waves unavailable, using the CPU path (%s kernel)\n", waveKernel->name);
+        }
+    }
+#else
+    (void)forceCPU;
+#endif
+
+    spriteRendererInit();
+    buildCrystalTemplate();
+    if (frameBudget > 0.0) {
+        dynamicResolution = renderScaleInit(&renderScale, frameBudget, minScale, 1.0f);
+        if (!dynamicResolution) {
+            fprintf(notes, "Offscreen rendering unavailable, drawing at full resolution\n");
+        }
+    }
+    if (!streamBufferInit(&frameStream, FRAME_VERTICES * sizeof(FrameVertex))) {
+        printf("Failed to allocate the frame vertex buffer\n");
+        if (window) {
+            glfwTerminate();
+        } else {
+            headlessDestroy(&headlessContext);
+        }
+        return -1;
+    }
+
+    BenchReport bench;
+    BenchGpuTimer gpuTimer;
+    char benchPath[64];
+    double benchStart = 0.0;
+    double lastFrameEnd = 0.0;
+    int frame = 0;
+    if (benchMode) {
+        memset(&bench, 0, sizeof(bench));
+        benchSamplesInit(&bench.cpu, benchFrames);
+        benchSamplesInit(&bench.gpu, benchFrames);
+        benchSamplesInit(&bench.interval, benchFrames);
+        benchGpuTimerInit(&gpuTimer);
+    }
+
+    while (!window || !glfwWindowShouldClose(window)) {
+        if (benchMode) {
+            if (frame == BENCH_WARMUP_FRAMES + benchFrames) {
+                break;
             }
-        } else if (timeSinceClick >= 0.0f && timeSinceClick < 3.0f) {
-            // Explosion particles after release
-            for (int p = 0; p < 20; p++) {
-                float angle = p * 3.14159f * 2.0f / 20.0f;
-                float particleSpeed = 0.5f + (p % 3) * 0.2f;
-                float px = clickX + cos(angle) * timeSinceClick * particleSpeed;
-                float py = clickY + sin(angle) * timeSinceClick * particleSpeed - timeSinceClick * timeSinceClick * 0.1f;
-                float particleSize = 0.03f * (1.0f - timeSinceClick / 3.0f);
-
-                glBegin(GL_TRIANGLE_FAN);
-                float intensity = 1.0f - timeSinceClick / 3.0f;
-                glColor4f(1.0f, 0.5f + sin(p + time * 5.0f) * 0.5f, 0.2f, intensity);
-                glVertex2f(px, py);
-                for (int j = 0; j <= 8; j++) {
-                    float a = j * 2.0f * 3.14159f / 8.0f;
-                    glVertex2f(px + cos(a) * particleSize, py + sin(a) * particleSize);
-                }
-                glEnd();
+            benchClock = frame * BENCH_TIMESTEP;
+            if (inputLog.mode != INPUT_LOG_REPLAYING) {
+                runBenchScript(window, frame);
             }
+        } else if (window && !snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+            // Ripples, the crystal and held buttons move too fast to throttle
+            int lively = eventPool.liveCount > 0 || mousePressed || rightMousePressed ||
+                         currentTime() - rightClickTime < 4.0f;
+            idleGovernorWait(&idleGovernor, window, lively ? IDLE_ANIMATING : IDLE_SLOW);
         }
 
-        // Draw floating orbs
-        for (int i = 0; i < 8; i++) {
-            float orbTime = time * 0.3f + i * 1.5f;
-            float orbX = sin(orbTime * 0.7f + i * 2.0f) * 0.8f;
-            float orbY = cos(orbTime * 0.5f + i * 1.3f) * 0.4f + sin(orbTime) * 0.1f;
-            float orbSize = 0.02f + sin(orbTime * 2.0f) * 0.01f;
-
-            // Orb glow effect - outer glow
-            glBegin(GL_TRIANGLE_FAN);
-            float glowSize = orbSize * 3.0f;
-            glColor4f(1.0f, 0.9f, 0.7f, 0.1f);
-            glVertex2f(orbX, orbY);
-            for (int j = 0; j <= 20; j++) {
-                float angle = j * 2.0f * 3.14159f / 20.0f;
-                float x = orbX + cos(angle) * glowSize;
-                float y = orbY + sin(angle) * glowSize;
-                glColor4f(1.0f, 0.9f, 0.7f, 0.0f);
-                glVertex2f(x, y);
+        // Log this frame's clock, or replay the input due before it and
+        // take the recorded clock
+        frameTime = currentTime();
+        if (!inputLogFrame(&inputLog, window, &replayHandlers, &frameTime)) {
+            break;
+        }
+
+        if (benchMode) {
+            if (frame == BENCH_WARMUP_FRAMES) {
+                benchStart = wallClock();
             }
-            glEnd();
-
-            // Orb core
-            glBegin(GL_TRIANGLE_FAN);
-            float coreR = 1.0f;
-            float coreG = 0.95f - sin(orbTime * 3.0f) * 0.1f;
-            float coreB = 0.8f + sin(orbTime * 2.0f) * 0.2f;
-            glColor4f(coreR, coreG, coreB, 0.9f);
-            glVertex2f(orbX, orbY);
-            for (int j = 0; j <= 20; j++) {
-                float angle = j * 2.0f * 3.14159f / 20.0f;
-                float x = orbX + cos(angle) * orbSize;
-                float y = orbY + sin(angle) * orbSize;
-                glVertex2f(x, y);
+            if (frame >= BENCH_WARMUP_FRAMES) {
+                benchGpuTimerBegin(&gpuTimer, &bench.gpu);
             }
-            glEnd();
         }
+        double frameStart = wallClock();
+        float time = frameTime;
+        if (dynamicResolution) {
+            renderScaleBegin(&renderScale, framebufferWidth, framebufferHeight);
+        }
+
+        // Clear with deep ocean color
+        glClearColor(0.05f, 0.15f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glLoadIdentity();
 
-        // Draw crystal/ice formation effect for right mouse button
+        updateInteractions(time);
+
+        // Generate this frame's geometry on the worker pool
         float timeSinceRightClick = time - rightClickTime;
-        if (rightMousePressed || (timeSinceRightClick >= 0.0f && timeSinceRightClick < 4.0f)) {
-            // Draw growing ice crystals
-            float growthFactor = rightMousePressed ? 1.0f : (1.0f - timeSinceRightClick / 4.0f);
-
-            // Main crystal branches (6-fold symmetry like snowflakes)
-            for (int branch = 0; branch < 6; branch++) {
-                float baseAngle = branch * 3.14159f / 3.0f + time * 0.5f;
-
-                // Main branch
-                for (int seg = 0; seg < 10; seg++) {
-                    float segDist = seg * 0.04f * growthFactor;
-                    float segX = rightClickX + cos(baseAngle) * segDist;
-                    float segY = rightClickY + sin(baseAngle) * segDist;
-
-                    // Ice blue gradient
-                    float intensity = (1.0f - seg / 10.0f) * growthFactor;
-                    glBegin(GL_TRIANGLE_FAN);
-                    glColor4f(0.7f, 0.9f, 1.0f, intensity * 0.8f);
-                    glVertex2f(segX, segY);
-                    for (int j = 0; j <= 6; j++) {
-                        float a = j * 2.0f * 3.14159f / 6.0f;
-                        float size = (0.02f - seg * 0.001f) * growthFactor;
-                        glColor4f(0.5f, 0.8f, 1.0f, intensity * 0.3f);
-                        glVertex2f(segX + cos(a) * size, segY + sin(a) * size);
-                    }
-                    glEnd();
-
-                    // Sub-branches
-                    if (seg > 2 && seg % 2 == 0) {
-                        for (int side = -1; side <= 1; side += 2) {
-                            float subAngle = baseAngle + side * 3.14159f / 6.0f;
-                            for (int subseg = 0; subseg < 5; subseg++) {
-                                float subDist = subseg * 0.02f * growthFactor;
-                                float subX = segX + cos(subAngle) * subDist;
-                                float subY = segY + sin(subAngle) * subDist;
-
-                                glBegin(GL_TRIANGLE_FAN);
-                                float subIntensity = intensity * (1.0f - subseg / 5.0f);
-                                glColor4f(0.8f, 0.95f, 1.0f, subIntensity * 0.6f);
-                                glVertex2f(subX, subY);
-                                for (int j = 0; j <= 4; j++) {
-                                    float a = j * 2.0f * 3.14159f / 4.0f;
-                                    float size = 0.008f * growthFactor;
-                                    glVertex2f(subX + cos(a) * size, subY + sin(a) * size);
-                                }
-                                glEnd();
-                            }
-                        }
-                    }
-                }
+        int crystalVisible = rightMousePressed || (timeSinceRightClick >= 0.0f && timeSinceRightClick < 4.0f);
+        FrameJobs jobs = {time, WAVE_LAYERS, 0, 0.0f, 1.0f, 0.0f};
+#ifdef WAVES_RETAINED
+        if (useRetained) {
+            jobs.layerJobs = 0;
+        }
+#endif
+        if (jobs.layerJobs > 0) {
+            float tint[3];
+            waveTint(time, tint);
+            paletteBake(&palette, tint, &paletteLut);
+        }
+        if (crystalVisible) {
+            jobs.crystalJobs = CRYSTAL_BRANCHES;
+            jobs.crystalGrowth = rightMousePressed ? 1.0f : (1.0f - timeSinceRightClick / 4.0f);
+            jobs.crystalCos = cos(time * 0.5f);
+            jobs.crystalSin = sin(time * 0.5f);
+        }
+        crystalFirst = jobs.layerJobs * ((waveSegments + 1) * 2 + 2);
+        crystalCount = jobs.crystalJobs * CRYSTAL_BRANCH_VERTICES + (rightMousePressed ? FROST_VERTICES : 0);
+        streamBufferBeginFrame(&frameStream);
+        frameVertices =
+            streamBufferReserve(&frameStream, (crystalFirst + crystalCount) * sizeof(FrameVertex), &frameOffset);
+        // Out of room: skip the streamed geometry this frame rather than
+        // write past the segment
+        int geometryStreamed = frameVertices != NULL;
+        if (geometryStreamed) {
+            workerPoolRun(frameJob, &jobs, jobs.layerJobs + jobs.crystalJobs);
+            if (crystalVisible && rightMousePressed) {
+                generateFrost(time);
             }
+        }
+        streamBufferCommit(&frameStream);
 
-            // Frost particles around the crystal
-            if (rightMousePressed) {
-                for (int p = 0; p < 20; p++) {
-                    float angle = p * 3.14159f * 2.0f / 20.0f;
-                    float dist = sin(time * 3.0f + p * 0.5f) * 0.15f + 0.1f;
-                    float px = rightClickX + cos(angle) * dist;
-                    float py = rightClickY + sin(angle) * dist;
-
-                    glBegin(GL_POINTS);
-                    glPointSize(3.0f);
-                    float twinkle = sin(time * 10.0f + p * 2.0f) * 0.5f + 0.5f;
-                    glColor4f(0.9f, 0.95f, 1.0f, twinkle * 0.7f);
-                    glVertex2f(px, py);
-                    glEnd();
-                }
-            }
+#ifdef WAVES_RETAINED
+        if (useRetained) {
+            drawWavesRetained(time);
+        } else if (geometryStreamed) {
+            drawWavesCPU();
+        }
+#else
+        if (geometryStreamed) {
+            drawWavesCPU();
+        }
+#endif
+
+        // Particles, orbs and the click marker go out as one sprite batch
+        spriteDraw(sprites, collectSprites(time, sprites));
+
+        // Draw crystal/ice formation effect for right mouse button: the
+        // growing branches (6-fold symmetry like snowflakes) and, while the
+        // button is held, frost sparkles, all in one draw
+        if (crystalVisible && geometryStreamed) {
+            drawCrystal();
 
             // Freezing effect on waves (modify nearby wave behavior)
             // This is handled in the wave rendering loop above
         }
+        streamBufferEndFrame(&frameStream);
+        if (dynamicResolution) {
+            renderScaleEnd(&renderScale);
+        }
+        snapshotCapture(&snapshot, framebufferWidth, framebufferHeight);
+
+        if (window) {
+            glfwSwapBuffers(window);
+        } else {
+            headlessFinishFrame(&headlessContext);
+        }
+        if (dynamicResolution) {
+            renderScaleFrameDone(&renderScale, (wallClock() - frameStart) * 1000.0);
+        }
+        if (window) {
+            glfwPollEvents();
+        }
+        if (window && !benchMode && !snapshot.path && inputLog.mode != INPUT_LOG_REPLAYING) {
+            idleGovernorFrameDone(&idleGovernor, stdout);
+        }
+        if (snapshotFrameDone(&snapshot, (wallClock() - frameStart) * 1000.0)) {
+            break;
+        }
 
-        // Debug: Draw a small marker at the mouse click position
-        if (mousePressed) {
-            glBegin(GL_TRIANGLE_FAN);
-            glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-            glVertex2f(clickX, clickY);
-            for (int j = 0; j <= 20; j++) {
-                float angle = j * 2.0f * 3.14159f / 20.0f;
-                glVertex2f(clickX + cos(angle) * 0.05f, clickY + sin(angle) * 0.05f);
+        if (benchMode && frame >= BENCH_WARMUP_FRAMES) {
+            double frameEnd = wallClock();
+            benchGpuTimerEnd(&gpuTimer);
+            benchSamplesAdd(&bench.cpu, (frameEnd - frameStart) * 1000.0);
+            if (frame > BENCH_WARMUP_FRAMES) {
+                benchSamplesAdd(&bench.interval, (frameEnd - lastFrameEnd) * 1000.0);
             }
-            glEnd();
+            lastFrameEnd = frameEnd;
         }
+        frame++;
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    if (benchMode) {
+        benchGpuTimerFinish(&gpuTimer, &bench.gpu);
+        bench.program = "waves";
+        // Simulation, rendering path and how per-frame geometry is streamed
+        char fieldTag[32] = "";
+        if (physicsMode) {
+            snprintf(fieldTag, sizeof(fieldTag), "physics/%s+", waveField.kernelName);
+        }
+        snprintf(benchPath, sizeof(benchPath), "%scpu/%s+%s", fieldTag, waveKernel->name,
+                 streamBufferModeName(&frameStream));
+#ifdef WAVES_RETAINED
+        if (useRetained) {
+            snprintf(benchPath, sizeof(benchPath), "%sretained+%s", fieldTag, streamBufferModeName(&frameStream));
+        }
+#endif
+        bench.path = benchPath;
+        bench.renderer = (const char*)glGetString(GL_RENDERER);
+        bench.frames = bench.cpu.count;
+        bench.timestep = BENCH_TIMESTEP;
+        bench.wallSeconds = wallClock() - benchStart;
+
+        // With the JSON on stdout the human-readable table moves to stderr
+        int jsonToStdout = benchJsonPath && strcmp(benchJsonPath, "-") == 0;
+        benchPrintText(jsonToStdout ? stderr : stdout, &bench);
+        if (benchJsonPath) {
+            FILE* json = jsonToStdout ? stdout : fopen(benchJsonPath, "w");
+            if (json) {
+                benchPrintJson(json, &bench);
+                if (json != stdout) {
+                    fclose(json);
+                }
+            } else {
+                printf("Failed to write benchmark results to %s\n", benchJsonPath);
+            }
+        }
+
+        benchGpuTimerDestroy(&gpuTimer);
+        benchSamplesFree(&bench.cpu);
+        benchSamplesFree(&bench.gpu);
+        benchSamplesFree(&bench.interval);
+    } else if (window && idleStats > 0.0 && inputLog.mode != INPUT_LOG_REPLAYING) {
+        idleGovernorReport(&idleGovernor, stdout);
+    }
+
+    if (inputLog.mode == INPUT_LOG_RECORDING) {
+        fprintf(notes, "Recorded %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    } else if (inputLog.mode == INPUT_LOG_REPLAYING) {
+        fprintf(notes, "Replayed %d frames and %d input events\n", inputLog.frames, inputLog.events);
+    }
+    inputLogClose(&inputLog);
+
+#ifdef WAVES_RETAINED
+    if (useRetained) {
+        destroyWavesRetained();
+    }
+#endif
+    if (dynamicResolution) {
+        renderScaleDestroy(&renderScale);
+    }
+    spriteRendererDestroy();
+    streamBufferDestroy(&frameStream);
+    if (physicsMode) {
+        waveFieldDestroy(&waveField);
     }
+    workerPoolDestroy();
 
-    glfwTerminate();
+    snapshotDestroy(&snapshot);
+    if (window) {
+        glfwTerminate();
+    } else {
+        headlessDestroy(&headlessContext);
+    }
     return 0;
 }
\ No newline at end of file
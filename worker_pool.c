@@ -0,0 +1,149 @@
+#include "worker_pool.h"
+
+// MinGW builds link against plain opengl32/glfw3 without winpthreads, so
+// Windows runs the jobs on the calling thread.
+#ifndef _WIN32
+#define WORKER_POOL_THREADED 1
+#endif
+
+#ifdef WORKER_POOL_THREADED
+#include <pthread.h>
+#include <unistd.h>
+
+static pthread_t workers[WORKER_POOL_MAX_THREADS];
+static int workerCount = 0;
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t workDone = PTHREAD_COND_INITIALIZER;
+
+// Current batch, published under poolLock by bumping generation
+static WorkerJobFn batchFn;
+static void* batchCtx;
+static int batchJobs;
+static int nextJob;
+static int generation = 0;
+static int finishedWorkers = 0;
+static int shuttingDown = 0;
+
+static void runJobs(WorkerJobFn fn, void* ctx, int jobs) {
+    int job;
+    while ((job = __atomic_fetch_add(&nextJob, 1, __ATOMIC_RELAXED)) < jobs) {
+        fn(ctx, job);
+    }
+}
+
+static void* workerMain(void* arg) {
+    int seen = 0;
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&poolLock);
+        while (!shuttingDown && generation == seen) {
+            pthread_cond_wait(&workReady, &poolLock);
+        }
+        if (shuttingDown) {
+            pthread_mutex_unlock(&poolLock);
+            return NULL;
+        }
+        seen = generation;
+        WorkerJobFn fn = batchFn;
+        void* ctx = batchCtx;
+        int jobs = batchJobs;
+        pthread_mutex_unlock(&poolLock);
+
+        runJobs(fn, ctx, jobs);
+
+        // Every worker checks in, so none can still be touching this batch
+        // when the next one is published
+        pthread_mutex_lock(&poolLock);
+        if (++finishedWorkers == workerCount) {
+            pthread_cond_signal(&workDone);
+        }
+        pthread_mutex_unlock(&poolLock);
+    }
+}
+
+int workerPoolInit(int threads) {
+    if (threads < 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 1 ? (int)cores - 1 : 0;
+    }
+    if (threads > WORKER_POOL_MAX_THREADS) {
+        threads = WORKER_POOL_MAX_THREADS;
+    }
+
+    shuttingDown = 0;
+    for (workerCount = 0; workerCount < threads; workerCount++) {
+        if (pthread_create(&workers[workerCount], NULL, workerMain, NULL) != 0) {
+            break;
+        }
+    }
+    return workerCount;
+}
+
+void workerPoolRun(WorkerJobFn fn, void* ctx, int jobs) {
+    if (jobs <= 0) {
+        return;
+    }
+    // Not worth waking anyone for a single job
+    if (workerCount == 0 || jobs == 1) {
+        for (int job = 0; job < jobs; job++) {
+            fn(ctx, job);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&poolLock);
+    batchFn = fn;
+    batchCtx = ctx;
+    batchJobs = jobs;
+    __atomic_store_n(&nextJob, 0, __ATOMIC_RELAXED);
+    finishedWorkers = 0;
+    generation++;
+    pthread_cond_broadcast(&workReady);
+    pthread_mutex_unlock(&poolLock);
+
+    runJobs(fn, ctx, jobs);
+
+    pthread_mutex_lock(&poolLock);
+    while (finishedWorkers < workerCount) {
+        pthread_cond_wait(&workDone, &poolLock);
+    }
+    pthread_mutex_unlock(&poolLock);
+}
+
+int workerPoolThreads(void) {
+    return workerCount;
+}
+
+void workerPoolDestroy(void) {
+    pthread_mutex_lock(&poolLock);
+    shuttingDown = 1;
+    pthread_cond_broadcast(&workReady);
+    pthread_mutex_unlock(&poolLock);
+
+    for (int i = 0; i < workerCount; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    workerCount = 0;
+}
+#else
+int workerPoolInit(int threads) {
+    (void)threads;
+    return 0;
+}
+
+void workerPoolRun(WorkerJobFn fn, void* ctx, int jobs) {
+    for (int job = 0; job < jobs; job++) {
+        fn(ctx, job);
+    }
+}
+
+int workerPoolThreads(void) {
+    return 0;
+}
+
+void workerPoolDestroy(void) {
+}
+#endif
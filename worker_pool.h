@@ -0,0 +1,23 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+// Persistent worker threads for splitting per-frame work into independent
+// jobs. The calling thread takes jobs too, so a pool without workers (or a
+// platform without pthreads) simply runs every job inline.
+
+#define WORKER_POOL_MAX_THREADS 32
+
+typedef void (*WorkerJobFn)(void* ctx, int job);
+
+// Start the workers. A negative count picks one per spare CPU core.
+// Returns the number of workers actually running.
+int workerPoolInit(int threads);
+
+// Run fn(ctx, job) for job = 0 .. jobs-1 and return once all have finished.
+// Jobs must not depend on each other or call workerPoolRun themselves.
+void workerPoolRun(WorkerJobFn fn, void* ctx, int jobs);
+
+int workerPoolThreads(void);
+void workerPoolDestroy(void);
+
+#endif